@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "frei0r.h"
+#include "frei0r_cpu.h"
 
 #define SIZE_RGBA 4
 
@@ -65,68 +66,106 @@ typedef struct squareblur_instance
   unsigned int width;
   unsigned int height;
   double kernel; /* the kernel size, as a percentage of the biggest of width and height */
-  uint32_t *mem; /* memory accumulation matrix of uint32_t (size = acc_width*acc_height*SIZE_RGBA) */
-  uint32_t **acc; /* accumulation matrix of pointers to SIZE_RGBA consecutive uint32_t in mem (size = acc_width*acc_height) */
+  uint32_t *mem; /* summed area table of uint32_t (size = acc_width*acc_height*SIZE_RGBA) */
+  double *inv_w; /* 1 / width of the kernel window of each column */
+  unsigned int inv_kernel; /* kernel size inv_w was computed for */
 } squareblur_instance_t;
 
 /* Updates the summed area table. */
 static void update_summed_area_table(squareblur_instance_t *inst, const uint32_t *src)
 {
-  register unsigned char *iter_data;
-  register uint32_t *iter_mem;
-  register unsigned int i, x, y;
+  const unsigned char *iter_data = (const unsigned char*) src;
+  const unsigned int row_width = SIZE_RGBA * (inst->width+1);
+  uint32_t *row = inst->mem;
+  unsigned int i, x, y;
 
-  uint32_t acc_buffer[SIZE_RGBA]; /* accumulation buffer */
+  /* First row (all zeros). */
+  memset(row, 0, row_width * sizeof(uint32_t));
 
-  unsigned int row_width;
-  unsigned int width, height;
-  unsigned int cell_size;
-  
-  /* Compute basic params. */
-  width = inst->width+1;
-  height = inst->height+1;
-  row_width = SIZE_RGBA * width;
-  cell_size = SIZE_RGBA * sizeof(uint32_t);
-  
-  /* Init iterators. */
-  iter_data = (unsigned char*) src;
-  iter_mem  = inst->mem;
-
-  /* Process first row (all zeros). */
-  memset(iter_mem, 0, row_width * cell_size);
-  iter_mem += row_width;
-  
-  if (height >= 1)
+  for (y=0; y<inst->height; ++y)
   {
-    /* Process second row. */
-    memset(acc_buffer, 0, cell_size);
-    memset(iter_mem,   0, cell_size); /* first column is void */
-    iter_mem += SIZE_RGBA;
-    for (x=1; x<width; ++x)
+    const uint32_t *above = row;
+    uint32_t acc_buffer[SIZE_RGBA] = {0, 0, 0, 0}; /* accumulation buffer */
+
+    row += row_width;
+    memset(row, 0, SIZE_RGBA * sizeof(uint32_t)); /* first column is void */
+    for (x=SIZE_RGBA; x<row_width; x+=SIZE_RGBA)
     {
       for (i=0; i<SIZE_RGBA; ++i)
-        *iter_mem++ = (acc_buffer[i] += *iter_data++);
+      {
+        acc_buffer[i] += iter_data[i];
+        row[x+i] = above[x+i] + acc_buffer[i];
+      }
+      iter_data += SIZE_RGBA;
     }
-    
-    /* Process other rows. */
-    for (y=2; y<height; ++y)
+  }
+}
+
+#if defined(F0R_HAVE_AVX2)
+typedef int32_t blur_i32x4 __attribute__ ((vector_size (16), aligned (4), may_alias));
+typedef double blur_f64x4 __attribute__ ((vector_size (32)));
+typedef uint8_t blur_u8x4 __attribute__ ((vector_size (4), aligned (1), may_alias));
+#endif
+
+/* Means of the kernel windows of rows [first,last).  The sums are
+   integers, so (sum + 0.5) / area truncates to the same value as the
+   integer division even with the double rounding of the reciprocal. */
+static inline void blur_rows(const squareblur_instance_t *inst, unsigned int kernel_size,
+                             unsigned char *dst, unsigned int first, unsigned int last)
+{
+  const unsigned int width = inst->width, height = inst->height;
+  const unsigned int row_width = SIZE_RGBA * (width+1);
+  const double *inv_w = inst->inv_w;
+  unsigned int x, y;
+
+  dst += SIZE_RGBA * width * first;
+  for (y=first; y<last; ++y)
+  {
+    unsigned int y0 = MAX(y - kernel_size, 0);
+    unsigned int y1 = MIN(y + kernel_size + 1, height);
+    const uint32_t *top = inst->mem + y0 * row_width;
+    const uint32_t *bottom = inst->mem + y1 * row_width;
+    const double inv_h = 1.0 / (y1 - y0);
+
+    for (x=0; x<width; ++x)
     {
-      /* Copy upper line. */
-      memcpy(iter_mem, iter_mem - row_width, row_width * sizeof(uint32_t));
-      
-      /* Process row. */
-      memset(acc_buffer, 0, cell_size);
-      memset(iter_mem,   0, cell_size); /* first column is void */
-      iter_mem += SIZE_RGBA;
-      for (x=1; x<width; ++x)
+      /* it is assumed that (x0,y0) <= (x1,y1) */
+      unsigned int x0 = SIZE_RGBA * MAX(x - kernel_size, 0);
+      unsigned int x1 = SIZE_RGBA * MIN(x + kernel_size + 1, width);
+      const double inv = inv_w[x] * inv_h;
+#if defined(F0R_HAVE_AVX2)
+      /* all channels at once, the sums stay below 2^31 */
+      blur_i32x4 sum = *(const blur_i32x4*)(bottom+x1) - *(const blur_i32x4*)(bottom+x0)
+        - *(const blur_i32x4*)(top+x1) + *(const blur_i32x4*)(top+x0);
+      blur_f64x4 mean = (__builtin_convertvector(sum, blur_f64x4) + 0.5) * inv;
+      *(blur_u8x4*)dst = __builtin_convertvector(__builtin_convertvector(mean, blur_i32x4), blur_u8x4);
+#else
+      unsigned int i;
+      for (i=0; i<SIZE_RGBA; ++i)
       {
-        for (i=0; i<SIZE_RGBA; ++i)
-          *iter_mem++ += (acc_buffer[i] += *iter_data++);
+        uint32_t sum = bottom[x1+i] - bottom[x0+i] - top[x1+i] + top[x0+i];
+        dst[i] = (unsigned char) (((double) sum + 0.5) * inv);
       }
+#endif
+      dst += SIZE_RGBA;
     }
   }
 }
 
+#if defined(F0R_HAVE_AVX2)
+F0R_TARGET_AVX2 static void blur_rows_avx2(const squareblur_instance_t *inst, unsigned int kernel_size,
+                                           unsigned char *dst, unsigned int first, unsigned int last)
+{
+  blur_rows(inst, kernel_size, dst, first, last);
+}
+
+F0R_TARGET_AVX512 static void blur_rows_avx512(const squareblur_instance_t *inst, unsigned int kernel_size,
+                                               unsigned char *dst, unsigned int first, unsigned int last)
+{
+  blur_rows(inst, kernel_size, dst, first, last);
+}
+#endif
+
 static void blur_get_param_info(f0r_param_info_t* info, int param_index)
 {
   switch(param_index)
@@ -143,25 +182,14 @@ static f0r_instance_t blur_construct(unsigned int width, unsigned int height)
 {
   squareblur_instance_t* inst = 
     (squareblur_instance_t*)malloc(sizeof(squareblur_instance_t));
-  unsigned int i;
-  unsigned int acc_width, acc_height = height+1;
-  uint32_t*  iter_mem;
-  uint32_t** iter_acc;
+  unsigned int acc_width = width+1, acc_height = height+1;
   /* set params */
   inst->width = width; inst->height = height;
-  acc_width = width+1; acc_height = height+1;
   inst->kernel = 0.0;
   /* allocate memory for the summed-area-table */
   inst->mem = (uint32_t*) malloc(acc_width*acc_height*SIZE_RGBA*sizeof(uint32_t));
-  inst->acc = (uint32_t**) malloc(acc_width*acc_height*sizeof(uint32_t*));
-  /* point at the right place */
-  iter_mem = inst->mem;
-  iter_acc = inst->acc;
-  for (i=0; i<acc_width*acc_height; ++i)
-  {
-    *iter_acc++ = iter_mem;
-    iter_mem += SIZE_RGBA;
-  }
+  inst->inv_w = (double*) malloc(width*sizeof(double));
+  inst->inv_kernel = 0;
   return (f0r_instance_t)inst;
 }
 
@@ -169,7 +197,7 @@ static void blur_destruct(f0r_instance_t instance)
 {
   squareblur_instance_t* inst = 
     (squareblur_instance_t*)instance;
-  free(inst->acc);
+  free(inst->inv_w);
   free(inst->mem);
   free(instance);
 }
@@ -211,13 +239,10 @@ static void blur_update(f0r_instance_t instance, double time,
   
   unsigned int width = inst->width;
   unsigned int height = inst->height;
-  unsigned int acc_width = width+1; /* width of the summed area table */
   unsigned int max = MAX(width, height);
   unsigned int kernel_size = (unsigned int) (inst->kernel * max / 2.0);
 
-  unsigned int x, y;
-  unsigned int x0, x1, y0, y1;
-  unsigned int area;
+  unsigned int x;
   
   if (kernel_size <= 0)
   {
@@ -226,45 +251,27 @@ static void blur_update(f0r_instance_t instance, double time,
   }
   else
   {
-    assert(inst->acc);
-    unsigned char* dst = (unsigned char*)outframe;
-    uint32_t** acc = inst->acc;
-    uint32_t sum[SIZE_RGBA];
-    unsigned int y0_offset, y1_offset;
-    
-    /* Compute the summed area table. */
-    update_summed_area_table(inst, inframe);
-    
-    /* Loop through the image's pixels. */
-    for (y=0;y<height;y++)
+    void (*rows)(const squareblur_instance_t*, unsigned int,
+                 unsigned char*, unsigned int, unsigned int) = blur_rows;
+#if defined(F0R_HAVE_AVX2)
+    unsigned int cpu = f0r_cpu_features();
+    if (cpu & F0R_CPU_AVX512)
+      rows = blur_rows_avx512;
+    else if (cpu & F0R_CPU_AVX2)
+      rows = blur_rows_avx2;
+#endif
+
+    if (inst->inv_kernel != kernel_size)
     {
-      for (x=0;x<width;x++)
-      {
-        /* The kernel's coordinates. */
-        x0 = MAX(x - kernel_size, 0);
-        x1 = MIN(x + kernel_size + 1, width);
-        y0 = MAX(y - kernel_size, 0);
-        y1 = MIN(y + kernel_size + 1, height);
-        
-        /* Get the sum in the current kernel. */
-        area = (x1-x0)*(y1-y0);
-        
-        y0_offset = y0*acc_width;
-        y1_offset = y1*acc_width;
-        
-        /* it is assumed that (x0,y0) <= (x1,y1) */
-        memcpy(sum, acc[y1_offset + x1], SIZE_RGBA*sizeof(uint32_t));
-        subtract_acc(sum, acc[y1_offset + x0]);
-        subtract_acc(sum, acc[y0_offset + x1]);
-        add_acc(sum, acc[y0_offset + x0]);
-        
-        /* Take the mean and copy it to output. */
-        divide(dst, sum, area);
-        
-        /* Increment iterator. */
-        dst += SIZE_RGBA;
-      }
+      for (x=0; x<width; ++x)
+        inst->inv_w[x] = 1.0 / (MIN(x + kernel_size + 1, width) - MAX(x - kernel_size, 0));
+      inst->inv_kernel = kernel_size;
     }
+
+    /* Compute the summed area table. */
+    update_summed_area_table(inst, inframe);
+
+    /* Take the mean of the kernel window around every pixel. */
+    rows(inst, kernel_size, (unsigned char*)outframe, 0, height);
   }
 }
-
@@ -40,6 +40,18 @@
  *
  * @section sec_changes Changes
  *
+ * @subsection sec_changes_1_2_ext Optional extensions to frei0r 1.2
+ *   - added optional \ref f0r_update_ex for frames with row padding and
+ *     for updating a region of interest only
+ *   - added optional \ref f0r_get_capabilities to let effects declare
+ *     that they can update a frame in place (\ref CAPABILITIES)
+ *   - added high bit depth color models RGBA16161616 and RGBA_FLOAT32,
+ *     which hosts select per instance with \ref f0r_set_color_model
+ *   - added optional \ref f0r_get_stats reporting the time spent in
+ *     update calls and the memory held by an instance
+ *   - added optional \ref f0r_resize to change the frame size of an
+ *     instance without constructing a new one
+ *
  * @subsection sec_changes_1_1_1_2 From frei0r 1.1 to frei0r 1.2
  *   - make <vendor> in plugin path optional
  *   - added section on FREI0R_PATH environment variable
@@ -177,6 +189,7 @@
  *
  *
  * - \ref f0r_get_plugin_info
+ * - \ref f0r_get_capabilities
  * - \ref f0r_get_param_info
  * - \ref f0r_construct
  * - \ref f0r_destruct
@@ -186,12 +199,21 @@
  *
  * - \ref f0r_set_param_value
  * - \ref f0r_get_param_value
+ * - \ref f0r_set_color_model
+ * - \ref f0r_resize
  * - \ref f0r_update
  * - \ref f0r_update2
+ * - \ref f0r_update_ex
  *
  * If a thread is in one of these methods its allowed for another thread to
  * enter one of theses methods for a different effect instance. But for one
  * effect instance only one thread is allowed to execute any of these methods. 
+ *
+ *
+ * - \ref f0r_get_stats
+ *
+ * May be called from any thread at any time between \ref f0r_construct
+ * and \ref f0r_destruct of the instance, also while it is updating.
  */
 
 
@@ -276,8 +298,16 @@ void f0r_deinit(void);
  *
  * For each color model, a frame consists of width*height pixels which
  * are stored row-wise and consecutively in memory. The size of a pixel is
- * 4 bytes. There is no extra pitch parameter
- * (i.e. the pitch is simply width*4).
+ * 4 bytes, except for the high bit depth models RGBA16161616 (8 bytes)
+ * and RGBA_FLOAT32 (16 bytes). There is no extra pitch parameter
+ * (i.e. the pitch is simply width times the pixel size).
+ *
+ * Effects always announce one of the 8 bit models in
+ * f0r_plugin_info_t, so that older applications keep working. An
+ * application switches an instance to a high bit depth model with
+ * \ref f0r_set_color_model if the effect supports it (see
+ * \ref CAPABILITIES); the frame pointers passed to the update functions
+ * then point to pixels of that model.
  *
  * The following additional constraints must be honored:
  *   - The top-most line of a frame is stored first in memory.
@@ -320,6 +350,26 @@ void f0r_deinit(void);
  * Note that source effects must not use this color model.
  */
 #define F0R_COLOR_MODEL_PACKED32 2
+
+/**
+ * In RGBA16161616, each pixel is represented by 4 consecutive
+ * uint16_t values in native byte order, holding the red, green,
+ * blue and alpha components, with 65535 for full intensity.
+ *
+ * Only available through \ref f0r_set_color_model.
+ */
+#define F0R_COLOR_MODEL_RGBA16161616 3
+
+/**
+ * In RGBA_FLOAT32, each pixel is represented by 4 consecutive
+ * float values holding the red, green, blue and alpha components.
+ * The components use the same (nonlinear) encoding as in RGBA8888,
+ * scaled to 0.0 to 1.0; color values outside that range are allowed
+ * and carry extended range or high dynamic range content.
+ *
+ * Only available through \ref f0r_set_color_model.
+ */
+#define F0R_COLOR_MODEL_RGBA_FLOAT32 4
 /*@}*/
 
 /**
@@ -607,6 +657,190 @@ void f0r_update2(f0r_instance_t instance,
 		 const uint32_t* inframe2,
 		 const uint32_t* inframe3,
 		 uint32_t* outframe);
+
+//---------------------------------------------------------------------------
+
+/**
+ * A rectangle of a frame, in pixels.
+ * \see f0r_update_ex
+ */
+typedef struct f0r_roi
+{
+  int x;      /**< left column */
+  int y;      /**< top row */
+  int width;  /**< number of columns */
+  int height; /**< number of rows */
+} f0r_roi_t;
+
+/**
+ * Optional variant of \ref f0r_update2 for frames that are not tightly
+ * packed, and for updating only a part of the frame.
+ *
+ * Hosts must look this function up at runtime (e.g. with dlsym()) and
+ * fall back to \ref f0r_update or \ref f0r_update2 if a plugin does not
+ * export it. If a plugin exports it, its behavior must be the same as
+ * that of \ref f0r_update2 on packed frames holding the same pixels.
+ *
+ * Every frame still has the width and height the instance was
+ * constructed with, but consecutive rows are stride bytes apart instead
+ * of width*4. Strides are positive multiples of 4 and at least width*4
+ * (or width times the pixel size of a high bit depth model selected with
+ * \ref f0r_set_color_model); the frame data must be aligned as for
+ * \ref f0r_update. This lets hosts
+ * pass padded decoder frames or windows into a larger canvas without
+ * copying them first.
+ *
+ * Only the pixels of outframe inside roi are written, everything else in
+ * outframe is left untouched. The whole input frames must be valid, as
+ * effects may read pixels outside roi (e.g. for blurs or distortions).
+ * A roi of 0 means the whole frame; a roi reaching outside the frame is
+ * clipped to it.
+ *
+ * \param instance the effect instance
+ * \param time the application time, as for \ref f0r_update2
+ * \param inframe1 the first incoming video frame (can be zero for sources)
+ * \param instride1 distance between rows of inframe1 in bytes
+ * \param inframe2 the second incoming video frame
+ *        (can be zero for sources and filters)
+ * \param instride2 distance between rows of inframe2 in bytes
+ * \param inframe3 the third incoming video frame
+ *        (can be zero for sources, filters and mixer2)
+ * \param instride3 distance between rows of inframe3 in bytes
+ * \param outframe the resulting video frame
+ * \param outstride distance between rows of outframe in bytes
+ * \param roi the region of outframe to update, or 0 for all of it
+ *
+ * \see f0r_update2
+ */
+void f0r_update_ex(f0r_instance_t instance,
+		   double time,
+		   const uint32_t* inframe1, int instride1,
+		   const uint32_t* inframe2, int instride2,
+		   const uint32_t* inframe3, int instride3,
+		   uint32_t* outframe, int outstride,
+		   const f0r_roi_t* roi);
+
+//---------------------------------------------------------------------------
+
+/** \addtogroup CAPABILITIES Capabilities
+ * Optional properties of an effect, returned by
+ * \ref f0r_get_capabilities as a combination of these bits.
+ *  @{
+ */
+
+/**
+ * The effect gives the same result when outframe is inframe1, i.e. it
+ * never reads a pixel of inframe1 after writing that pixel of outframe.
+ * Hosts may then run the effect in place and save allocating and
+ * touching a separate output frame. For \ref f0r_update_ex this only
+ * holds if outstride equals instride1.
+ *
+ * The other input frames of a mixer must never alias outframe.
+ */
+#define F0R_CAP_INPLACE 0x1
+
+/** The effect accepts \ref F0R_COLOR_MODEL_RGBA16161616 frames. */
+#define F0R_CAP_RGBA16161616 0x2
+
+/** The effect accepts \ref F0R_COLOR_MODEL_RGBA_FLOAT32 frames. */
+#define F0R_CAP_RGBA_FLOAT32 0x4
+
+/** @} */
+
+/**
+ * Optional function returning the \ref CAPABILITIES of the effect.
+ *
+ * Hosts must look this function up at runtime (e.g. with dlsym()); an
+ * effect that does not export it has no capabilities, so hosts must
+ * pass distinct input and output frames to it. Capabilities are a
+ * property of the plugin, they do not depend on the instance or on
+ * parameter values.
+ *
+ * \return a combination of the F0R_CAP_* bits
+ */
+unsigned int f0r_get_capabilities(void);
+
+/**
+ * Optional function to change the color model of an instance.
+ *
+ * Instances start with the color model of f0r_plugin_info_t. Hosts that
+ * want to run an effect on high bit depth frames check its
+ * \ref CAPABILITIES and then select the model with this function, which
+ * they must look up at runtime like \ref f0r_get_capabilities. The
+ * model applies to all input and output frames of the following update
+ * calls; for \ref f0r_update_ex, strides must be at least width times
+ * the pixel size of the model.
+ *
+ * \param instance the effect instance
+ * \param color_model one of the \ref COLOR_MODEL values
+ * \return 1 if the instance now uses color_model, 0 if the effect does
+ *         not support it (the instance keeps its previous model)
+ */
+int f0r_set_color_model(f0r_instance_t instance, unsigned int color_model);
+
+/**
+ * Optional function to change the frame size of an instance.
+ *
+ * The size given to \ref f0r_construct is fixed, so a host switching
+ * resolutions (adaptive streaming, proxy and full size editing) would
+ * have to construct a new instance and lose what the old one built up:
+ * loaded models, precomputed maps, the frames kept by temporal effects.
+ * Effects exporting this function adapt the instance instead. It keeps
+ * its parameter values and color model; buffers depending on the size
+ * are reallocated, and frames kept from earlier updates are scaled to
+ * the new size where the effect can, else it starts over as after
+ * construction.
+ *
+ * Hosts must look this function up at runtime like
+ * \ref f0r_get_capabilities. All update calls after a successful
+ * resize take frames of the new size.
+ *
+ * \param instance the effect instance
+ * \param width the new width, a multiple of 8 like in \ref f0r_construct
+ * \param height the new height, a multiple of 8
+ * \return 1 if the instance now works on frames of the new size, 0 if
+ *         the effect cannot resize it; the instance then keeps its old
+ *         size and the host constructs a new one
+ */
+int f0r_resize(f0r_instance_t instance, unsigned int width, unsigned int height);
+
+//---------------------------------------------------------------------------
+
+/**
+ * Performance counters of an instance.
+ * \see f0r_get_stats
+ */
+typedef struct f0r_stats
+{
+  uint64_t calls;         /**< update calls since construction */
+  uint64_t frames;        /**< those of the calls that wrote the whole
+                               output frame (not just a roi) */
+  uint64_t total_ns;      /**< time spent in all update calls, in ns */
+  uint64_t last_ns;       /**< time spent in the latest update call */
+  uint64_t scratch_bytes; /**< memory the instance holds besides the
+                               frames, as of the latest update call */
+} f0r_stats_t;
+
+/**
+ * Optional function reporting how much time an instance spends in
+ * \ref f0r_update, \ref f0r_update2 and \ref f0r_update_ex and how
+ * much memory it holds, e.g. to find the effect of a chain that is over
+ * its frame budget.
+ *
+ * Hosts must look this function up at runtime like
+ * \ref f0r_get_capabilities. Unlike the other functions taking an
+ * instance it may be called while another thread updates the instance;
+ * the counters are then those from before or after that call. Times are
+ * measured with a monotonic clock and include everything the effect
+ * does in the call, also work it hands to other threads.
+ *
+ * \param instance the effect instance
+ * \param stats receives the counters
+ * \return 1 on success, 0 if the effect keeps no counters (stats is
+ *         left untouched)
+ */
+int f0r_get_stats(f0r_instance_t instance, f0r_stats_t* stats);
+
 //---------------------------------------------------------------------------
 
 #endif
@@ -3,10 +3,20 @@ extern "C"
   #include "frei0r.h"
 }
 
+#include <algorithm>
 #include <list>
 #include <vector>
 #include <string>
 #include <iostream>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#if !defined(F0R_NO_STATS)
+#include <atomic>
+#include <chrono>
+#endif
 
 
 namespace frei0r
@@ -20,6 +30,7 @@ namespace frei0r
   static std::pair<int,int> s_version;
   static unsigned int s_effect_type;
   static unsigned int s_color_model;
+  static unsigned int s_capabilities;
 
   static  fx* (*s_build) (unsigned int, unsigned int);
 
@@ -35,6 +46,17 @@ namespace frei0r
   
   static std::vector<param_info> s_params;
 
+  // The parameters are collected from the register_param() calls of the
+  // first instance built, once; see describe().
+  static std::once_flag s_described;
+  static bool s_describing = false;
+
+  // Set for effects with a static describe(), which fills s_params and
+  // s_param_refs without an instance; s_param_refs then point each
+  // instance built to its parameters.
+  static void (*s_describe) ();
+  static std::vector<std::function<void* (fx*)> > s_param_refs;
+
   
   class fx
   {
@@ -43,21 +65,46 @@ namespace frei0r
     unsigned int width;
     unsigned int height;
     unsigned int size; // = width * height
+    unsigned int color_model; // see f0r_set_color_model()
     std::vector<void*> param_ptrs;
 
     fx()
     {
-      s_params.clear(); // reinit static params 
+    }
+
+    // Bytes of memory the instance holds for its work besides the
+    // frames, reported by f0r_get_stats(). Effects with large buffers
+    // override it; it is called after every update.
+    virtual size_t scratch_bytes() const
+    {
+      return 0;
     }
     
+    // Change the frame size, see f0r_resize(). width, height and size
+    // still hold the old size; they are updated when this returns true.
+    // Effects whose buffers or state depend on the size override it to
+    // reallocate and rescale them. The default refuses, and the host
+    // then constructs a new instance.
+    virtual bool resize(unsigned int new_width, unsigned int new_height)
+    {
+      (void)new_width;
+      (void)new_height;
+      return false;
+    }
+
     virtual unsigned int effect_type()=0;
     
+    // Deprecated: list the parameters in a static describe() instead,
+    // see param_list. The effects in this tree all do; register_param()
+    // stays for effects built against this header elsewhere, whose
+    // parameter list is then taken from an instance (see describe()).
     void register_param(f0r_param_color& p_loc,
 			const std::string& name,
 			const std::string& desc)
     {
       param_ptrs.push_back(&p_loc);
-      s_params.push_back(param_info(name,desc,F0R_PARAM_COLOR));
+      if (s_describing)
+        s_params.push_back(param_info(name,desc,F0R_PARAM_COLOR));
     }
     
     void register_param(double& p_loc,
@@ -65,7 +112,8 @@ namespace frei0r
 			const std::string& desc)
     {
       param_ptrs.push_back(&p_loc);
-      s_params.push_back(param_info(name,desc,F0R_PARAM_DOUBLE));
+      if (s_describing)
+        s_params.push_back(param_info(name,desc,F0R_PARAM_DOUBLE));
     }
 
     void register_param(bool& p_loc,
@@ -73,7 +121,8 @@ namespace frei0r
 			const std::string& desc)
     {
       param_ptrs.push_back(&p_loc);
-      s_params.push_back(param_info(name,desc,F0R_PARAM_BOOL));
+      if (s_describing)
+        s_params.push_back(param_info(name,desc,F0R_PARAM_BOOL));
     }
 
     void register_param(f0r_param_position& p_loc,
@@ -81,7 +130,8 @@ namespace frei0r
 			const std::string& desc)
     {
       param_ptrs.push_back(&p_loc);
-      s_params.push_back(param_info(name,desc,F0R_PARAM_POSITION));
+      if (s_describing)
+        s_params.push_back(param_info(name,desc,F0R_PARAM_POSITION));
     }
     
     void register_param(std::string& p_loc,
@@ -89,7 +139,8 @@ namespace frei0r
 			const std::string& desc)
     {
       param_ptrs.push_back(&p_loc);
-      s_params.push_back(param_info(name,desc,F0R_PARAM_STRING));
+      if (s_describing)
+        s_params.push_back(param_info(name,desc,F0R_PARAM_STRING));
     }
     
     
@@ -158,10 +209,169 @@ namespace frei0r
               const uint32_t* in1,
               const uint32_t* in2,
               const uint32_t* in3) = 0;
+
+    // The region of an f0r_update_ex() call, clipped to the frame.
+    f0r_roi_t clip_roi(const f0r_roi_t* roi) const
+    {
+      f0r_roi_t r = { 0, 0, int(width), int(height) };
+      if (roi) {
+        int x1 = roi->x + roi->width, y1 = roi->y + roi->height;
+        r.x = roi->x < 0 ? 0 : roi->x;
+        r.y = roi->y < 0 ? 0 : roi->y;
+        r.width = (x1 > int(width) ? int(width) : x1) - r.x;
+        r.height = (y1 > int(height) ? int(height) : y1) - r.y;
+        if (r.width < 0) r.width = 0;
+        if (r.height < 0) r.height = 0;
+      }
+      return r;
+    }
+
+    // Bytes per pixel of the current color model.
+    int pixel_size() const
+    {
+      switch (color_model) {
+      case F0R_COLOR_MODEL_RGBA16161616: return 8;
+      case F0R_COLOR_MODEL_RGBA_FLOAT32: return 16;
+      default: return 4;
+      }
+    }
+
+    // Copy a rectangle between two frames with the given strides in bytes.
+    static void copy_rect(const uint32_t* src, int src_stride,
+                          uint32_t* dst, int dst_stride, const f0r_roi_t& r,
+                          int pixel_size = sizeof(uint32_t))
+    {
+      const char* s = reinterpret_cast<const char*>(src) + std::ptrdiff_t(r.y) * src_stride + r.x * pixel_size;
+      char* d = reinterpret_cast<char*>(dst) + std::ptrdiff_t(r.y) * dst_stride + r.x * pixel_size;
+      for (int y = 0; y < r.height; ++y, s += src_stride, d += dst_stride)
+        std::memcpy(d, s, r.width * pixel_size);
+    }
+
+    // Scale a packed frame (or any plane of pixels) to another size by
+    // nearest neighbour, e.g. to keep the history of an effect in
+    // resize(). An empty source gives a frame of T().
+    template<class T>
+    static void scale_nearest(const T* src, unsigned int src_width, unsigned int src_height,
+                              T* dst, unsigned int dst_width, unsigned int dst_height)
+    {
+      if (src_width == 0 || src_height == 0) {
+        std::fill(dst, dst + size_t(dst_width) * dst_height, T());
+        return;
+      }
+      std::vector<unsigned int> xs(dst_width);
+      for (unsigned int x = 0; x < dst_width; ++x)
+        xs[x] = unsigned(uint64_t(x) * src_width / dst_width);
+      for (unsigned int y = 0; y < dst_height; ++y) {
+        const T* s = src + size_t(uint64_t(y) * src_height / dst_height) * src_width;
+        T* d = dst + size_t(y) * dst_width;
+        for (unsigned int x = 0; x < dst_width; ++x)
+          d[x] = s[xs[x]];
+      }
+    }
+
+    // Update with row strides and a region of interest, see
+    // f0r_update_ex(). This version packs the frames that are not packed
+    // already, runs update() and copies the region back. Effects that can
+    // work on strided rows override it to skip those copies.
+    virtual void update_ex(double time,
+              uint32_t* out, int out_stride,
+              const uint32_t* in1, int in_stride1,
+              const uint32_t* in2, int in_stride2,
+              const uint32_t* in3, int in_stride3,
+              const f0r_roi_t& roi)
+    {
+      const int px = pixel_size();
+      const int packed = int(width) * px;
+      const size_t words = size * (px / sizeof(uint32_t));
+      const f0r_roi_t all = { 0, 0, int(width), int(height) };
+      const uint32_t* in[3] = { in1, in2, in3 };
+      const int in_stride[3] = { in_stride1, in_stride2, in_stride3 };
+
+      if (roi.width <= 0 || roi.height <= 0)
+        return;
+      for (int i = 0; i < 3; ++i) {
+        if (in[i] && in_stride[i] != packed) {
+          m_ex_in[i].resize(words);
+          copy_rect(in[i], in_stride[i], &m_ex_in[i][0], packed, all, px);
+          in[i] = &m_ex_in[i][0];
+        }
+      }
+
+      bool whole = roi.width == int(width) && roi.height == int(height);
+      if (whole && out_stride == packed) {
+        update(time, out, in[0], in[1], in[2]);
+        return;
+      }
+      m_ex_out.resize(words);
+      update(time, &m_ex_out[0], in[0], in[1], in[2]);
+      copy_rect(&m_ex_out[0], packed, out, out_stride, roi, px);
+    }
     
     virtual ~fx()
     {
     }
+
+    // Set the frame size, after construction and after resize().
+    void set_size(unsigned int new_width, unsigned int new_height)
+    {
+      width = new_width;
+      height = new_height;
+      size = new_width * new_height;
+      for (int i = 0; i < 3; ++i)
+        std::vector<uint32_t>().swap(m_ex_in[i]);
+      std::vector<uint32_t>().swap(m_ex_out);
+#if !defined(F0R_NO_STATS)
+      count_scratch();
+#endif
+    }
+
+#if !defined(F0R_NO_STATS)
+    // The counters of f0r_get_stats(). Only the thread in update stores
+    // them, so relaxed loads and stores do and cost no more than plain
+    // ones; other threads may read them at any time.
+    void count_scratch()
+    {
+      size_t bytes = scratch_bytes();
+      for (int i = 0; i < 3; ++i)
+        bytes += m_ex_in[i].capacity() * sizeof(uint32_t);
+      bytes += m_ex_out.capacity() * sizeof(uint32_t);
+      m_scratch_bytes.store(bytes, std::memory_order_relaxed);
+    }
+
+    void count_update(uint64_t ns, bool whole)
+    {
+      const std::memory_order relaxed = std::memory_order_relaxed;
+      m_calls.store(m_calls.load(relaxed) + 1, relaxed);
+      if (whole)
+        m_frames.store(m_frames.load(relaxed) + 1, relaxed);
+      m_total_ns.store(m_total_ns.load(relaxed) + ns, relaxed);
+      m_last_ns.store(ns, relaxed);
+      count_scratch();
+    }
+
+    void get_stats(f0r_stats_t* stats) const
+    {
+      const std::memory_order relaxed = std::memory_order_relaxed;
+      stats->calls = m_calls.load(relaxed);
+      stats->frames = m_frames.load(relaxed);
+      stats->total_ns = m_total_ns.load(relaxed);
+      stats->last_ns = m_last_ns.load(relaxed);
+      stats->scratch_bytes = m_scratch_bytes.load(relaxed);
+    }
+#endif
+
+  private:
+    // scratch frames for update_ex()
+    std::vector<uint32_t> m_ex_in[3];
+    std::vector<uint32_t> m_ex_out;
+
+#if !defined(F0R_NO_STATS)
+    std::atomic<uint64_t> m_calls{0};
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_total_ns{0};
+    std::atomic<uint64_t> m_last_ns{0};
+    std::atomic<uint64_t> m_scratch_bytes{0};
+#endif
   };
   
   class source : public fx
@@ -238,6 +448,154 @@ namespace frei0r
   };
 
   
+  // The plugin type follows from the base class, no instance needed.
+  template<class T>
+  unsigned int effect_type_of()
+  {
+    return std::is_base_of<mixer3, T>::value ? F0R_PLUGIN_TYPE_MIXER3
+      : std::is_base_of<mixer2, T>::value ? F0R_PLUGIN_TYPE_MIXER2
+      : std::is_base_of<source, T>::value ? F0R_PLUGIN_TYPE_SOURCE
+      : F0R_PLUGIN_TYPE_FILTER;
+  }
+
+  // The parameters of an effect, listed by its static describe() in the
+  // order of the parameter indices:
+  //
+  //   static void describe(frei0r::param_list<Water>& params)
+  //   {
+  //     params.add(&Water::physics, "physics", "water density: from 1 to 4");
+  //     ...
+  //   }
+  //
+  // Such an effect does not call register_param(); hosts get the list
+  // without an instance being built, which suits effects whose
+  // constructors allocate or compute tables.
+  template<class T>
+  class param_list
+  {
+  public:
+    void add(f0r_param_color T::*p, const std::string& name, const std::string& desc)
+    {
+      add(p, name, desc, F0R_PARAM_COLOR);
+    }
+
+    void add(double T::*p, const std::string& name, const std::string& desc)
+    {
+      add(p, name, desc, F0R_PARAM_DOUBLE);
+    }
+
+    void add(bool T::*p, const std::string& name, const std::string& desc)
+    {
+      add(p, name, desc, F0R_PARAM_BOOL);
+    }
+
+    void add(f0r_param_position T::*p, const std::string& name, const std::string& desc)
+    {
+      add(p, name, desc, F0R_PARAM_POSITION);
+    }
+
+    void add(std::string T::*p, const std::string& name, const std::string& desc)
+    {
+      add(p, name, desc, F0R_PARAM_STRING);
+    }
+
+    // Element i of an array member, e.g. one of several colors:
+    //   params.add(&FaceDetect::color, 0, "Color 1", "...");
+    template<class M, size_t N>
+    void add(M (T::*p)[N], size_t i, const std::string& name, const std::string& desc)
+    {
+      s_params.push_back(param_info(name, desc, type_of(static_cast<M*>(0))));
+      s_param_refs.push_back([p, i](fx* f) -> void* {
+        return &(static_cast<T*>(f)->*p)[i];
+      });
+    }
+
+  private:
+    template<class M>
+    void add(M T::*p, const std::string& name, const std::string& desc, int type)
+    {
+      s_params.push_back(param_info(name, desc, type));
+      s_param_refs.push_back([p](fx* f) -> void* {
+        return &(static_cast<T*>(f)->*p);
+      });
+    }
+
+    static int type_of(f0r_param_color*) { return F0R_PARAM_COLOR; }
+    static int type_of(double*) { return F0R_PARAM_DOUBLE; }
+    static int type_of(bool*) { return F0R_PARAM_BOOL; }
+    static int type_of(f0r_param_position*) { return F0R_PARAM_POSITION; }
+    static int type_of(std::string*) { return F0R_PARAM_STRING; }
+  };
+
+  // Whether T has a static describe(param_list<T>&).
+  template<class T>
+  class has_describe
+  {
+    template<class U>
+    static char test(decltype(U::describe(std::declval<param_list<U>&>()))*);
+    template<class U>
+    static long test(...);
+
+  public:
+    static const bool value = sizeof(test<T>(0)) == 1;
+  };
+
+  // Build an instance, collecting the parameter list first if that was
+  // not done yet. Effects with a static describe() give it directly;
+  // for the others, a host that constructs before asking for the
+  // metadata gets it from its own instance, otherwise describe() builds
+  // one of size 0x0 and throws it away.
+  inline fx* build_instance(unsigned int width, unsigned int height)
+  {
+    fx* nfx = 0;
+    std::call_once(s_described, [&] {
+      if (s_describe) {
+        s_describe();
+        return;
+      }
+      s_describing = true;
+      nfx = s_build(width, height);
+      s_describing = false;
+    });
+    return nfx ? nfx : s_build(width, height);
+  }
+
+  inline void describe()
+  {
+    std::call_once(s_described, [] {
+      if (s_describe) {
+        s_describe();
+        return;
+      }
+      s_describing = true;
+      delete s_build(0, 0);
+      s_describing = false;
+    });
+  }
+
+#if !defined(F0R_NO_STATS)
+  // Times one update call of an instance for f0r_get_stats().
+  class update_timer
+  {
+  public:
+    update_timer(fx* f, bool whole)
+      : m_fx(f), m_whole(whole), m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~update_timer()
+    {
+      std::chrono::nanoseconds ns = std::chrono::steady_clock::now() - m_start;
+      m_fx->count_update(uint64_t(ns.count()), m_whole);
+    }
+
+  private:
+    fx* m_fx;
+    bool m_whole;
+    std::chrono::steady_clock::time_point m_start;
+  };
+#endif
+
   // register stuff
   template<class T>
   class construct
@@ -248,18 +606,20 @@ namespace frei0r
               const std::string& author,
               const int& major_version,
               const int& minor_version,
-              unsigned int color_model = F0R_COLOR_MODEL_BGRA8888)
+              unsigned int color_model = F0R_COLOR_MODEL_BGRA8888,
+              unsigned int capabilities = 0)
     {
-      T a(0,0);
-      
+      // runs when the plugin is loaded: only record the strings, the
+      // parameters are collected lazily (see describe())
       s_name=name; 
       s_explanation=explanation;
       s_author=author;
       s_version=std::make_pair(major_version,minor_version);
-      s_build=build;
+      use_describe(std::integral_constant<bool, has_describe<T>::value>());
       
-      s_effect_type=a.effect_type();
+      s_effect_type=effect_type_of<T>();
       s_color_model=color_model;
+      s_capabilities=capabilities;
     }
 
   private:
@@ -267,6 +627,31 @@ namespace frei0r
     {
       return new T(width,height);
     }
+
+    void use_describe(std::false_type)
+    {
+      s_build=build;
+    }
+
+    void use_describe(std::true_type)
+    {
+      s_build=build_described;
+      s_describe=describe_static;
+    }
+
+    static void describe_static()
+    {
+      param_list<T> params;
+      T::describe(params);
+    }
+
+    static fx* build_described(unsigned int width, unsigned int height)
+    {
+      fx* nfx = new T(width,height);
+      for (size_t i = 0; i < s_param_refs.size(); i++)
+        nfx->param_ptrs.push_back(s_param_refs[i](nfx));
+      return nfx;
+    }
   };
 }
 
@@ -284,6 +669,7 @@ void f0r_deinit()
 
 void f0r_get_plugin_info(f0r_plugin_info_t* info)
 {
+  frei0r::describe();
   info->name = frei0r::s_name.c_str();
   info->author = frei0r::s_author.c_str();
   info->plugin_type = frei0r::s_effect_type;
@@ -295,8 +681,14 @@ void f0r_get_plugin_info(f0r_plugin_info_t* info)
   info->num_params =  static_cast<int>(frei0r::s_params.size()); 
 }
 
+unsigned int f0r_get_capabilities()
+{
+  return frei0r::s_capabilities;
+}
+
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
+  frei0r::describe();
   info->name=frei0r::s_params[param_index].m_name.c_str();
   info->type=frei0r::s_params[param_index].m_type;
   info->explanation=frei0r::s_params[param_index].m_desc.c_str();
@@ -304,10 +696,9 @@ void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 
 f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 {
-  frei0r::fx* nfx = frei0r::s_build(width, height);
-  nfx->width=width;
-  nfx->height=height;
-  nfx->size=width*height;
+  frei0r::fx* nfx = frei0r::build_instance(width, height);
+  nfx->color_model=frei0r::s_color_model;
+  nfx->set_size(width, height);
   return nfx;
 }
 
@@ -328,18 +719,69 @@ void f0r_get_param_value(f0r_instance_t instance,
   static_cast<frei0r::fx*>(instance)->get_param_value(param, param_index);
 }
 
+int f0r_set_color_model(f0r_instance_t instance, unsigned int color_model)
+{
+  unsigned int cap = 0;
+  if (color_model == F0R_COLOR_MODEL_RGBA16161616)
+    cap = F0R_CAP_RGBA16161616;
+  else if (color_model == F0R_COLOR_MODEL_RGBA_FLOAT32)
+    cap = F0R_CAP_RGBA_FLOAT32;
+  if (color_model != frei0r::s_color_model && !(frei0r::s_capabilities & cap))
+    return 0;
+  static_cast<frei0r::fx*>(instance)->color_model = color_model;
+  return 1;
+}
+
+int f0r_resize(f0r_instance_t instance, unsigned int width, unsigned int height)
+{
+  frei0r::fx* fx = static_cast<frei0r::fx*>(instance);
+  if (width == fx->width && height == fx->height)
+    return 1;
+  if (!fx->resize(width, height))
+    return 0;
+  fx->set_size(width, height);
+  return 1;
+}
+
 void f0r_update2(f0r_instance_t instance, double time,
 		 const uint32_t* inframe1,
 		 const uint32_t* inframe2,
 		 const uint32_t* inframe3,
 		 uint32_t* outframe)
 {
-  static_cast<frei0r::fx*>(instance)->update(time,
-                                             outframe,
-                                             inframe1,
-                                             inframe2,
-                                             inframe3);
+  frei0r::fx* fx = static_cast<frei0r::fx*>(instance);
+#if !defined(F0R_NO_STATS)
+  frei0r::update_timer timer(fx, true);
+#endif
+  fx->update(time, outframe, inframe1, inframe2, inframe3);
+}
+
+void f0r_update_ex(f0r_instance_t instance, double time,
+		   const uint32_t* inframe1, int instride1,
+		   const uint32_t* inframe2, int instride2,
+		   const uint32_t* inframe3, int instride3,
+		   uint32_t* outframe, int outstride,
+		   const f0r_roi_t* roi)
+{
+  frei0r::fx* fx = static_cast<frei0r::fx*>(instance);
+  f0r_roi_t r = fx->clip_roi(roi);
+#if !defined(F0R_NO_STATS)
+  frei0r::update_timer timer(fx, r.width == int(fx->width) && r.height == int(fx->height));
+#endif
+  fx->update_ex(time, outframe, outstride,
+                inframe1, instride1,
+                inframe2, instride2,
+                inframe3, instride3,
+                r);
+}
+
+#if !defined(F0R_NO_STATS)
+int f0r_get_stats(f0r_instance_t instance, f0r_stats_t* stats)
+{
+  static_cast<const frei0r::fx*>(instance)->get_stats(stats);
+  return 1;
 }
+#endif
 
 // compability for frei0r 1.0 
 void f0r_update(f0r_instance_t instance, 
@@ -0,0 +1,208 @@
+/*
+ * frei0r_blend.hpp
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INCLUDED_FREI0R_BLEND_HPP
+#define INCLUDED_FREI0R_BLEND_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "frei0r_cpu.h"
+
+/*
+  Per channel blending of two RGBA8888 frames, for the simple mixer2
+  blend modes.
+
+  An operation is a functor with
+
+    uint8_t operator()(uint8_t a, uint8_t b) const;
+
+  and, where GCC vector types are available (F0R_HAVE_VECTOR, see
+  frei0r_cpu.h), the same operation on a vector of channels,
+
+    template <class V> V operator()(V a, V b) const;
+
+  which is instantiated with 16, 32 and 64 byte vectors for the
+  baseline, AVX2 and AVX-512 variants.  Both forms must give the same
+  results.  less(), select(), mul(), div255() and wide<V>::type below
+  help to write the vector form.
+
+  frei0r::blend::rgb() applies the operation to the colour channels and
+  takes the smaller of the two alphas, like the blend modes of the GIMP;
+  frei0r::blend::rgba() applies it to all four channels.  Both are safe
+  to run in place on the first input.
+*/
+
+// GCC warns that vectors are passed differently with AVX.  All of this
+// is inlined, so the ABI does not matter; the warning is silenced for the
+// helpers here, and plugins put F0R_BLEND_IGNORE_PSABI after their
+// includes for their operations, whose vector forms GCC instantiates and
+// checks at the end of the source file.
+#if defined(__GNUC__) && !defined(__clang__)
+#define F0R_BLEND_IGNORE_PSABI _Pragma("GCC diagnostic ignored \"-Wpsabi\"")
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#else
+#define F0R_BLEND_IGNORE_PSABI
+#endif
+
+namespace frei0r
+{
+  namespace blend
+  {
+#if defined(F0R_HAVE_VECTOR)
+    typedef uint8_t u8x16 __attribute__ ((vector_size (16)));
+    typedef uint8_t u8x32 __attribute__ ((vector_size (32)));
+    typedef uint8_t u8x64 __attribute__ ((vector_size (64)));
+
+    // the vector of 16 bit lanes for the channels of V
+    template <class V> struct wide
+    {
+      typedef uint16_t type __attribute__ ((vector_size (2 * sizeof(V))));
+    };
+
+    template <class V> inline V select(V mask, V a, V b)
+    {
+      return (a & mask) | (b & ~mask);
+    }
+
+    // 0xff where a < b; SSE2 and AVX2 only compare signed bytes
+    template <class V> inline V less(V a, V b)
+    {
+      typedef int8_t S __attribute__ ((vector_size (sizeof(V))));
+      return (V)((S)(a ^ 0x80) < (S)(b ^ 0x80));
+    }
+
+    // t / 255 for t <= 255 * 255, GCC does not vectorize the division
+    template <class W> inline W div255(W t)
+    {
+      t += 1;
+      return (t + (t >> 8)) >> 8;
+    }
+
+    // a * b / 255, rounded like INT_MULT of frei0r_math.h
+    template <class V> inline V mul(V a, V b)
+    {
+      typedef typename wide<V>::type W;
+      W t = __builtin_convertvector(a, W) * __builtin_convertvector(b, W) + 0x80;
+      return __builtin_convertvector(((t >> 8) + t) >> 8, V);
+    }
+#endif
+
+    template <class Op, bool ALPHA_MIN>
+    inline void run_scalar(const Op& op, const uint8_t* a, const uint8_t* b,
+                           uint8_t* out, size_t i, size_t n)
+    {
+      for (; i < n; i += 4) {
+        for (int c = 0; c < 3; ++c)
+          out[i + c] = op(a[i + c], b[i + c]);
+        out[i + 3] = ALPHA_MIN ? (a[i + 3] < b[i + 3] ? a[i + 3] : b[i + 3])
+                               : op(a[i + 3], b[i + 3]);
+      }
+    }
+
+#if defined(F0R_HAVE_VECTOR)
+    template <class Op, bool ALPHA_MIN, class V>
+    inline void run(const Op& op, const uint8_t* a, const uint8_t* b,
+                    uint8_t* out, size_t n)
+    {
+      const size_t N = sizeof(V);
+      size_t i = 0;
+      V alpha;
+      for (size_t k = 0; k < N; ++k)
+        alpha[k] = (k & 3) == 3 ? 0xff : 0;
+      // V as a template argument loses aligned (1), hence memcpy
+      for (; i + N <= n; i += N) {
+        V x, y, v;
+        memcpy(&x, a + i, N);
+        memcpy(&y, b + i, N);
+        v = op(x, y);
+        if (ALPHA_MIN)
+          v = select(alpha, select(less(x, y), x, y), v);
+        memcpy(out + i, &v, N);
+      }
+      run_scalar<Op, ALPHA_MIN>(op, a, b, out, i, n);
+    }
+#endif
+
+#if defined(F0R_HAVE_AVX2)
+    template <class Op, bool ALPHA_MIN>
+    F0R_TARGET_AVX2 static void run_avx2(const Op& op, const uint8_t* a, const uint8_t* b,
+                                  uint8_t* out, size_t n)
+    {
+      run<Op, ALPHA_MIN, u8x32>(op, a, b, out, n);
+    }
+
+    template <class Op, bool ALPHA_MIN>
+    F0R_TARGET_AVX512 static void run_avx512(const Op& op, const uint8_t* a, const uint8_t* b,
+                                      uint8_t* out, size_t n)
+    {
+      run<Op, ALPHA_MIN, u8x64>(op, a, b, out, n);
+    }
+#endif
+
+    template <class Op, bool ALPHA_MIN>
+    inline void dispatch(const Op& op, const uint32_t* in1, const uint32_t* in2,
+                         uint32_t* out, unsigned int size)
+    {
+      const uint8_t* a = reinterpret_cast<const uint8_t*>(in1);
+      const uint8_t* b = reinterpret_cast<const uint8_t*>(in2);
+      uint8_t* d = reinterpret_cast<uint8_t*>(out);
+      size_t n = 4 * (size_t)size;
+#if defined(F0R_HAVE_AVX2)
+      unsigned int cpu = f0r_cpu_features();
+      if (cpu & F0R_CPU_AVX512)
+        run_avx512<Op, ALPHA_MIN>(op, a, b, d, n);
+      else if (cpu & F0R_CPU_AVX2)
+        run_avx2<Op, ALPHA_MIN>(op, a, b, d, n);
+      else
+#endif
+#if defined(F0R_HAVE_VECTOR)
+        run<Op, ALPHA_MIN, u8x16>(op, a, b, d, n);
+#else
+        run_scalar<Op, ALPHA_MIN>(op, a, b, d, 0, n);
+#endif
+    }
+
+    // op on R, G and B, the smaller alpha
+    template <class Op>
+    inline void rgb(const Op& op, const uint32_t* in1, const uint32_t* in2,
+                    uint32_t* out, unsigned int size)
+    {
+      dispatch<Op, true>(op, in1, in2, out, size);
+    }
+
+    // op on all four channels
+    template <class Op>
+    inline void rgba(const Op& op, const uint32_t* in1, const uint32_t* in2,
+                     uint32_t* out, unsigned int size)
+    {
+      dispatch<Op, false>(op, in1, in2, out, size);
+    }
+  }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * frei0r_bundle.h
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INCLUDED_FREI0R_BUNDLE_H
+#define INCLUDED_FREI0R_BUNDLE_H
+
+/*
+  Index of frei0r-bundle, the optional shared library holding all
+  plugins of this package (cmake -DWITH_BUNDLE=ON).
+
+  Instead of opening every plugin file and looking up its functions, a
+  host opens frei0r-bundle.so once, looks up f0r_bundle_plugins() and
+  gets a table with one entry per plugin.  The functions of an entry
+  behave exactly like the exports of the plugin file of the same name,
+  including the requirement to call init before anything else and
+  deinit when done.  Optional functions the plugin does not provide
+  (update2 for most filters, update_ex, get_capabilities,
+  set_color_model, get_stats, resize) are null, like a failed dlsym()
+  would be.
+
+  Plugins in the bundle are independent of each other: each has its own
+  copy of its global state, exactly as if loaded from separate files.
+*/
+
+#include "frei0r.h"
+
+typedef struct f0r_bundle_entry
+{
+  const char* name; /* file name of the plugin without extension */
+
+  int (*init)(void);
+  void (*deinit)(void);
+  void (*get_plugin_info)(f0r_plugin_info_t* info);
+  void (*get_param_info)(f0r_param_info_t* info, int param_index);
+  f0r_instance_t (*construct)(unsigned int width, unsigned int height);
+  void (*destruct)(f0r_instance_t instance);
+  void (*set_param_value)(f0r_instance_t instance,
+                          f0r_param_t param, int param_index);
+  void (*get_param_value)(f0r_instance_t instance,
+                          f0r_param_t param, int param_index);
+  void (*update)(f0r_instance_t instance, double time,
+                 const uint32_t* inframe, uint32_t* outframe);
+  void (*update2)(f0r_instance_t instance, double time,
+                  const uint32_t* inframe1, const uint32_t* inframe2,
+                  const uint32_t* inframe3, uint32_t* outframe);
+  void (*update_ex)(f0r_instance_t instance, double time,
+                    const uint32_t* inframe1, int instride1,
+                    const uint32_t* inframe2, int instride2,
+                    const uint32_t* inframe3, int instride3,
+                    uint32_t* outframe, int outstride,
+                    const f0r_roi_t* roi);
+  unsigned int (*get_capabilities)(void);
+  int (*set_color_model)(f0r_instance_t instance, unsigned int color_model);
+  int (*get_stats)(f0r_instance_t instance, f0r_stats_t* stats);
+  int (*resize)(f0r_instance_t instance,
+                unsigned int width, unsigned int height);
+} f0r_bundle_entry_t;
+
+/* Exported by frei0r-bundle.so: stores the address of the table in
+   *entries and returns the number of plugins in it. */
+int f0r_bundle_plugins(const f0r_bundle_entry_t** entries);
+
+typedef int (*f0r_bundle_plugins_f)(const f0r_bundle_entry_t** entries);
+
+#endif
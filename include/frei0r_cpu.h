@@ -0,0 +1,115 @@
+/*
+ * frei0r_cpu.h
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INCLUDED_FREI0R_CPU_H
+#define INCLUDED_FREI0R_CPU_H
+
+/*
+  Runtime selection of kernels built for wider instruction sets than
+  the one the package is compiled for.
+
+  A kernel is written once, with plain loops or GCC vector types, and
+  then instantiated once per target by small wrappers:
+
+    F0R_TARGET_AVX2 static void kernel_avx2(...) { kernel(...); }
+
+  F0R_TARGET_AVX2 and F0R_TARGET_AVX512 set the target and flatten the
+  wrapper, so the kernel and every inline helper it calls are compiled
+  for that instruction set.  The plugin picks a variant the first time
+  it needs one, from f0r_cpu_features().  As all variants run the same
+  integer arithmetic they give identical frames.
+
+  Setting FREI0R_CPU to generic, avx2 or avx512 caps the variants used,
+  e.g. to compare them on one machine.
+
+  Variants exist with GCC 9 or clang on x86 (F0R_HAVE_AVX2 and
+  F0R_HAVE_AVX512 are defined then) unless F0R_NO_CPU_DISPATCH is
+  defined (cmake -DWITH_CPU_DISPATCH=OFF).  F0R_HAVE_VECTOR is defined
+  with these compilers on any platform; code guarded by it or by
+  F0R_HAVE_AVX2 may rely on GCC vector types and __builtin_convertvector.
+  On aarch64 NEON is part of the baseline, and vector types use it
+  without any selection.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define F0R_CPU_SSE2   0x1
+#define F0R_CPU_AVX2   0x2
+#define F0R_CPU_AVX512 0x4 /* AVX-512 F and BW */
+#define F0R_CPU_NEON   0x8
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+#define F0R_HAVE_VECTOR
+#endif
+
+#if !defined(F0R_NO_CPU_DISPATCH) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))) \
+  && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9))
+#define F0R_HAVE_AVX2
+#define F0R_HAVE_AVX512
+#define F0R_TARGET_AVX2 __attribute__((target("avx2"), flatten))
+#define F0R_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw"), flatten))
+#endif
+
+#define F0R_CPU_DETECTED 0x80000000u
+
+/* Detection gives the same answer in every thread, so concurrent first
+   calls may both run it; the result is published with one atomic store. */
+static inline unsigned int f0r_cpu_features(void)
+{
+  static unsigned int features = 0;
+  unsigned int f;
+#if defined(__GNUC__) || defined(__clang__)
+  f = __atomic_load_n(&features, __ATOMIC_ACQUIRE);
+#else
+  f = features;
+#endif
+  if (!(f & F0R_CPU_DETECTED)) {
+    const char* env = getenv("FREI0R_CPU");
+    f = 0;
+#if defined(F0R_HAVE_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+      f |= F0R_CPU_SSE2;
+    if (__builtin_cpu_supports("avx2"))
+      f |= F0R_CPU_AVX2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+      f |= F0R_CPU_AVX512;
+#elif defined(__SSE2__)
+    f |= F0R_CPU_SSE2;
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+    f |= F0R_CPU_NEON;
+#endif
+    if (env && strcmp(env, "generic") == 0)
+      f &= F0R_CPU_SSE2 | F0R_CPU_NEON; /* the baseline */
+    else if (env && strcmp(env, "avx2") == 0)
+      f &= F0R_CPU_SSE2 | F0R_CPU_AVX2;
+    f |= F0R_CPU_DETECTED;
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(&features, f, __ATOMIC_RELEASE);
+#else
+    features = f;
+#endif
+  }
+  return f & ~F0R_CPU_DETECTED;
+}
+
+#endif
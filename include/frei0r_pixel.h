@@ -0,0 +1,148 @@
+/*
+ * frei0r_pixel.h
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INCLUDED_FREI0R_PIXEL_H
+#define INCLUDED_FREI0R_PIXEL_H
+
+/*
+  Loading and storing pixels of the RGBA color models as floats, for
+  effects that work in floating point internally and accept the high
+  bit depth models (F0R_CAP_RGBA16161616, F0R_CAP_RGBA_FLOAT32).
+
+  A pixel becomes 4 floats r, g, b, a, scaled so that full intensity is
+  'scale' (effects use 1.0 or 255.0 internally).  Storing rounds to the
+  nearest integer and clamps for the integer models; RGBA_FLOAT32 is
+  neither clamped nor quantised, so a chain of float effects keeps
+  values outside 0..1 and all of their precision.
+
+  Effects keep their own 8 bit code where it exists, these helpers are
+  for the additional models.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "frei0r.h"
+
+/* Bytes per pixel of a color model. */
+static inline int f0r_pixel_size(unsigned int color_model)
+{
+  switch (color_model) {
+  case F0R_COLOR_MODEL_RGBA16161616: return 8;
+  case F0R_COLOR_MODEL_RGBA_FLOAT32: return 16;
+  default: return 4;
+  }
+}
+
+/* 1 if the color model is one of the RGBA models these helpers handle. */
+static inline int f0r_pixel_model_ok(unsigned int color_model, unsigned int capabilities)
+{
+  return color_model == F0R_COLOR_MODEL_RGBA8888
+    || (color_model == F0R_COLOR_MODEL_RGBA16161616 && (capabilities & F0R_CAP_RGBA16161616))
+    || (color_model == F0R_COLOR_MODEL_RGBA_FLOAT32 && (capabilities & F0R_CAP_RGBA_FLOAT32));
+}
+
+/* n pixels to 4*n floats. */
+static inline void f0r_pixels_to_float(const void* in, unsigned int color_model,
+                                       float* out, int n, float scale)
+{
+  int i;
+  switch (color_model) {
+  case F0R_COLOR_MODEL_RGBA16161616: {
+    const uint16_t* s = (const uint16_t*)in;
+    const float f = scale / 65535.0f;
+    for (i = 0; i < 4 * n; i++)
+      out[i] = f * s[i];
+    break;
+  }
+  case F0R_COLOR_MODEL_RGBA_FLOAT32: {
+    const float* s = (const float*)in;
+    if (scale == 1.0f) {
+      if (s != out)
+        memcpy(out, s, 4 * n * sizeof(float));
+    } else
+      for (i = 0; i < 4 * n; i++)
+        out[i] = scale * s[i];
+    break;
+  }
+  default: {
+    const uint8_t* s = (const uint8_t*)in;
+    const float f = scale / 255.0f;
+    for (i = 0; i < 4 * n; i++)
+      out[i] = f * s[i];
+    break;
+  }
+  }
+}
+
+/* 4*n floats to n pixels. */
+static inline void f0r_pixels_from_float(const float* in, unsigned int color_model,
+                                         void* out, int n, float scale)
+{
+  int i;
+  switch (color_model) {
+  case F0R_COLOR_MODEL_RGBA16161616: {
+    uint16_t* d = (uint16_t*)out;
+    const float f = 65535.0f / scale;
+    for (i = 0; i < 4 * n; i++) {
+      float v = f * in[i] + 0.5f;
+      d[i] = v <= 0.0f ? 0 : v >= 65535.0f ? 65535 : (uint16_t)v;
+    }
+    break;
+  }
+  case F0R_COLOR_MODEL_RGBA_FLOAT32: {
+    float* d = (float*)out;
+    if (scale == 1.0f) {
+      if (d != in)
+        memcpy(d, in, 4 * n * sizeof(float));
+    } else {
+      const float f = 1.0f / scale;
+      for (i = 0; i < 4 * n; i++)
+        d[i] = f * in[i];
+    }
+    break;
+  }
+  default: {
+    uint8_t* d = (uint8_t*)out;
+    const float f = 255.0f / scale;
+    for (i = 0; i < 4 * n; i++) {
+      float v = f * in[i] + 0.5f;
+      d[i] = v <= 0.0f ? 0 : v >= 255.0f ? 255 : (uint8_t)v;
+    }
+    break;
+  }
+  }
+}
+
+/* Copy the alpha channel of n pixels. */
+static inline void f0r_pixels_copy_alpha(const void* in, void* out,
+                                         unsigned int color_model, int n)
+{
+  const int size = f0r_pixel_size(color_model);
+  const int offset = 3 * size / 4, bytes = size / 4;
+  const uint8_t* s = (const uint8_t*)in + offset;
+  uint8_t* d = (uint8_t*)out + offset;
+  int i;
+  for (i = 0; i < n; i++, s += size, d += size)
+    memcpy(d, s, bytes);
+}
+
+#endif
@@ -0,0 +1,283 @@
+/*
+ * frei0r_registry.h
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INCLUDED_FREI0R_REGISTRY_H
+#define INCLUDED_FREI0R_REGISTRY_H
+
+/*
+  Reading the plugin info cache written by frei0r-registry.
+
+  frei0r-registry DIR stores the f0r_plugin_info_t, all f0r_param_info_t
+  and the capabilities of every plugin below DIR in DIR/frei0r.registry,
+  together with the modification time and size of each plugin file.
+  make install runs it on the installed plugin directory.
+
+  A host loads the cache of each directory of its search path with
+  f0r_registry_load() and lists the effects from it without opening a
+  single plugin.  Before trusting an entry (or at the latest before
+  loading the plugin) it checks f0r_registry_current(); plugins that
+  are missing from the cache or have changed since are queried the
+  usual way.  A missing or unreadable cache makes f0r_registry_load()
+  return 0, which just means querying all plugins.
+
+  The cache is a binary file in the byte order of the machine that wrote
+  it (caches from other machines are rejected):
+
+    "F0RREG01", u32 0x01020304, u32 number of plugins, then per plugin
+    str file (relative to DIR), i64 mtime, i64 size, u32 capabilities,
+    str name, str author, str explanation, i32 plugin_type,
+    i32 color_model, i32 frei0r_version, i32 major_version,
+    i32 minor_version, i32 num_params, then per param
+    str name, i32 type, str explanation
+
+  where a str is a u32 length, the bytes and a terminating 0, or just
+  the length 0xffffffff for a null pointer.
+
+  Everything here is inline, hosts need no library to use it.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "frei0r.h"
+
+#define F0R_REGISTRY_FILE "frei0r.registry"
+#define F0R_REGISTRY_MAGIC "F0RREG01"
+#define F0R_REGISTRY_BOM 0x01020304u
+#define F0R_REGISTRY_NULL 0xffffffffu
+
+typedef struct f0r_registry_plugin
+{
+  const char* file;  /* path relative to the cache directory */
+  const char* path;  /* full path, to stat() or dlopen() */
+  int64_t mtime;     /* of the plugin file when it was queried */
+  int64_t size;
+  unsigned int capabilities; /* 0 if f0r_get_capabilities is not exported */
+  f0r_plugin_info_t info;
+  const f0r_param_info_t* params; /* info.num_params entries */
+} f0r_registry_plugin_t;
+
+typedef struct f0r_registry
+{
+  int count;
+  f0r_registry_plugin_t* plugins;
+  f0r_param_info_t* params;
+  char* data;   /* the file, strings point into it */
+  char* paths;  /* the full paths */
+} f0r_registry_t;
+
+typedef struct f0r_registry_reader
+{
+  char* p;
+  char* end;
+  int ok;
+} f0r_registry_reader_t;
+
+static inline uint32_t f0r_registry_u32(f0r_registry_reader_t* r)
+{
+  uint32_t v = 0;
+  if (r->end - r->p < 4)
+    r->ok = 0;
+  if (!r->ok)
+    return 0;
+  memcpy(&v, r->p, 4);
+  r->p += 4;
+  return v;
+}
+
+static inline int64_t f0r_registry_i64(f0r_registry_reader_t* r)
+{
+  int64_t v = 0;
+  if (r->end - r->p < 8)
+    r->ok = 0;
+  if (!r->ok)
+    return 0;
+  memcpy(&v, r->p, 8);
+  r->p += 8;
+  return v;
+}
+
+static inline const char* f0r_registry_str(f0r_registry_reader_t* r)
+{
+  uint32_t n = f0r_registry_u32(r);
+  char* s = r->p;
+  if (!r->ok || n == F0R_REGISTRY_NULL)
+    return 0;
+  if ((uint64_t)(r->end - r->p) < (uint64_t)n + 1 || s[n] != 0) {
+    r->ok = 0;
+    return 0;
+  }
+  r->p += n + 1;
+  return s;
+}
+
+static inline void f0r_registry_free(f0r_registry_t* reg)
+{
+  if (!reg)
+    return;
+  free(reg->plugins);
+  free(reg->params);
+  free(reg->data);
+  free(reg->paths);
+  free(reg);
+}
+
+/* Load DIR/frei0r.registry, 0 if there is none or it is not valid. */
+static inline f0r_registry_t* f0r_registry_load(const char* dir)
+{
+  f0r_registry_t* reg;
+  f0r_registry_reader_t r;
+  size_t dirlen = strlen(dir), pathlen = 0;
+  long size;
+  char* file;
+  char* q;
+  FILE* f;
+  int i, j, params = 0;
+
+  file = (char*)malloc(dirlen + sizeof(F0R_REGISTRY_FILE) + 1);
+  if (!file)
+    return 0;
+  sprintf(file, "%s/%s", dir, F0R_REGISTRY_FILE);
+  f = fopen(file, "rb");
+  free(file);
+  if (!f)
+    return 0;
+
+  reg = (f0r_registry_t*)calloc(1, sizeof(f0r_registry_t));
+  if (reg && fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 16
+      && fseek(f, 0, SEEK_SET) == 0
+      && (reg->data = (char*)malloc(size)) != 0
+      && fread(reg->data, 1, size, f) == (size_t)size) {
+    r.p = reg->data;
+    r.end = reg->data + size;
+    r.ok = memcmp(r.p, F0R_REGISTRY_MAGIC, 8) == 0;
+    r.p += 8;
+    r.ok = r.ok && f0r_registry_u32(&r) == F0R_REGISTRY_BOM;
+    reg->count = (int)f0r_registry_u32(&r);
+    /* a plugin takes at least 60 bytes */
+    if (reg->count < 0 || reg->count > size / 60)
+      r.ok = 0;
+  } else {
+    r.ok = 0;
+  }
+  fclose(f);
+
+  /* first pass: check the file and count the params and path bytes */
+  if (r.ok) {
+    char* start = r.p;
+    for (i = 0; i < reg->count && r.ok; i++) {
+      const char* name = f0r_registry_str(&r);
+      int n;
+      pathlen += dirlen + (name ? strlen(name) : 0) + 2;
+      f0r_registry_i64(&r);
+      f0r_registry_i64(&r);
+      f0r_registry_u32(&r);
+      f0r_registry_str(&r);
+      f0r_registry_str(&r);
+      f0r_registry_str(&r);
+      for (j = 0; j < 5; j++)
+        f0r_registry_u32(&r);
+      n = (int)f0r_registry_u32(&r);
+      if (!name || n < 0 || n > (r.end - r.p) / 12)
+        r.ok = 0;
+      for (j = 0; j < n && r.ok; j++) {
+        if (!f0r_registry_str(&r))
+          r.ok = 0;
+        f0r_registry_u32(&r);
+        f0r_registry_str(&r);
+      }
+      params += n;
+    }
+    r.p = start;
+  }
+  if (r.ok) {
+    reg->plugins = (f0r_registry_plugin_t*)calloc(reg->count + 1, sizeof(f0r_registry_plugin_t));
+    reg->params = (f0r_param_info_t*)calloc(params + 1, sizeof(f0r_param_info_t));
+    reg->paths = (char*)malloc(pathlen + 1);
+    r.ok = reg->plugins && reg->params && reg->paths;
+  }
+  if (!r.ok) {
+    f0r_registry_free(reg);
+    return 0;
+  }
+
+  /* second pass: fill in the structs */
+  q = reg->paths;
+  params = 0;
+  for (i = 0; i < reg->count; i++) {
+    f0r_registry_plugin_t* p = &reg->plugins[i];
+    f0r_param_info_t* pi = reg->params + params;
+    p->file = f0r_registry_str(&r);
+    if (!p->file) { /* checked in the first pass */
+      f0r_registry_free(reg);
+      return 0;
+    }
+    p->path = q;
+    q += snprintf(q, pathlen + 1 - (q - reg->paths), "%s/%s", dir, p->file) + 1;
+    p->mtime = f0r_registry_i64(&r);
+    p->size = f0r_registry_i64(&r);
+    p->capabilities = f0r_registry_u32(&r);
+    p->info.name = f0r_registry_str(&r);
+    p->info.author = f0r_registry_str(&r);
+    p->info.explanation = f0r_registry_str(&r);
+    p->info.plugin_type = (int)f0r_registry_u32(&r);
+    p->info.color_model = (int)f0r_registry_u32(&r);
+    p->info.frei0r_version = (int)f0r_registry_u32(&r);
+    p->info.major_version = (int)f0r_registry_u32(&r);
+    p->info.minor_version = (int)f0r_registry_u32(&r);
+    p->info.num_params = (int)f0r_registry_u32(&r);
+    for (j = 0; j < p->info.num_params; j++) {
+      pi[j].name = f0r_registry_str(&r);
+      pi[j].type = (int)f0r_registry_u32(&r);
+      pi[j].explanation = f0r_registry_str(&r);
+    }
+    p->params = pi;
+    params += p->info.num_params;
+  }
+  return reg;
+}
+
+/* The entry of a plugin file, given relative to the cache directory. */
+static inline const f0r_registry_plugin_t*
+f0r_registry_find(const f0r_registry_t* reg, const char* file)
+{
+  int i;
+  for (i = 0; reg && i < reg->count; i++)
+    if (strcmp(reg->plugins[i].file, file) == 0)
+      return &reg->plugins[i];
+  return 0;
+}
+
+/* 1 if the plugin file still has the size and modification time it had
+   when it was queried, 0 if it changed or is gone. */
+static inline int f0r_registry_current(const f0r_registry_plugin_t* plugin)
+{
+  struct stat st;
+  if (stat(plugin->path, &st) != 0)
+    return 0;
+  return (int64_t)st.st_mtime == plugin->mtime
+    && (int64_t)st.st_size == plugin->size;
+}
+
+#endif
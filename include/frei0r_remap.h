@@ -0,0 +1,174 @@
+/*
+ * frei0r_remap.h
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INCLUDED_FREI0R_REMAP_H
+#define INCLUDED_FREI0R_REMAP_H
+
+/*
+  Geometric remapping of packed 32 bit frames through a precomputed
+  displacement map.
+
+  The map holds one entry per output pixel: the index of the top left of
+  the four source pixels to blend and the 8 bit fixed point weights of the
+  right and lower neighbours.  Plugins whose geometry only depends on
+  their parameters build the map once with f0r_remap_set() /
+  f0r_remap_clear() and then every frame is a pure gather pass,
+  f0r_remap(), split over all CPUs.
+
+  All four channels are blended at once, with SSE2 where available.  The
+  scalar path rounds the same way, so both give identical frames.
+*/
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "frei0r_thread.h"
+
+typedef struct f0r_remap_entry
+{
+  int32_t offset;  /* top left source pixel, -1 for background */
+  uint16_t fx, fy; /* weights of the right and lower neighbours, 0..256 */
+} f0r_remap_entry_t;
+
+/* Background (no source pixel) for this output pixel. */
+static inline void f0r_remap_clear(f0r_remap_entry_t* e)
+{
+  e->offset = -1;
+  e->fx = e->fy = 0;
+}
+
+/* Sample a w x h source at (x,y), in pixels with pixel centres on
+   integer coordinates; points outside are clamped to the border. */
+static inline void f0r_remap_set(f0r_remap_entry_t* e, int w, int h,
+                                 float x, float y)
+{
+  int xi, yi;
+
+  if (x < 0) x = 0;
+  if (x > w - 1) x = w - 1;
+  if (y < 0) y = 0;
+  if (y > h - 1) y = h - 1;
+
+  /* keep the 2x2 neighbourhood inside the frame */
+  xi = (int)x;
+  yi = (int)y;
+  if (xi > w - 2) xi = w - 2;
+  if (yi > h - 2) yi = h - 2;
+  if (xi < 0) xi = 0;
+  if (yi < 0) yi = 0;
+
+  e->offset = yi * w + xi;
+  e->fx = (uint16_t)((x - xi) * 256.0f + 0.5f);
+  e->fy = (uint16_t)((y - yi) * 256.0f + 0.5f);
+}
+
+static inline uint32_t f0r_remap_bilinear(const uint32_t* in, int w,
+                                          const f0r_remap_entry_t* e)
+{
+  const uint32_t* p = in + e->offset;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i half = _mm_set1_epi32(128);
+  __m128i top = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), zero);
+  __m128i bot = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + w)), zero);
+  __m128i wy = _mm_set1_epi32((e->fy << 16) | (256 - e->fy));
+  __m128i wx = _mm_set1_epi32((e->fx << 16) | (256 - e->fx));
+
+  /* vertical blend of the left and the right column, 4 channels each */
+  __m128i l = _mm_madd_epi16(_mm_unpacklo_epi16(top, bot), wy);
+  __m128i r = _mm_madd_epi16(_mm_unpackhi_epi16(top, bot), wy);
+  l = _mm_srli_epi32(_mm_add_epi32(l, half), 8);
+  r = _mm_srli_epi32(_mm_add_epi32(r, half), 8);
+
+  /* then horizontal */
+  __m128i v = _mm_madd_epi16(_mm_or_si128(l, _mm_slli_epi32(r, 16)), wx);
+  v = _mm_srli_epi32(_mm_add_epi32(v, half), 8);
+  v = _mm_packs_epi32(v, v);
+  return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+#else
+  const uint8_t* p00 = (const uint8_t*)p;
+  const uint8_t* p10 = (const uint8_t*)(p + w);
+  unsigned int fx = e->fx, fy = e->fy;
+  uint32_t v = 0;
+  int c;
+  for (c = 0; c < 4; c++) {
+    unsigned int l = (p00[c] * (256 - fy) + p10[c] * fy + 128) >> 8;
+    unsigned int r = (p00[c + 4] * (256 - fy) + p10[c + 4] * fy + 128) >> 8;
+    v |= ((l * (256 - fx) + r * fx + 128) >> 8) << (8 * c);
+  }
+  return v;
+#endif
+}
+
+/* Gather output rows [first,last) of a wo pixel wide frame. */
+static inline void f0r_remap_rows(const uint32_t* in, int wi, int hi,
+                                  uint32_t* out, int wo, int first, int last,
+                                  const f0r_remap_entry_t* map, uint32_t bg)
+{
+  int i, n = wo * last;
+
+  if (wi < 2 || hi < 2) {
+    /* no 2x2 neighbourhood to blend, f0r_remap_set() left weights at 0 */
+    for (i = wo * first; i < n; i++)
+      out[i] = map[i].offset < 0 ? bg : in[map[i].offset];
+    return;
+  }
+  for (i = wo * first; i < n; i++)
+    out[i] = map[i].offset < 0 ? bg : f0r_remap_bilinear(in, wi, &map[i]);
+}
+
+typedef struct f0r_remap_job
+{
+  const uint32_t* in;
+  int wi, hi;
+  uint32_t* out;
+  int wo;
+  const f0r_remap_entry_t* map;
+  uint32_t bg;
+} f0r_remap_job_t;
+
+static inline void f0r_remap_slice(void* arg, int first, int last, int slice)
+{
+  f0r_remap_job_t* j = (f0r_remap_job_t*)arg;
+  (void)slice;
+  f0r_remap_rows(j->in, j->wi, j->hi, j->out, j->wo, first, last, j->map, j->bg);
+}
+
+/* Remap a whole wo x ho frame, using all CPUs. */
+static inline void f0r_remap(const uint32_t* in, int wi, int hi,
+                             uint32_t* out, int wo, int ho,
+                             const f0r_remap_entry_t* map, uint32_t bg)
+{
+  f0r_remap_job_t job;
+  job.in = in;
+  job.wi = wi;
+  job.hi = hi;
+  job.out = out;
+  job.wo = wo;
+  job.map = map;
+  job.bg = bg;
+  f0r_parallel_for(ho, 16, f0r_remap_slice, &job);
+}
+
+#endif
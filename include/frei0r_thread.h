@@ -0,0 +1,132 @@
+/*
+ * frei0r_thread.h
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INCLUDED_FREI0R_THREAD_H
+#define INCLUDED_FREI0R_THREAD_H
+
+/*
+  Fork/join helper to split a loop over rows (or tiles, or any other
+  independent items) across the CPUs of the machine.
+
+  f0r_parallel_for(n, grain, fn, arg) cuts [0,n) into contiguous slices of
+  at least 'grain' items, runs fn(arg, first, last, slice) for each of
+  them and returns once all slices are done.  Slice 0 runs on the calling
+  thread, so a frame too small to be worth splitting costs no thread at
+  all.  f0r_slice_count() tells in advance how many slices will be used,
+  for plugins that keep per-slice scratch data (e.g. partial histograms).
+
+  The number of threads defaults to the number of online CPUs and can be
+  overridden with the FREI0R_THREADS environment variable; FREI0R_THREADS=1
+  makes every plugin run serially.  Without pthreads everything runs on
+  the calling thread.
+*/
+
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#define F0R_HAVE_PTHREAD
+#endif
+
+#define F0R_MAX_THREADS 64
+
+typedef void (*f0r_slice_fn)(void* arg, int first, int last, int slice);
+
+static inline int f0r_cpu_count(void)
+{
+  static int count = 0;
+  if (count == 0) {
+    int n = 1;
+    const char* env = getenv("FREI0R_THREADS");
+    if (env && atoi(env) > 0)
+      n = atoi(env);
+#if defined(F0R_HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+    else {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      if (cpus > 0)
+        n = (int)cpus;
+    }
+#endif
+    count = n > F0R_MAX_THREADS ? F0R_MAX_THREADS : n;
+  }
+  return count;
+}
+
+static inline int f0r_slice_count(int n, int grain)
+{
+  int slices = f0r_cpu_count();
+  if (grain < 1)
+    grain = 1;
+  if (slices > n / grain)
+    slices = n / grain;
+  return slices < 1 ? 1 : slices;
+}
+
+typedef struct f0r_slice
+{
+  f0r_slice_fn fn;
+  void* arg;
+  int first, last, index;
+} f0r_slice_t;
+
+static inline void* f0r_slice_run(void* p)
+{
+  f0r_slice_t* s = (f0r_slice_t*)p;
+  s->fn(s->arg, s->first, s->last, s->index);
+  return 0;
+}
+
+static inline void f0r_parallel_for(int n, int grain, f0r_slice_fn fn, void* arg)
+{
+  int slices = f0r_slice_count(n, grain);
+  f0r_slice_t s[F0R_MAX_THREADS];
+  int i;
+
+  for (i = 0; i < slices; ++i) {
+    s[i].fn = fn;
+    s[i].arg = arg;
+    s[i].first = (int)((long long)n * i / slices);
+    s[i].last = (int)((long long)n * (i + 1) / slices);
+    s[i].index = i;
+  }
+
+#if defined(F0R_HAVE_PTHREAD)
+  if (slices > 1) {
+    pthread_t tid[F0R_MAX_THREADS];
+    int started[F0R_MAX_THREADS];
+    for (i = 1; i < slices; ++i)
+      started[i] = pthread_create(&tid[i], 0, f0r_slice_run, &s[i]) == 0;
+    f0r_slice_run(&s[0]);
+    for (i = 1; i < slices; ++i) {
+      if (started[i])
+        pthread_join(tid[i], 0);
+      else
+        f0r_slice_run(&s[i]); // could not spawn, do it here
+    }
+    return;
+  }
+#endif
+  for (i = 0; i < slices; ++i)
+    f0r_slice_run(&s[i]);
+}
+
+#endif
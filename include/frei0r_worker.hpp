@@ -0,0 +1,140 @@
+/*
+ * frei0r_worker.hpp
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INCLUDED_FREI0R_WORKER_HPP
+#define INCLUDED_FREI0R_WORKER_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace frei0r
+{
+  /**
+   * A background worker that always processes the most recently
+   * submitted input.
+   *
+   * submit() never blocks on the job: if the worker is still busy the
+   * pending input is simply replaced, so slow jobs drop intermediate
+   * frames instead of stalling the caller.  fetch() hands out the latest
+   * finished result together with the sequence number its input was
+   * submitted with, so the caller can bound how stale it is allowed to be.
+   */
+  template<class In, class Out>
+  class latest_worker
+  {
+  public:
+    typedef std::function<Out (const In&)> job_type;
+
+    explicit latest_worker(const job_type& job)
+      : m_job(job), m_pending(false), m_ready(false), m_busy(false),
+        m_quit(false), m_pending_seq(0), m_result_seq(0),
+        m_thread(&latest_worker::run, this)
+    {
+    }
+
+    ~latest_worker()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+      }
+      m_cond.notify_one();
+      m_thread.join();
+    }
+
+    // queue input for the worker, replacing any input not yet started
+    void submit(In input, unsigned long seq)
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_input = std::move(input);
+        m_pending_seq = seq;
+        m_pending = true;
+      }
+      m_cond.notify_one();
+    }
+
+    // true while a job is running or an input is waiting to be started
+    bool busy()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_busy || m_pending;
+    }
+
+    // take the newest result, if one arrived since the last fetch
+    bool fetch(Out& result, unsigned long& seq)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_ready)
+        return false;
+      result = std::move(m_result);
+      seq = m_result_seq;
+      m_ready = false;
+      return true;
+    }
+
+  private:
+    void run()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (;;) {
+        m_cond.wait(lock, [this] { return m_quit || m_pending; });
+        if (m_quit)
+          return;
+
+        In input = std::move(m_input);
+        unsigned long seq = m_pending_seq;
+        m_pending = false;
+        m_busy = true;
+
+        lock.unlock();
+        Out result = m_job(input);
+        lock.lock();
+
+        m_result = std::move(result);
+        m_result_seq = seq;
+        m_ready = true;
+        m_busy = false;
+      }
+    }
+
+    latest_worker(const latest_worker&);
+    latest_worker& operator=(const latest_worker&);
+
+    job_type m_job;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    In m_input;
+    Out m_result;
+    bool m_pending;
+    bool m_ready;
+    bool m_busy;
+    bool m_quit;
+    unsigned long m_pending_seq;
+    unsigned long m_result_seq;
+    std::thread m_thread;
+  };
+}
+
+#endif
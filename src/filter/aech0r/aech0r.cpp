@@ -112,6 +112,21 @@ private:
 #endif
 public:
 
+  static void describe(frei0r::param_list<aech0r>& params) {
+    params.add(&aech0r::factor, "Fade Factor", "Disappearance rate of the echo"); // 0 No fade, 1 No Trace
+    params.add(&aech0r::bright, "Direction", "Darker or Brighter echo"); // Add or Substract data
+    params.add(&aech0r::flag_r, "Keep RED", "Influence on Red channel"); // 0 Fade canal, 1 Keep canal data
+    params.add(&aech0r::flag_g, "Keep GREEN", "Influence on Green channel"); // 0 Fade canal, 1 Keep canal data
+    params.add(&aech0r::flag_b, "Keep BLUE", "Influence on Blue channel"); // 0 Fade canal, 1 Keep canal data
+    params.add(&aech0r::strobe_period, "Strobe period", "Rate of the stroboscope: from 0 to 8 frames");
+
+    //~ params.add(&aech0r::fade_rgb, "Plans fade", "RGB");  //Fade by color layers
+    //~ params.add(&aech0r::factor_r, "Fade R", "influence"); // 0 No fade, 1 No Trace
+    //~ params.add(&aech0r::factor_g, "Fade G", "influence"); // 0 No fade, 1 No Trace
+    //~ params.add(&aech0r::factor_b, "Fade B", "influence"); // 0 No fade, 1 No Trace
+    //~ params.add(&aech0r::flag_rgb, "Plans comparaison", "RGB");
+  }
+
   aech0r(unsigned int width, unsigned int height) {
 
     factor = 0.15; // Quasi full echo has default
@@ -127,20 +142,6 @@ public:
 
     firsttime = true;
     m_skip_count = 0;
-
-    register_param(factor, "Fade Factor", "Disappearance rate of the echo"); // 0 No fade, 1 No Trace
-    register_param(bright, "Direction", "Darker or Brighter echo"); // Add or Substract data
-    register_param(flag_r, "Keep RED", "Influence on Red channel"); // 0 Fade canal, 1 Keep canal data
-    register_param(flag_g, "Keep GREEN", "Influence on Green channel"); // 0 Fade canal, 1 Keep canal data
-    register_param(flag_b, "Keep BLUE", "Influence on Blue channel"); // 0 Fade canal, 1 Keep canal data
-    register_param(strobe_period, "Strobe period", "Rate of the stroboscope: from 0 to 8 frames");
-
-    //~ register_param(fade_rgb, "Plans fade", "RGB");  //Fade by color layers
-    //~ register_param(factor_r, "Fade R", "influence"); // 0 No fade, 1 No Trace
-    //~ register_param(factor_g, "Fade G", "influence"); // 0 No fade, 1 No Trace
-    //~ register_param(factor_b, "Fade B", "influence"); // 0 No fade, 1 No Trace
-    //~ register_param(flag_rgb, "Plans comparaison", "RGB");
-
   }
   ~aech0r() {
   }
@@ -52,6 +52,7 @@ public:
   virtual void update(double time,
                       uint32_t* out,
                       const uint32_t* in);
+  virtual bool resize(unsigned int new_width, unsigned int new_height);
 
 private:
   ScreenGeometry geo;
@@ -82,6 +83,26 @@ Baltan::~Baltan() {
   free(planebuf);
 }
 
+// scales the planes, so the trails carry over to the new size
+bool Baltan::resize(unsigned int new_width, unsigned int new_height) {
+  int i, old_w = geo.w, old_h = geo.h;
+  uint32_t *newbuf = (uint32_t*)calloc(new_width*new_height*4, PLANES);
+
+  if (!newbuf)
+    return false;
+  for(i=0;i<PLANES;i++)
+    scale_nearest(planetable[i], old_w, old_h,
+                  &newbuf[new_width*new_height*i], new_width, new_height);
+  free(planebuf);
+
+  _init(new_width, new_height);
+  pixels = geo.w*geo.h;
+  planebuf = newbuf;
+  for(i=0;i<PLANES;i++)
+    planetable[i] = &planebuf[pixels*i];
+  return true;
+}
+
 void Baltan::update(double time,
                     uint32_t* out,
                     const uint32_t* in) {
@@ -16,6 +16,8 @@
  *   reference image
  * - whether to remove "noise" (i.e. isolated pixels)
  * - optional blurring of edges
+ * - optionally letting the reference slowly follow the video (running
+ *   average), so that lighting changes do not require a reset
  *
  * Some recommendations:
  * - obviously the background should be of a (really) different color than the
@@ -42,6 +44,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "frei0r.h"
 
 typedef struct bgsubtract0r_instance
@@ -53,6 +59,11 @@ typedef struct bgsubtract0r_instance
   uint32_t* reference; /* The reference image. */
   uint8_t* mask; /* Where the mask is computed. */
   int blur; /* Width of alpha-channel blurring. */
+  int adaptation; /* Background learning rate, in 1/256 per frame. */
+  char selective; /* Only learn where the mask says background. */
+  uint16_t* average; /* Running average of the background, 8.8 fixed point. */
+  uint32_t* rowsum; /* Horizontal box sums of the mask, for blurring. */
+  uint32_t* colsum; /* Vertical running sums of rowsum. */
 } bgsubtract0r_instance_t;
 
 int f0r_init()
@@ -73,7 +84,7 @@ void f0r_get_plugin_info(f0r_plugin_info_t* bgsubtract0r_info)
   bgsubtract0r_info->frei0r_version = FREI0R_MAJOR_VERSION;
   bgsubtract0r_info->major_version = 0;
   bgsubtract0r_info->minor_version = 3;
-  bgsubtract0r_info->num_params =  3;
+  bgsubtract0r_info->num_params =  5;
   bgsubtract0r_info->explanation = "Bluescreen the background of a static video.";
 }
 
@@ -85,8 +96,13 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->denoise = 1;
   inst->blur = 0;
   inst->threshold = 26;
+  inst->adaptation = 0;
+  inst->selective = 1;
   inst->reference = NULL;
+  inst->average = NULL;
   inst->mask = malloc(sizeof(uint8_t)*width*height);
+  inst->rowsum = NULL; /* allocated on the first blurred frame */
+  inst->colsum = NULL;
   return (f0r_instance_t)inst;
 }
 
@@ -94,7 +110,10 @@ void f0r_destruct(f0r_instance_t instance)
 {
   bgsubtract0r_instance_t* inst = (bgsubtract0r_instance_t*)instance;
   free(inst->reference);
+  free(inst->average);
   free(inst->mask);
+  free(inst->rowsum);
+  free(inst->colsum);
   free(inst);
 }
 
@@ -119,6 +138,18 @@ void f0r_get_param_info(f0r_param_info_t* info, int param_index)
     info->type = F0R_PARAM_DOUBLE;
     info->explanation = "Blur alpha channel by given radius (to remove sharp edges)";
     break;
+
+  case 3:
+    info->name = "adaptation";
+    info->type = F0R_PARAM_DOUBLE;
+    info->explanation = "How fast the reference follows the video (0 keeps the first frame)";
+    break;
+
+  case 4:
+    info->name = "selective";
+    info->type = F0R_PARAM_BOOL;
+    info->explanation = "Only adapt the reference where background is seen";
+    break;
   }
 }
 
@@ -140,6 +171,16 @@ void f0r_set_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
   case 2:
     inst->blur = (int)(*((double*)param)+0.5);
     break;
+
+  case 3:
+    inst->adaptation = (int)(*((double*)param) * 256. + 0.5);
+    if (inst->adaptation < 0) inst->adaptation = 0;
+    if (inst->adaptation > 256) inst->adaptation = 256;
+    break;
+
+  case 4:
+    inst->selective = *((double*)param) >= 0.5;
+    break;
   }
 }
 
@@ -161,6 +202,14 @@ void f0r_get_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
   case 2:
     *((double*)param) = inst->blur;
     break;
+
+  case 3:
+    *((double*)param) = (double)inst->adaptation / 256.;
+    break;
+
+  case 4:
+    *((double*)param) = inst->selective ? 1. : 0.;
+    break;
   }
 }
 
@@ -179,6 +228,117 @@ inline static uint8_t dst(uint32_t x, uint32_t y)
   return d;
 }
 
+/* mask[i] = 0xff where the largest channel difference exceeds threshold */
+static void threshold_mask(const uint32_t* ref, const uint32_t* in, uint8_t* mask,
+                           unsigned int len, uint8_t threshold)
+{
+  unsigned int i = 0;
+#if defined(__SSE2__)
+  const __m128i rgb = _mm_set1_epi32(0x00ffffff);
+  const __m128i low = _mm_set1_epi32(0xff);
+  const __m128i thr = _mm_set1_epi8((char)threshold);
+  for (; i+16 <= len; i+=16)
+  {
+    __m128i m[4];
+    int k;
+    for (k=0; k<4; k++)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i*)(ref+i+4*k));
+      __m128i b = _mm_loadu_si128((const __m128i*)(in+i+4*k));
+      /* per byte |a-b|, alpha dropped, then max of r, g, b in the low byte */
+      __m128i d = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a)), rgb);
+      d = _mm_max_epu8(d, _mm_max_epu8(_mm_srli_epi32(d, 8), _mm_srli_epi32(d, 16)));
+      /* d > thr  <=>  saturating d - thr is non zero */
+      d = _mm_and_si128(_mm_subs_epu8(d, thr), low);
+      m[k] = _mm_andnot_si128(_mm_cmpeq_epi32(d, _mm_setzero_si128()), low);
+    }
+    _mm_storeu_si128((__m128i*)(mask+i),
+                     _mm_packus_epi16(_mm_packs_epi32(m[0], m[1]),
+                                      _mm_packs_epi32(m[2], m[3])));
+  }
+#endif
+  for (; i<len; i++)
+    mask[i] = (dst(ref[i], in[i]) > threshold) ? 0xff : 0;
+}
+
+/* Let the reference drift towards the input, at adaptation/256 per frame. */
+static void adapt_reference(bgsubtract0r_instance_t* inst, const uint32_t* inframe)
+{
+  unsigned int len = inst->width * inst->height;
+  int rate = inst->adaptation;
+  uint16_t* avg = inst->average;
+  uint8_t* ref = (uint8_t*)inst->reference;
+  const uint8_t* pi = (const uint8_t*)inframe;
+  unsigned int i;
+  int c;
+
+  for (i=0; i<len; i++, avg+=4, ref+=4, pi+=4)
+  {
+    if (inst->selective && inst->mask[i])
+      continue;
+    for (c=0; c<3; c++)
+    {
+      avg[c] += ((((int)pi[c] << 8) - (int)avg[c]) * rate) >> 8;
+      ref[c] = (avg[c] + 0x80) >> 8;
+    }
+  }
+}
+
+/* Box blur of the mask into the alpha channel, pixels outside the frame
+   counting as opaque.  Horizontal and vertical running sums make the cost
+   independent of the radius. */
+static void blur_mask(bgsubtract0r_instance_t* inst, uint32_t* outframe)
+{
+  int width = inst->width;
+  int height = inst->height;
+  int blur = inst->blur;
+  const uint8_t* mask = inst->mask;
+  uint32_t* rowsum = inst->rowsum;
+  uint32_t* colsum = inst->colsum;
+  unsigned int s = (2*blur+1)*(2*blur+1);
+  unsigned int edge = (2*blur+1)*0xff; /* a whole row outside the frame */
+  int i, j;
+
+  for (j=0; j<height; j++)
+  {
+    const uint8_t* m = mask + width*j;
+    uint32_t* r = rowsum + width*j;
+    uint32_t a = 0;
+    for (i=-blur; i<=blur; i++)
+      a += (i < 0 || i >= width) ? 0xff : m[i];
+    for (i=0; i<width; i++)
+    {
+      r[i] = a;
+      a -= (i-blur < 0) ? 0xff : m[i-blur];
+      a += (i+blur+1 >= width) ? 0xff : m[i+blur+1];
+    }
+  }
+
+  for (i=0; i<width; i++)
+    colsum[i] = 0;
+  for (j=-blur; j<=blur; j++)
+  {
+    if (j < 0 || j >= height)
+      for (i=0; i<width; i++)
+        colsum[i] += edge;
+    else
+      for (i=0; i<width; i++)
+        colsum[i] += rowsum[width*j+i];
+  }
+
+  for (j=0; j<height; j++)
+  {
+    const uint32_t* top = (j-blur < 0) ? NULL : rowsum + width*(j-blur);
+    const uint32_t* bottom = (j+blur+1 >= height) ? NULL : rowsum + width*(j+blur+1);
+    uint8_t* po = (uint8_t*)&outframe[width*j];
+    for (i=0; i<width; i++)
+    {
+      po[4*i+3] = colsum[i] / s;
+      colsum[i] += (bottom ? bottom[i] : edge) - (top ? top[i] : edge);
+    }
+  }
+}
+
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
@@ -187,7 +347,6 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
   unsigned int height = inst->height;
   unsigned int len = width * height;
   uint8_t *mask = inst->mask;
-  int blur = inst->blur;
   int i;
   int j;
   int n;
@@ -202,27 +361,49 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
     memset(mask, 0, sizeof(uint8_t)*len);
   }
   else
-  {
-    for (i=0; i<len; i++)
-      mask[i] = (dst(inst->reference[i], inframe[i]) > inst->threshold) ? 0xff : 0;
-  }
+    threshold_mask(inst->reference, inframe, mask, len, inst->threshold);
 
   /* Clean up the mask. */
   if (inst->denoise)
     for (j=1; j<height-1; j++)
+    {
+      uint8_t* up = mask + width*(j-1);
+      uint8_t* row = mask + width*j;
+      uint8_t* down = mask + width*(j+1);
       for (i=1; i<width-1; i++)
       {
-        n = (mask[width*j+i-1]+mask[width*j+i+1]+mask[width*(j-1)+i]+mask[width*(j+1)+i]
-             + mask[width*(j-1)+i-1]+mask[width*(j-1)+i+1]+mask[width*(j+1)+i-1]+mask[width*(j+1)+i+1])/0xff;
-        if (mask[width*j+i])
+        n = (row[i-1]+row[i+1]+up[i]+down[i]
+             + up[i-1]+up[i+1]+down[i-1]+down[i+1])/0xff;
+        if (row[i])
         {
-          if (n<=2) mask[width*j+i] = 0;
+          if (n<=2) row[i] = 0;
         }
         else
         {
-          if (n>=6) mask[width*j+i] = 0xff;
+          if (n>=6) row[i] = 0xff;
         }
       }
+    }
+
+  if (inst->adaptation)
+  {
+    if (!inst->average)
+    {
+      uint8_t* pr = (uint8_t*)inst->reference;
+      unsigned int k;
+      inst->average = malloc(sizeof(uint16_t)*4*len);
+      if (inst->average)
+        for (k=0; k<4*len; k++)
+          inst->average[k] = pr[k] << 8;
+    }
+    if (inst->average)
+      adapt_reference(inst, inframe);
+  }
+  else if (inst->average)
+  {
+    free(inst->average);
+    inst->average = NULL;
+  }
 
   for (i=0; i<len; i++)
     {
@@ -234,31 +415,14 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
       po[3] = mask[i];
     }
 
-  if (blur)
+  if (inst->blur)
   {
-    int ii, jj;
-    int di, dj;
-    unsigned int a;
-    // Number of pixels in the surface
-    unsigned int s = (2*blur+1)*(2*blur+1);
-
-    for (j=0; j<height; j++)
-      for (i=0; i<width; i++)
-      {
-        a = 0;
-        for (dj=-blur; dj<=blur; dj++)
-          for (di=-blur; di<=blur; di++)
-          {
-            ii = i+di;
-            jj = j+dj;
-            if (ii < 0 || ii >= width || jj < 0 || jj >= height)
-              a += 0xff;
-            else
-              a += mask[width*jj+ii];
-          }
-        a /= s;
-        po = (uint8_t*)&outframe[width*j+i];
-        po[3] = a;
-      }
+    if (!inst->rowsum)
+    {
+      inst->rowsum = malloc(sizeof(uint32_t)*len);
+      inst->colsum = malloc(sizeof(uint32_t)*width);
+    }
+    if (inst->rowsum && inst->colsum)
+      blur_mask(inst, outframe);
   }
 }
@@ -50,6 +50,12 @@ private:
 		return (uint32_t) d; // no sqrtf
 	}
 public:
+	static void describe(frei0r::param_list<bluescreen0r>& params)
+	{
+		params.add(&bluescreen0r::color,  "Color",    "The color to make transparent (B G R)");
+		params.add(&bluescreen0r::dist, "Distance", "Distance to Color (127 is good)");
+	}
+
 	bluescreen0r(unsigned int width, unsigned int height)
 	{
 		dist = 0.288;
@@ -57,9 +63,6 @@ public:
 		color.r = 0;
 		color.g = 0.94;
 		color.b = 0;
-		
-		register_param(color,  "Color",    "The color to make transparent (B G R)");
-		register_param(dist, "Distance", "Distance to Color (127 is good)");
 	}
 
 	virtual void update(double time,
@@ -31,6 +31,7 @@ Copyright (C) 2011  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 //stdio samo za debug izpise
 //#include <stdio.h>
 #include <frei0r.h>
+#include "frei0r_pixel.h"
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
@@ -62,6 +63,7 @@ typedef struct
     float am;	//amount of blur
     int ty;		//type of blur [0..2]
     int ec;		//edge compensation (BOOL)
+    unsigned int model;	//frei0r color model of the frames
 
     //video buffers
     float_rgba *img;
@@ -170,6 +172,12 @@ void f0r_get_plugin_info(f0r_plugin_info_t* info)
     info->explanation="Three types of fast IIR blurring";
 }
 
+//--------------------------------------------------
+unsigned int f0r_get_capabilities(void)
+{
+    return F0R_CAP_RGBA16161616 | F0R_CAP_RGBA_FLOAT32;
+}
+
 //--------------------------------------------------
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
@@ -208,6 +216,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
     in->a1=-0.796093; in->a2=0.186308;
     in->ty=1;
     in->ec=1;
+    in->model=F0R_COLOR_MODEL_RGBA8888;
 
     return (f0r_instance_t)in;
 }
@@ -340,6 +349,45 @@ void f0r_get_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
     }
 }
 
+//--------------------------------------------------
+int f0r_set_color_model(f0r_instance_t instance, unsigned int color_model)
+{
+    inst *in;
+
+    in=(inst*)instance;
+    if (!f0r_pixel_model_ok(color_model, f0r_get_capabilities())) return 0;
+    in->model=color_model;
+    return 1;
+}
+
+//-------------------------------------------------
+//16 bit and float frames: the filters run on in->img alone,
+//without going through 8 bits
+void update_hdr(inst *in, const uint32_t* inframe, uint32_t* outframe)
+{
+    int i,n;
+
+    n=in->w*in->h;
+    f0r_pixels_to_float(inframe, in->model, (float*)in->img, n, 255.0);
+    switch(in->ty)
+    {
+    case 0:
+        fibe1o_8(NULL, NULL, in->img, in->w, in->h, in->a1, in->ec);
+        break;
+    case 1:
+        fibe2o_8(NULL, NULL, in->img, in->w, in->h, in->a1, in->a2, in->rd1, in->rd2, in->rs1, in->rs2, in->rc1, in->rc2, in->ec);
+        break;
+    case 2:
+        fibe3_8(NULL, NULL, in->img, in->w, in->h, in->a1, in->a2, in->a3, in->ec);
+        //same bottom lines as the 8 bit path
+        for (i = 0; i < 3; i++)
+            memcpy(&in->img[in->w * (in->h - 3 + i)], &in->img[in->w * (in->h - 4)], in->w * sizeof(float_rgba));
+        break;
+    }
+    f0r_pixels_from_float((float*)in->img, in->model, outframe, n, 255.0);
+    f0r_pixels_copy_alpha(inframe, outframe, in->model, n);
+}
+
 //-------------------------------------------------
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
 {
@@ -351,7 +399,12 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 
     if (in->am==0.0)	//zero blur, just copy and return
     {
-        memcpy(outframe, inframe, in->w * in->h * sizeof(uint32_t));
+        memcpy(outframe, inframe, in->w * in->h * f0r_pixel_size(in->model));
+        return;
+    }
+    if (in->model!=F0R_COLOR_MODEL_RGBA8888)
+    {
+        update_hdr(in, inframe, outframe);
         return;
     }
     //do the blur
@@ -59,6 +59,9 @@ The functions work internally with floats. I have included
 the 8bit/float conversion into the first and last
 processing loops, to avoid two additional cache polluting
 and therefore time consuming "walks" through memory.
+With inframe and outframe set to NULL, s holds the input
+(in the 0..255 range) on entry and the result on return,
+for frames that are not 8 bit.
 
 */
 
@@ -71,6 +74,26 @@ and therefore time consuming "walks" through memory.
 #include <string.h>
 #include "frei0r_math.h"
 
+//---------------------------------------------------------
+//one 8 bit pixel into the float buffer
+//(no inframe: s already holds the input)
+static inline void fibe_load(float_rgba *s, const uint32_t* inframe, int k)
+{
+    if (inframe==NULL) return;
+    s[k].r=(float)(inframe[k]&0xFF);
+    s[k].g=(float)((inframe[k]&0xFF00)>>8);
+    s[k].b=(float)((inframe[k]&0xFF0000)>>16);
+}
+
+//---------------------------------------------------------
+//one pixel of the float buffer into the 8 bit frame
+//(no outframe: the result stays in s)
+static inline void fibe_store(uint32_t* outframe, const float_rgba *s, int k)
+{
+    if (outframe==NULL) return;
+    outframe[k]=((uint32_t)s[k].r&0xFF) + (((uint32_t)s[k].g&0xFF)<<8) + (((uint32_t)s[k].b&0xFF)<<16);
+}
+
 //---------------------------------------------------------
 //koeficienti za biquad lowpass  iz f in q
 // f v Nyquistih    0.0 < f < 0.5
@@ -168,9 +191,7 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
             cr=0.0;cg=0.0;cb=0.0;
             for (j=0;j<avg;j++)
             {
-                s[p+j].r=(float)(inframe[p+j]&0xFF);
-                s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-                s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
+                fibe_load(s, inframe, p+j);
                 cr=cr+s[p+j].r;
                 cg=cg+s[p+j].g;
                 cb=cb+s[p+j].b;
@@ -183,9 +204,7 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
         else
             for (j=0;j<avg;j++)
             {
-                s[p+j].r=(float)(inframe[p+j]&0xFF);
-                s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-                s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
+                fibe_load(s, inframe, p+j);
             }
 
         for (j=1;j<avg;j++)	//tja  (ze pretvorjeni)
@@ -196,9 +215,7 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
         }
         for (j=avg;j<w;j++)	//tja  (s pretvorbo)
         {
-            s[p+j].r=(float)(inframe[p+j]&0xFF);
-            s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-            s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
+            fibe_load(s, inframe, p+j);
             s[p+j].r=s[p+j].r+a*s[p+j-1].r;
             s[p+j].g=s[p+j].g+a*s[p+j-1].g;
             s[p+j].b=s[p+j].b+a*s[p+j-1].b;
@@ -265,9 +282,7 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
             cr=0.0;cg=0.0;cb=0.0;
             for (j=0;j<avg;j++)
             {
-                s[p+j].r=(float)(inframe[p+j]&0xFF);
-                s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-                s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
+                fibe_load(s, inframe, p+j);
                 cr=cr+s[p+j].r;
                 cg=cg+s[p+j].g;
                 cb=cb+s[p+j].b;
@@ -279,9 +294,7 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
             cr=0.0;cg=0.0;cb=0.0;
             for (j=0;j<avg;j++)
             {
-                s[pw+j].r=(float)(inframe[pw+j]&0xFF);
-                s[pw+j].g=(float)((inframe[pw+j]&0xFF00)>>8);
-                s[pw+j].b=(float)((inframe[pw+j]&0xFF0000)>>16);
+                fibe_load(s, inframe, pw+j);
                 cr=cr+s[pw+j].r;
                 cg=cg+s[pw+j].g;
                 cb=cb+s[pw+j].b;
@@ -295,15 +308,11 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
         {
             for (j=0;j<avg;j++)
             {
-                s[p+j].r=(float)(inframe[p+j]&0xFF);
-                s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-                s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
+                fibe_load(s, inframe, p+j);
             }
             for (j=0;j<avg;j++)
             {
-                s[pw+j].r=(float)(inframe[pw+j]&0xFF);
-                s[pw+j].g=(float)((inframe[pw+j]&0xFF00)>>8);
-                s[pw+j].b=(float)((inframe[pw+j]&0xFF0000)>>16);
+                fibe_load(s, inframe, pw+j);
             }
         }
         for (j=1;j<avg;j++)	//tja  (ze pretvojeni)
@@ -319,15 +328,11 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
         for (j=avg;j<w;j++)	//tja  (s pretvorbo)
         {
             pj=p+j;pwj=pw+j;
-            s[pj].r=(float)(inframe[pj]&0xFF);
-            s[pj].g=(float)((inframe[pj]&0xFF00)>>8);
-            s[pj].b=(float)((inframe[pj]&0xFF0000)>>16);
+            fibe_load(s, inframe, pj);
             s[pj].r=s[pj].r+a*s[pj-1].r;
             s[pj].g=s[pj].g+a*s[pj-1].g;
             s[pj].b=s[pj].b+a*s[pj-1].b;
-            s[pwj].r=(float)(inframe[pwj]&0xFF);
-            s[pwj].g=(float)((inframe[pwj]&0xFF00)>>8);
-            s[pwj].b=(float)((inframe[pwj]&0xFF0000)>>16);
+            fibe_load(s, inframe, pwj);
             s[pwj].r=s[pwj].r+a*s[pwj-1].r;
             s[pwj].g=s[pwj].g+a*s[pwj-1].g;
             s[pwj].b=s[pwj].b+a*s[pwj-1].b;
@@ -461,7 +466,7 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
             s[i+p].r=g4a*cr+g4b*(s[i+p].r-cr);
             s[i+p].g=g4a*cg+g4b*(s[i+p].g-cg);
             s[i+p].b=g4a*cb+g4b*(s[i+p].b-cb);
-            outframe[p+i]=((uint32_t)s[p+i].r&0xFF) + (((uint32_t)s[p+i].g&0xFF)<<8) + (((uint32_t)s[p+i].b&0xFF)<<16);
+            fibe_store(outframe, s, p+i);
         }
     }
     else
@@ -471,7 +476,7 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
             s[j+p].r=g4b*s[j+p].r;	//rep V
             s[j+p].g=g4b*s[j+p].g;
             s[j+p].b=g4b*s[j+p].b;
-            outframe[p+j]=((uint32_t)s[p+j].r&0xFF) + (((uint32_t)s[p+j].g&0xFF)<<8) + (((uint32_t)s[p+j].b&0xFF)<<16);
+            fibe_store(outframe, s, p+j);
         }
     }
 
@@ -483,7 +488,7 @@ void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w,
             s[p+j].r=a*s[pw+j].r+g4*s[p+j].r;
             s[p+j].g=a*s[pw+j].g+g4*s[p+j].g;
             s[p+j].b=a*s[pw+j].b+g4*s[p+j].b;
-            outframe[p+j]=((uint32_t)s[p+j].r&0xFF) + (((uint32_t)s[p+j].g&0xFF)<<8) + (((uint32_t)s[p+j].b&0xFF)<<16);
+            fibe_store(outframe, s, p+j);
         }
     }
 
@@ -515,9 +520,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
         {	//edge comp (popvprecje prvih)
             for (i=0;i<avg;i++)
             {
-                s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-                s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-                s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, jw+i);
                 cr=cr+s[jw+i].r;
                 cg=cg+s[jw+i].g;
                 cb=cb+s[jw+i].b;
@@ -527,9 +530,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
         else
             for (i=0;i<avg;i++)
             {
-                s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-                s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-                s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, jw+i);
             }
 
         s[jw].r=g4*s[jw].r-(a1+a2)*g*cr;
@@ -544,9 +545,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
             cr=0.0;cg=0.0;cb=0.0;
             for (i=w-avg;i<w;i++)
             {
-                s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-                s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-                s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, jw+i);
                 cr=cr+s[jw+i].r;
                 cg=cg+s[jw+i].g;
                 cb=cb+s[jw+i].b;
@@ -556,9 +555,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
         else
             for (i=w-avg;i<w;i++)
             {
-                s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-                s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-                s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, jw+i);
             }
 
         for (i=2;i<avg;i++)	//tja (ze pretv. levo)
@@ -570,9 +567,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
 
         for (i=avg;i<w-avg;i++)	//tja (s pretvorbo)
         {
-            s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-            s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-            s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+            fibe_load(s, inframe, jw+i);
             s[jw+i].r=g4*s[jw+i].r-a1*s[jw+i-1].r-a2*s[jw+i-2].r;
             s[jw+i].g=g4*s[jw+i].g-a1*s[jw+i-1].g-a2*s[jw+i-2].g;
             s[jw+i].b=g4*s[jw+i].b-a1*s[jw+i-1].b-a2*s[jw+i-2].b;
@@ -661,9 +656,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
         {	//edge comp (popvprecje prvih)
             for (i=0;i<avg;i++)
             {
-                s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-                s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-                s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, jw+i);
                 cr=cr+s[jw+i].r;
                 cg=cg+s[jw+i].g;
                 cb=cb+s[jw+i].b;
@@ -673,9 +666,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
         else
             for (i=0;i<avg;i++)
             {
-                s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-                s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-                s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, jw+i);
             }
         s[jw].r=g4*s[jw].r-(a1+a2)*g*cr;
         s[jw].g=g4*s[jw].g-(a1+a2)*g*cg;
@@ -689,9 +680,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
             cr=0.0;cg=0.0;cb=0.0;
             for (i=w-avg;i<w;i++)
             {
-                s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-                s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-                s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, jw+i);
                 cr=cr+s[jw+i].r;
                 cg=cg+s[jw+i].g;
                 cb=cb+s[jw+i].b;
@@ -701,9 +690,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
         else
             for (i=w-avg;i<w;i++)
             {
-                s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-                s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-                s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, jw+i);
             }
 
         for (i=2;i<avg;i++)	//tja  (ze pretv. levo)
@@ -715,9 +702,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
 
         for (i=avg;i<w-avg;i++)	//tja  (s retvorbo)
         {
-            s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-            s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-            s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+            fibe_load(s, inframe, jw+i);
             s[jw+i].r=g4*s[jw+i].r-a1*s[jw+i-1].r-a2*s[jw+i-2].r;
             s[jw+i].g=g4*s[jw+i].g-a1*s[jw+i-1].g-a2*s[jw+i-2].g;
             s[jw+i].b=g4*s[jw+i].b-a1*s[jw+i-1].b-a2*s[jw+i-2].b;
@@ -818,7 +803,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
         if (s[j+h1w].g<0.0) s[j+h1w].g=0.0;
         if (s[j+h1w].b>255) s[j+h1w].b=255.0;
         if (s[j+h1w].b<0.0) s[j+h1w].b=0.0;
-        outframe[j+h1w]=((uint32_t)s[j+h1w].r&0xFF) + (((uint32_t)s[j+h1w].g&0xFF)<<8) + (((uint32_t)s[j+h1w].b&0xFF)<<16);
+        fibe_store(outframe, s, j+h1w);
         s[j+h2w].r=s[j+h2w].r-a1*s[j+h1w].r-a2*rep1.r;
         s[j+h2w].g=s[j+h2w].g-a1*s[j+h1w].g-a2*rep1.g;
         s[j+h2w].b=s[j+h2w].b-a1*s[j+h1w].b-a2*rep1.b;
@@ -828,7 +813,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
         if (s[j+h2w].g<0.0) s[j+h2w].g=0.0;
         if (s[j+h2w].b>255) s[j+h2w].b=255.0;
         if (s[j+h2w].b<0.0) s[j+h2w].b=0.0;
-        outframe[j+h2w]=((uint32_t)s[j+h2w].r&0xFF) + (((uint32_t)s[j+h2w].g&0xFF)<<8) + (((uint32_t)s[j+h2w].b&0xFF)<<16);
+        fibe_store(outframe, s, j+h2w);
     }
 
     //ostale vrstice
@@ -846,7 +831,7 @@ void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w
             if (s[j+iw].g<0.0) s[j+iw].g=0.0;
             if (s[j+iw].b>255) s[j+iw].b=255.0;
             if (s[j+iw].b<0.0) s[j+iw].b=0.0;
-            outframe[j+iw]=((uint32_t)s[j+iw].r&0xFF) + (((uint32_t)s[j+iw].g&0xFF)<<8) + (((uint32_t)s[j+iw].b&0xFF)<<16);
+            fibe_store(outframe, s, j+iw);
         }
     }
 
@@ -874,9 +859,7 @@ void fibe3_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w,
         {	//edge comp (popvprecje prvih)
             for (i=0;i<avg;i++)
             {
-                s[j*w+i].r=(float)(inframe[j*w+i]&0xFF);
-                s[j*w+i].g=(float)((inframe[j*w+i]&0xFF00)>>8);
-                s[j*w+i].b=(float)((inframe[j*w+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, j*w+i);
                 cr=cr+s[j*w+i].r;
                 cg=cg+s[j*w+i].g;
                 cb=cb+s[j*w+i].b;
@@ -886,9 +869,7 @@ void fibe3_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w,
         else
             for (i=0;i<avg;i++)
             {
-                s[j*w+i].r=(float)(inframe[j*w+i]&0xFF);
-                s[j*w+i].g=(float)((inframe[j*w+i]&0xFF00)>>8);
-                s[j*w+i].b=(float)((inframe[j*w+i]&0xFF0000)>>16);
+                fibe_load(s, inframe, j*w+i);
             }
         lb[0].r=g4*s[j*w].r-(a1+a2+a3)*g*cr;
         lb[0].g=g4*s[j*w].g-(a1+a2+a3)*g*cg;
@@ -909,9 +890,7 @@ void fibe3_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w,
 
         for (i=avg;i<w;i++)	//tja  (s pretvorbo)
         {
-            s[j*w+i].r=(float)(inframe[j*w+i]&0xFF);
-            s[j*w+i].g=(float)((inframe[j*w+i]&0xFF00)>>8);
-            s[j*w+i].b=(float)((inframe[j*w+i]&0xFF0000)>>16);
+            fibe_load(s, inframe, j*w+i);
             lb[i].r=g4*s[j*w+i].r-a1*lb[i-1].r-a2*lb[i-2].r-a3*lb[i-3].r;
             lb[i].g=g4*s[j*w+i].g-a1*lb[i-1].g-a2*lb[i-2].g-a3*lb[i-3].g;
             lb[i].b=g4*s[j*w+i].b-a1*lb[i-1].b-a2*lb[i-2].b-a3*lb[i-3].b;
@@ -1044,7 +1023,7 @@ void fibe3_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w,
             s[j+w*i].r=lb[i].r-a1*s[j+w*(i+1)].r-a2*s[j+w*(i+2)].r-a3*s[j+w*(i+3)].r;
             s[j+w*i].g=lb[i].g-a1*s[j+w*(i+1)].g-a2*s[j+w*(i+2)].g-a3*s[j+w*(i+3)].g;
             s[j+w*i].b=lb[i].b-a1*s[j+w*(i+1)].b-a2*s[j+w*(i+2)].b-a3*s[j+w*(i+3)].b;
-            outframe[j+w*i]=((uint32_t)s[j+w*i].r&0xFF) + (((uint32_t)s[j+w*i].g&0xFF)<<8) + (((uint32_t)s[j+w*i].b&0xFF)<<16);
+            fibe_store(outframe, s, j+w*i);
         }
     }	//po stolpcih
 
@@ -811,6 +811,36 @@ void f0r_destruct(f0r_instance_t instance)
 	free(instance);
 }
 
+//---------------------------------------------------
+//keeps the parameters, the maps are made again for the new size
+int f0r_resize(f0r_instance_t instance, unsigned int width, unsigned int height)
+{
+	inst *p;
+	float *map;
+	unsigned char *amap;
+
+	p=(inst*)instance;
+
+	map=(float*)calloc(1, sizeof(float)*(width*height*2+2));
+	amap=(unsigned char*)calloc(1, sizeof(char)*(width*height*2+2));
+	if ((map==NULL)||(amap==NULL))
+	{
+		free(map);
+		free(amap);
+		return 0;
+	}
+
+	free(p->map);
+	free(p->amap);
+	p->map=map;
+	p->amap=amap;
+	p->w=width;
+	p->h=height;
+	p->mapIsDirty=1;
+
+	return 1;
+}
+
 //-----------------------------------------------------
 void f0r_set_param_value(f0r_instance_t instance, f0r_param_t parm, int param_index)
 {
@@ -57,10 +57,13 @@ public:
   double triplevel;
   double diffspace;
 
+  static void describe(frei0r::param_list<Cartoon>& params) {
+    params.add(&Cartoon::triplevel, "triplevel", "level of trip: mapped to [0,1] asymptotical");
+    params.add(&Cartoon::diffspace, "diffspace", "difference space: a value from 0 to 256 (mapped to [0,1])");
+  }
+
   Cartoon(unsigned int width, unsigned int height) {
     int c;
-    register_param(triplevel, "triplevel", "level of trip: mapped to [0,1] asymptotical");
-    register_param(diffspace, "diffspace", "difference space: a value from 0 to 256 (mapped to [0,1])");
 
     geo = new ScreenGeometry();
     geo->w = width;
@@ -82,6 +82,7 @@
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef __SSE2__
 #include <emmintrin.h>
@@ -89,6 +90,7 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_pixel.h"
 
 enum ParamIndex {
 	NEUTRAL_COLOR,
@@ -104,6 +106,10 @@ typedef struct colgate_instance
 	unsigned height;
 	f0r_param_color_t neutral_color;
 	double color_temperature;
+	unsigned color_model;
+
+	// The correction matrix in floating point, for 16 bit and float frames.
+	Matrix3x3 corr_matrix;
 
 #ifdef __SSE2__
 	__m128i premult_r[256];
@@ -160,6 +166,57 @@ static void fill_srgb_lut()
 	}
 }
 
+/*
+ * 16 bit and float frames are converted in floating point all the way,
+ * through tables of both transfer functions over [0..1] that are
+ * interpolated linearly; with 16k entries the error stays well below
+ * one 16-bit step. Values outside [0..1] (extended range float frames)
+ * take the exact, slow path.
+ */
+#define FLOAT_LUT_BITS 14
+#define FLOAT_LUT_SIZE (1 << FLOAT_LUT_BITS)
+
+static float srgb_to_linear_float_lut[FLOAT_LUT_SIZE + 2];
+static float linear_to_srgb_float_lut[FLOAT_LUT_SIZE + 2];
+
+static void fill_float_luts()
+{
+	int i;
+	for (i = 0; i <= FLOAT_LUT_SIZE; ++i) {
+		float x = i / (float)FLOAT_LUT_SIZE;
+		srgb_to_linear_float_lut[i] = convert_srgb_to_linear_rgb(255.0f * x);
+		linear_to_srgb_float_lut[i] = convert_linear_rgb_to_srgb(x) * (1.0f / 255.0f);
+	}
+	// so that x = 1.0 can interpolate with a zero weight
+	srgb_to_linear_float_lut[FLOAT_LUT_SIZE + 1] = srgb_to_linear_float_lut[FLOAT_LUT_SIZE];
+	linear_to_srgb_float_lut[FLOAT_LUT_SIZE + 1] = linear_to_srgb_float_lut[FLOAT_LUT_SIZE];
+}
+
+static inline float lookup_float_lut(const float *lut, float x)
+{
+	float f = x * (float)FLOAT_LUT_SIZE;
+	int i = (int)f;
+	f -= i;
+	return lut[i] + f * (lut[i + 1] - lut[i]);
+}
+
+// Both normalized.
+static inline float convert_srgb_to_linear_rgb_float(float x)
+{
+	if (x >= 0.0f && x <= 1.0f) {
+		return lookup_float_lut(srgb_to_linear_float_lut, x);
+	}
+	return convert_srgb_to_linear_rgb(255.0f * x);
+}
+
+static inline float convert_linear_rgb_to_srgb_float(float x)
+{
+	if (x >= 0.0f && x <= 1.0f) {
+		return lookup_float_lut(linear_to_srgb_float_lut, x);
+	}
+	return convert_linear_rgb_to_srgb(x) * (1.0f / 255.0f);
+}
+
 // Multiply two 3x3 matrices.
 static void multiply_3x3_matrices(const Matrix3x3 a, const Matrix3x3 b, Matrix3x3 result)
 {
@@ -355,6 +412,7 @@ static void compute_correction_matrix(colgate_instance_t *o)
 	multiply_3x3_matrices(temp, lms_scale_matrix, temp2);
 	multiply_3x3_matrices(temp2, xyz_to_lms_matrix, temp);
 	multiply_3x3_matrices(temp, rgb_to_xyz_matrix, corr_matrix);
+	memcpy(o->corr_matrix, corr_matrix, sizeof(Matrix3x3));
 
 	// Scale for fixed-point, and clamp. We clamp the matrix elements
 	// instead of the actual fixed-point numbers below, to make sure
@@ -411,6 +469,7 @@ static void compute_correction_matrix(colgate_instance_t *o)
 int f0r_init()
 {
 	fill_srgb_lut();
+	fill_float_luts();
 	return 1;
 }
 
@@ -431,6 +490,11 @@ void f0r_get_plugin_info(f0r_plugin_info_t *colordistance_info)
 	colordistance_info->explanation = "Do simple color correction, in a physically meaningful way";
 }
 
+unsigned int f0r_get_capabilities(void)
+{
+	return F0R_CAP_INPLACE | F0R_CAP_RGBA16161616 | F0R_CAP_RGBA_FLOAT32;
+}
+
 void f0r_get_param_info(f0r_param_info_t *info, int param_index)
 {
 	switch (param_index) {
@@ -458,6 +522,7 @@ f0r_instance_t f0r_construct(unsigned width, unsigned height)
 	inst->neutral_color.g = 0.5;
 	inst->neutral_color.b = 0.5;
 	inst->color_temperature = 6500.0;
+	inst->color_model = F0R_COLOR_MODEL_RGBA8888;
 	compute_correction_matrix(inst);
 	return (f0r_instance_t)inst;
 }
@@ -506,6 +571,45 @@ void f0r_get_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
 	}
 }
 
+int f0r_set_color_model(f0r_instance_t instance, unsigned color_model)
+{
+	assert(instance);
+	colgate_instance_t *inst = (colgate_instance_t *)instance;
+
+	if (!f0r_pixel_model_ok(color_model, f0r_get_capabilities())) {
+		return 0;
+	}
+	inst->color_model = color_model;
+	return 1;
+}
+
+static void update_float(colgate_instance_t *inst, const uint32_t *inframe, uint32_t *outframe)
+{
+	unsigned len = inst->width * inst->height;
+	unsigned i;
+
+	// Float frames are converted right in the output frame.
+	float *pixels = (inst->color_model == F0R_COLOR_MODEL_RGBA_FLOAT32) ?
+		(float *)outframe : (float *)malloc(len * 4 * sizeof(float));
+	float *p = pixels;
+
+	f0r_pixels_to_float(inframe, inst->color_model, pixels, len, 1.0f);
+	for (i = 0; i < len; ++i, p += 4) {
+		float r = convert_srgb_to_linear_rgb_float(p[0]);
+		float g = convert_srgb_to_linear_rgb_float(p[1]);
+		float b = convert_srgb_to_linear_rgb_float(p[2]);
+		multiply_3x3_matrix_float3(inst->corr_matrix, r, g, b, &r, &g, &b);
+		p[0] = convert_linear_rgb_to_srgb_float(r);
+		p[1] = convert_linear_rgb_to_srgb_float(g);
+		p[2] = convert_linear_rgb_to_srgb_float(b);
+		// Alpha is left alone.
+	}
+	f0r_pixels_from_float(pixels, inst->color_model, outframe, len, 1.0f);
+	if (pixels != (float *)outframe) {
+		free(pixels);
+	}
+}
+
 void f0r_update(f0r_instance_t instance, double time, const uint32_t *inframe, uint32_t *outframe)
 {
 	assert(instance);
@@ -515,6 +619,11 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t *inframe, u
 	const unsigned char *src = (unsigned char *)inframe;
 	unsigned i;
 
+	if (inst->color_model != F0R_COLOR_MODEL_RGBA8888) {
+		update_float(inst, inframe, outframe);
+		return;
+	}
+
 #ifdef __SSE2__
 	__m128i zero = _mm_setzero_si128();
 	__m128i max = _mm_set1_epi16(REVERSE_LUT_SIZE - 1);
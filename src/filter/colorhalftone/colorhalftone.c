@@ -26,8 +26,13 @@
 #include <assert.h>
 #include <stdio.h>
 #include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_thread.h"
 
 double PI=3.14159265358979;
 
@@ -39,6 +44,7 @@ typedef struct colorhalftone_instance
   double cyan_angle;
   double magenta_angle;
   double yellow_angle;
+  int fast;
 } colorhalftone_instance_t;
 
 static inline double degreeToRadian(double degree)
@@ -94,6 +100,9 @@ void color_halftone(f0r_instance_t instance, double time,
 
   for (y = 0; y < height; y++)
   {
+    // the channels below are and-ed in, start from white
+    for (x = 0; x < width; x++)
+      dst[x] = 0xffffffff;
 
     for (channel = 0; channel < 3; channel++ )
     {
@@ -155,6 +164,240 @@ void color_halftone(f0r_instance_t instance, double time,
   }
 }
 
+/*
+ * Fast variant: the same screens, evaluated in single precision.
+ *
+ * Rotation preserves distances, so the distance to a dot can be measured
+ * in screen space and nothing needs to be rotated back per pixel.  The
+ * dot centres only depend on the grid, so their radii are computed once
+ * per frame into a lattice (one per channel), through a lookup table
+ * from channel level to radius.  Each pixel then looks at its own dot
+ * and at the one neighbour across the nearest cell edge, which is the
+ * only one that can reach it.
+ */
+
+typedef struct halftone_screen
+{
+  float cs, sn;   // rotation, in grid cells per pixel
+  float grid;     // grid size in pixels
+  int kx0, ky0;   // lattice index of the first entry
+  int nx, ny;     // lattice size
+  float* radius;  // dot radius in pixels at each lattice point
+} halftone_screen_t;
+
+typedef struct halftone_job
+{
+  colorhalftone_instance_t* inst;
+  const uint32_t* in;
+  uint32_t* out;
+  halftone_screen_t screen[3];
+} halftone_job_t;
+
+static void build_screen(halftone_screen_t* s, const uint32_t* in, int width, int height,
+                         double angle, double gridSize, int shift)
+{
+  double cos_val = cos(angle), sin_val = sin(angle);
+  double u[4], v[4], umin, umax, vmin, vmax;
+  float level[256];
+  int i, kx, ky;
+
+  s->cs = cos_val / gridSize;
+  s->sn = sin_val / gridSize;
+  s->grid = gridSize;
+
+  // screen coordinates of the frame corners, in grid cells
+  for (i = 0; i < 4; i++)
+  {
+    double x = (i & 1) ? width - 1 : 0, y = (i & 2) ? height - 1 : 0;
+    u[i] = (x*cos_val + y*sin_val) / gridSize;
+    v[i] = (-x*sin_val + y*cos_val) / gridSize;
+  }
+  umin = MIN(MIN(u[0], u[1]), MIN(u[2], u[3]));
+  umax = MAX(MAX(u[0], u[1]), MAX(u[2], u[3]));
+  vmin = MIN(MIN(v[0], v[1]), MIN(v[2], v[3]));
+  vmax = MAX(MAX(v[0], v[1]), MAX(v[2], v[3]));
+
+  // one cell of margin for the neighbours, and one more because the
+  // per-pixel coordinates are computed in float and may round past the
+  // corners computed here
+  s->kx0 = (int)floor(umin - 0.5) - 1;
+  s->ky0 = (int)floor(vmin - 0.5) - 1;
+  s->nx = (int)floor(umax - 0.5) + 5 - s->kx0;
+  s->ny = (int)floor(vmax - 0.5) + 5 - s->ky0;
+  s->radius = (float*)malloc(sizeof(float) * s->nx * s->ny);
+
+  for (i = 0; i < 256; i++)
+  {
+    float l = i / 255.0f;
+    level[i] = (1 - l*l) * gridSize / 2 * 1.414;
+  }
+
+  for (ky = 0; ky < s->ny; ky++)
+    for (kx = 0; kx < s->nx; kx++)
+    {
+      double ttx = (kx + s->kx0) * gridSize;
+      double tty = (ky + s->ky0) * gridSize;
+      int nx = CLAMP( (int)(ttx*cos_val - tty*sin_val), 0, width - 1);
+      int ny = CLAMP( (int)(ttx*sin_val + tty*cos_val), 0, height - 1);
+      s->radius[ky*s->nx + kx] = level[(in[ny*width+nx] >> shift) & 0xff];
+    }
+}
+
+// 1 - smoothStep(R, R+1, l), i.e. how much the dot leaves uncovered
+static inline float dot_coverage(float l, float R)
+{
+  float t = l - R;
+  if (t <= 0)
+    return 0;
+  if (t >= 1)
+    return 1;
+  return t*t * (3 - 2*t);
+}
+
+static inline uint8_t screen_pixel(const halftone_screen_t* s, float u, float v)
+{
+  float fu = floorf(u - 0.5f) + 1, fv = floorf(v - 0.5f) + 1;
+  float du = u - fu, dv = v - fv;
+  const float* r = s->radius + ((int)fv - s->ky0) * s->nx + ((int)fu - s->kx0);
+  float c = dot_coverage(r[0], s->grid * sqrtf(du*du + dv*dv));
+  float c2;
+
+  if (fabsf(du) > fabsf(dv))
+  {
+    int sx = du > 0 ? 1 : -1;
+    c2 = dot_coverage(r[sx], s->grid * sqrtf((du - sx)*(du - sx) + dv*dv));
+  }
+  else
+  {
+    int sy = dv > 0 ? 1 : -1;
+    c2 = dot_coverage(r[sy*s->nx], s->grid * sqrtf(du*du + (dv - sy)*(dv - sy)));
+  }
+  return (uint8_t)(255 * (1 - MAX(c, c2)));
+}
+
+#if defined(__SSE2__)
+static inline __m128 floor_ps(__m128 x)
+{
+  __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+  return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+static inline __m128 dot_coverage_ps(__m128 l, __m128 R)
+{
+  __m128 t = _mm_min_ps(_mm_max_ps(_mm_sub_ps(l, R), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(t, t)));
+}
+
+// four pixels of a row at once; only the lattice reads are scalar
+static inline void screen_pixels4(const halftone_screen_t* s, __m128 u, __m128 v, uint8_t* val)
+{
+  const __m128 half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f);
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 fu = _mm_add_ps(floor_ps(_mm_sub_ps(u, half)), one);
+  __m128 fv = _mm_add_ps(floor_ps(_mm_sub_ps(v, half)), one);
+  __m128 du = _mm_sub_ps(u, fu), dv = _mm_sub_ps(v, fv);
+
+  // step towards the nearest edge, horizontally or vertically
+  __m128 horiz = _mm_cmpgt_ps(_mm_andnot_ps(sign, du), _mm_andnot_ps(sign, dv));
+  __m128 su = _mm_and_ps(horiz, _mm_or_ps(one, _mm_and_ps(sign, du)));
+  __m128 sv = _mm_andnot_ps(horiz, _mm_or_ps(one, _mm_and_ps(sign, dv)));
+  __m128 du2 = _mm_sub_ps(du, su), dv2 = _mm_sub_ps(dv, sv);
+
+  int32_t iu[4], iv[4], nu[4], nv[4];
+  float l[4], l2[4];
+  int k;
+  _mm_storeu_si128((__m128i*)iu, _mm_cvttps_epi32(fu));
+  _mm_storeu_si128((__m128i*)iv, _mm_cvttps_epi32(fv));
+  _mm_storeu_si128((__m128i*)nu, _mm_cvttps_epi32(su));
+  _mm_storeu_si128((__m128i*)nv, _mm_cvttps_epi32(sv));
+  for (k = 0; k < 4; k++)
+  {
+    const float* r = s->radius + (iv[k] - s->ky0) * s->nx + (iu[k] - s->kx0);
+    l[k] = r[0];
+    l2[k] = r[nv[k] * s->nx + nu[k]];
+  }
+
+  __m128 g = _mm_set1_ps(s->grid);
+  __m128 R = _mm_mul_ps(g, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(du, du), _mm_mul_ps(dv, dv))));
+  __m128 R2 = _mm_mul_ps(g, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(du2, du2), _mm_mul_ps(dv2, dv2))));
+  __m128 c = _mm_max_ps(dot_coverage_ps(_mm_loadu_ps(l), R), dot_coverage_ps(_mm_loadu_ps(l2), R2));
+  __m128i x = _mm_cvttps_epi32(_mm_mul_ps(_mm_set1_ps(255.0f), _mm_sub_ps(one, c)));
+  x = _mm_packs_epi32(x, x);
+  *(int32_t*)val = _mm_cvtsi128_si32(_mm_packus_epi16(x, x));
+}
+#endif
+
+static void halftone_rows(void* arg, int first, int last, int slice)
+{
+  halftone_job_t* job = (halftone_job_t*)arg;
+  int width = job->inst->width;
+  uint8_t* val = (uint8_t*)malloc(3 * width + 4);
+  int x, y, channel;
+  (void)slice;
+
+  for (y = first; y < last; y++)
+  {
+    for (channel = 0; channel < 3; channel++)
+    {
+      const halftone_screen_t* s = &job->screen[channel];
+      uint8_t* v = val + channel * width;
+      x = 0;
+#if defined(__SSE2__)
+      {
+        const __m128 step = _mm_set_ps(3, 2, 1, 0);
+        for (; x + 4 <= width; x += 4)
+        {
+          __m128 xs = _mm_add_ps(_mm_set1_ps(x), step);
+          __m128 u = _mm_add_ps(_mm_mul_ps(xs, _mm_set1_ps(s->cs)), _mm_set1_ps(y * s->sn));
+          __m128 w = _mm_sub_ps(_mm_set1_ps(y * s->cs), _mm_mul_ps(xs, _mm_set1_ps(s->sn)));
+          screen_pixels4(s, u, w, v + x);
+        }
+      }
+#endif
+      for (; x < width; x++)
+        v[x] = screen_pixel(s, x*s->cs + y*s->sn, -x*s->sn + y*s->cs);
+    }
+
+    uint32_t* dst = job->out + y * width;
+    for (x = 0; x < width; x++)
+      dst[x] = 0xff000000 | (val[x] << 16) | (val[width + x] << 8) | val[2*width + x];
+  }
+  free(val);
+}
+
+void color_halftone_fast(f0r_instance_t instance, double time,
+		const uint32_t* inframe, uint32_t* outframe)
+{
+  colorhalftone_instance_t* inst = (colorhalftone_instance_t*)instance;
+  halftone_job_t job;
+  int channel;
+
+  double dotRadius = ceil(inst->dot_radius * 9.99);
+  double gridSize = 2 * dotRadius * 1.414f;
+  double angles[] = {inst->cyan_angle, inst->magenta_angle, inst->yellow_angle};
+
+  if (gridSize <= 0)
+  {
+    // no dots at all, the same white the exact path gives
+    unsigned int i;
+    for (i = 0; i < inst->width * inst->height; i++)
+      outframe[i] = 0xffffffff;
+    return;
+  }
+
+  job.inst = inst;
+  job.in = inframe;
+  job.out = outframe;
+  for (channel = 0; channel < 3; channel++)
+    build_screen(&job.screen[channel], inframe, inst->width, inst->height,
+                 degreeToRadian(angles[channel] * 360.0), gridSize, 16-8*channel);
+
+  f0r_parallel_for(inst->height, 16, halftone_rows, &job);
+
+  for (channel = 0; channel < 3; channel++)
+    free(job.screen[channel].radius);
+}
+
 int f0r_init()
 {
   return 1;
@@ -172,7 +415,7 @@ void f0r_get_plugin_info(f0r_plugin_info_t* colorhalftoneInfo)
   colorhalftoneInfo->frei0r_version = FREI0R_MAJOR_VERSION;
   colorhalftoneInfo->major_version = 0; 
   colorhalftoneInfo->minor_version = 9; 
-  colorhalftoneInfo->num_params =  4; 
+  colorhalftoneInfo->num_params =  5; 
   colorhalftoneInfo->explanation = "Filters image to resemble a halftone print in which tones are represented as variable sized dots";
 }
 
@@ -198,6 +441,11 @@ void f0r_get_param_info(f0r_param_info_t* info, int param_index)
       info->name = "yellow angle";
       info->type = F0R_PARAM_DOUBLE;
       info->explanation = "Yellow dots angle";
+      break;
+    case 4:
+      info->name = "fast";
+      info->type = F0R_PARAM_BOOL;
+      info->explanation = "Single precision, one neighbouring dot, all CPUs";
       break;
 	}
 }
@@ -211,6 +459,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->cyan_angle = 108.0/360.0; // in degrees
   inst->magenta_angle = 162.0/360.0; // in degrees
   inst->yellow_angle = 90.0/360.0; // in degrees
+  inst->fast = 0;
   return (f0r_instance_t)inst;
 }
 
@@ -238,6 +487,9 @@ void f0r_set_param_value(f0r_instance_t instance,
     case 3:
       inst->yellow_angle = *((double*)param);
       break;
+    case 4:
+      inst->fast = *((double*)param) >= 0.5;
+      break;
   }
 }
 
@@ -259,6 +511,9 @@ void f0r_get_param_value(f0r_instance_t instance,
     case 3:
       *((double*)param) = inst->yellow_angle;
       break;
+    case 4:
+      *((double*)param) = inst->fast ? 1.0 : 0.0;
+      break;
   }
 }
 
@@ -266,6 +521,10 @@ void f0r_update(f0r_instance_t instance, double time,
 		const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
-  color_halftone(instance, time, inframe, outframe);
+  colorhalftone_instance_t* inst = (colorhalftone_instance_t*)instance;
+  if (inst->fast)
+    color_halftone_fast(instance, time, inframe, outframe);
+  else
+    color_halftone(instance, time, inframe, outframe);
 }
 
@@ -268,6 +268,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->points[7] = 0;
   inst->points[8] = 0;
   inst->points[9] = 0;
+  updateCsplineMap(inst);
   return (f0r_instance_t)inst;
 }
 
@@ -755,6 +756,7 @@ void updateCsplineMap(f0r_instance_t instance)
     }
     if (inst->drawCurves) {
         int scale = inst->height / 2;
+        free(inst->curveMap);
         inst->curveMap = malloc(scale * sizeof(float));
         for(i = 0; i < scale; i++)
             inst->curveMap[i] = spline((float)i / scale, points, (size_t)inst->pointNumber, coeffs) * scale;
@@ -912,6 +914,8 @@ void f0r_update(f0r_instance_t instance, double time,
 	dst = (unsigned char*)outframe;
 	float lineWidth = scale / 254.;
 	int cellSize = floor(lineWidth * 32);
+	if (cellSize < 1) // frames below 16 lines
+	  cellSize = 1;
 	//filling up background and drawing grid
 	for(i = 0; i < scale; i++) {
 	  if (i % cellSize > lineWidth) //point doesn't aly on the grid
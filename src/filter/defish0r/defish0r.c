@@ -33,6 +33,7 @@
 #include <frei0r.h>
 
 #include "interp.h"
+#include "frei0r_remap.h"
 
 
 double PI=3.14159265358979;
@@ -251,6 +252,7 @@ typedef struct
 	float mpar;
 	float par;
 	float *map;
+	f0r_remap_entry_t *fixed;	//map in fixed point, for bilinear
 	interpp interpol;
 } param;
 
@@ -273,6 +275,21 @@ interpp set_intp(param p)
 	}
 }
 
+//--------------------------------------------------------
+//converts the float map for f0r_remap()
+void make_fixed_map(param p)
+{
+	int i;
+
+	for (i=0;i<p.w*p.h;i++)
+	{
+		if (p.map[2*i]>0)
+			f0r_remap_set(&p.fixed[i], p.w, p.h, p.map[2*i], p.map[2*i+1]);
+		else
+			f0r_remap_clear(&p.fixed[i]);
+	}
+}
+
 //--------------------------------------------------------
 void make_map(param p)
 {
@@ -318,6 +335,8 @@ void make_map(param p)
 		fishmap(p.w, p.h, p.w ,p.h, p.type, p.f, fscal, p.par, p.par, 0.0, 0.0,  p.map);
     }
 
+	if (p.intp==1)	//bilinear goes through the fixed point gather
+		make_fixed_map(p);
 }
 
 //*********************************************************
@@ -419,6 +438,7 @@ f0r_instance_t  f0r_construct(unsigned int width, unsigned int height)
 	p->mpar=1.0;
 
 	p->map=(float*)calloc(1, sizeof(float)*(p->w*p->h*2+2));
+	p->fixed=(f0r_remap_entry_t*)calloc(1, sizeof(f0r_remap_entry_t)*(p->w*p->h+1));
 	p->interpol=set_intp(*p);
 
 	make_map(*p);
@@ -435,9 +455,40 @@ void f0r_destruct(f0r_instance_t instance)
 	p=(param*)instance;
 
 	free(p->map);
+	free(p->fixed);
 	free(instance);
 }
 
+//---------------------------------------------------
+//keeps the parameters, the map is made again for the new size
+int f0r_resize(f0r_instance_t instance, unsigned int width, unsigned int height)
+{
+	param *p;
+	float *map;
+	f0r_remap_entry_t *fixed;
+
+	p=(param*)instance;
+
+	map=(float*)calloc(1, sizeof(float)*(width*height*2+2));
+	fixed=(f0r_remap_entry_t*)calloc(1, sizeof(f0r_remap_entry_t)*(width*height+1));
+	if ((map==NULL)||(fixed==NULL))
+	{
+		free(map);
+		free(fixed);
+		return 0;
+	}
+
+	free(p->map);
+	free(p->fixed);
+	p->map=map;
+	p->fixed=fixed;
+	p->w=width;
+	p->h=height;
+	make_map(*p);
+
+	return 1;
+}
+
 //----------------------------------------------------
 //not used in frei0r plugin
 void change_param(param *p, int w, int h, float f, int dir, int type, int scal, int intp)
@@ -451,7 +502,9 @@ void change_param(param *p, int w, int h, float f, int dir, int type, int scal,
 	if ((w!=p->w)||(h!=p->h))
 	{
 		free(p->map);
+		free(p->fixed);
 		p->map=(float*)calloc(1, sizeof(float)*(w*h*2+2));
+		p->fixed=(f0r_remap_entry_t*)calloc(1, sizeof(f0r_remap_entry_t)*(w*h+1));
 		p->w=w;
 		p->h=h;
 	}
@@ -643,6 +696,9 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 
 	p=(param*)instance;
 
-	remap32(p->w, p->h, p->w, p->h, (unsigned char*) inframe, (unsigned char*) outframe, p->map, 0, p->interpol);
+	if (p->intp==1)
+		f0r_remap(inframe, p->w, p->h, outframe, p->w, p->h, p->fixed, 0);
+	else
+		remap32(p->w, p->h, p->w, p->h, (unsigned char*) inframe, (unsigned char*) outframe, p->map, 0, p->interpol);
 
 }
@@ -8,10 +8,14 @@
 class delay0r : public frei0r::filter
 {
 public:
+  static void describe(frei0r::param_list<delay0r>& params)
+  {
+    params.add(&delay0r::delay,"DelayTime","the delay time");
+  }
+
   delay0r(unsigned int width, unsigned int height)
   {
     delay = 0.0;
-    register_param(delay,"DelayTime","the delay time");
   }
   
   ~delay0r()
@@ -19,10 +23,28 @@ public:
     for (std::list< std::pair< double, unsigned int* > >::iterator i=buffer.begin(); i != buffer.end(); ++i)
     {
        delete[] i->second;
-       i=buffer.erase(i);
     }
   }
   
+  // the frames kept for the delay
+  virtual size_t scratch_bytes() const
+  {
+    return buffer.size() * size * sizeof(unsigned int);
+  }
+
+  // the kept frames are scaled, so the delay goes on across the change
+  virtual bool resize(unsigned int new_width, unsigned int new_height)
+  {
+    for (std::list< std::pair< double, unsigned int* > >::iterator i=buffer.begin(); i != buffer.end(); ++i)
+      {
+	unsigned int* frame = new unsigned int[new_width*new_height];
+	scale_nearest(i->second, width, height, frame, new_width, new_height);
+	delete[] i->second;
+	i->second = frame;
+      }
+    return true;
+  }
+
   virtual void update(double time,
                       uint32_t* out,
                       const uint32_t* in)
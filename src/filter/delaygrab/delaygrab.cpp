@@ -63,6 +63,9 @@ public:
                       uint32_t* out,
                       const uint32_t* in);
 
+  virtual size_t scratch_bytes() const {
+    return QUEUEDEPTH*(size_t)geo.size + delaymapsize*4;
+  }
 
 private:
 
@@ -117,7 +120,8 @@ DelayGrab::DelayGrab(int wdt, int hgt) {
   delaymap = NULL;
   _init(wdt, hgt);
 
-  imagequeue = (uint8_t *) malloc(QUEUEDEPTH*(geo.size));
+  /* black until the queue has filled up */
+  imagequeue = (uint8_t *) calloc(QUEUEDEPTH, geo.size);
 
   /* starting mode */
   current_mode = 4;
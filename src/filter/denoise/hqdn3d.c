@@ -330,10 +330,72 @@ free(in->Bplani);
 free(in->Rplano);
 free(in->Gplano);
 free(in->Bplano);
+free(in->vps.Frame[0]);
+free(in->vps.Frame[1]);
+free(in->vps.Frame[2]);
 
 free(instance);
 }
 
+//---------------------------------------------------
+//keeps the temporal averages, scaled to the new size
+int f0r_resize(f0r_instance_t instance, unsigned int width, unsigned int height)
+{
+inst *in;
+unsigned int *line;
+unsigned char *planes[6];
+unsigned short *frame[3];
+unsigned char **old[6];
+int c,ok;
+unsigned int x,y;
+
+in=(inst*)instance;
+old[0]=&in->Rplani; old[1]=&in->Gplani; old[2]=&in->Bplani;
+old[3]=&in->Rplano; old[4]=&in->Gplano; old[5]=&in->Bplano;
+
+line=calloc(width,sizeof(int));
+ok=line!=NULL;
+for (c=0;c<6;c++)
+	{
+	planes[c]=calloc(width*height,sizeof(unsigned char));
+	ok=ok && planes[c];
+	}
+for (c=0;c<3;c++)
+	{
+	frame[c]=in->vps.Frame[c] ? malloc(width*height*sizeof(unsigned short)) : NULL;
+	ok=ok && (frame[c] || !in->vps.Frame[c]);
+	}
+if (!ok)
+	{
+	free(line);
+	for (c=0;c<6;c++) free(planes[c]);
+	for (c=0;c<3;c++) free(frame[c]);
+	return 0;
+	}
+
+for (c=0;c<3;c++)	//nearest neighbour
+	{
+	if (!frame[c]) continue;
+	for (y=0;y<height;y++)
+		for (x=0;x<width;x++)
+			frame[c][y*width+x]=in->vps.Frame[c][(y*in->h/height)*in->w+x*in->w/width];
+	free(in->vps.Frame[c]);
+	in->vps.Frame[c]=frame[c];
+	}
+
+free(in->vps.Line);
+in->vps.Line=line;
+for (c=0;c<6;c++)
+	{
+	free(*old[c]);
+	*old[c]=planes[c];
+	}
+in->w=width;
+in->h=height;
+
+return 1;
+}
+
 //-----------------------------------------------------
 void f0r_set_param_value(f0r_instance_t instance, f0r_param_t parm, int param_index)
 {
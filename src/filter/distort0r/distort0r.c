@@ -6,11 +6,18 @@
 #include <math.h>
 
 #include "frei0r.h"
+#include "frei0r_math.h"
+#include "frei0r_thread.h"
+#include "frei0r_warp.h"
 
 
 #define GRID_SIZE_LOG 3
 #define GRID_SIZE (1<<GRID_SIZE_LOG)
 
+/* range of the adaptive grid: 2x2 .. 64x64 pixel blocks */
+#define GRID_SIZE_LOG_MIN 1
+#define GRID_SIZE_LOG_MAX 6
+
 typedef struct grid_point
 {
   int32_t u;
@@ -23,8 +30,11 @@ typedef struct distorter_instance
   unsigned int width, height;
   double amplitude, frequency, change_speed;
   grid_point_t* grid;
+  double* col_terms; /* per grid column: dx and sin(freq*x/w + t) */
+  double* row_terms; /* per grid row: dy and sin(freq*y/h + t) */
   double time_stack;
   double mode;
+  double adaptive;
 } distorter_instance_t;
 
 //const double AMPLTUDE_SCALE = 10.0;
@@ -32,7 +42,7 @@ const double FREQUENCY_SCALE = 200.0;
 const double SPEED_SCALE = 2.0;
 
 void interpolateGrid(grid_point_t* grid, unsigned int w, unsigned int h,
-		     const uint32_t* src, uint32_t* dst);
+		     unsigned int grid_log, const uint32_t* src, uint32_t* dst);
 
 int f0r_init()
 {
@@ -51,7 +61,7 @@ void f0r_get_plugin_info(f0r_plugin_info_t* distorterInfo)
   distorterInfo->frei0r_version = FREI0R_MAJOR_VERSION;
   distorterInfo->major_version = 0; 
   distorterInfo->minor_version = 10;
-  distorterInfo->num_params =  4;
+  distorterInfo->num_params =  5;
   distorterInfo->explanation = "Plasma";
 }
 
@@ -79,6 +89,11 @@ void f0r_get_param_info(f0r_param_info_t* info, int param_index)
       info->type = F0R_PARAM_DOUBLE;
       info->explanation = "Changing speed of the plasma signal";
       break;
+    case 4:
+      info->name = "Adaptive Grid";
+      info->type = F0R_PARAM_BOOL;
+      info->explanation = "Choose the grid density from amplitude and frequency instead of a fixed 8x8 grid";
+      break;
     }
 }
 
@@ -86,14 +101,19 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 {
   distorter_instance_t* inst = (distorter_instance_t*)calloc(1, sizeof(*inst));
   inst->width = width; inst->height = height;
+  /* room for the densest grid the adaptive mode may pick */
+  unsigned int grid_w = ((width + (1<<GRID_SIZE_LOG_MIN) - 1) >> GRID_SIZE_LOG_MIN) + 1;
+  unsigned int grid_h = ((height + (1<<GRID_SIZE_LOG_MIN) - 1) >> GRID_SIZE_LOG_MIN) + 1;
   inst->grid = 
-    (grid_point_t*)malloc(sizeof(grid_point_t)*
-			  ((width/GRID_SIZE)+1)*((height/GRID_SIZE)+1));
+    (grid_point_t*)malloc(sizeof(grid_point_t)*grid_w*grid_h);
+  inst->col_terms = (double*)malloc(sizeof(double)*2*grid_w);
+  inst->row_terms = (double*)malloc(sizeof(double)*2*grid_h);
   inst->amplitude = 1.0;
   inst->frequency = 1.0;
   inst->change_speed = 1.0;
   inst->time_stack = 0.0;
   inst->mode = 0.0;
+  inst->adaptive = 0.0;
   return (f0r_instance_t)inst;
 }
 
@@ -101,6 +121,8 @@ void f0r_destruct(f0r_instance_t instance)
 {
   distorter_instance_t* inst = (distorter_instance_t*)instance;
   free(inst->grid);
+  free(inst->col_terms);
+  free(inst->row_terms);
   free(inst);
 }
 
@@ -127,6 +149,9 @@ void f0r_set_param_value(f0r_instance_t instance,
       // scale
       inst->change_speed = *((double*)param) * SPEED_SCALE;
       break;
+    case 4:
+      inst->adaptive = *((f0r_param_bool *)param);
+      break;
     }
 }
 
@@ -158,25 +183,81 @@ void f0r_get_param_value(f0r_instance_t instance,
       scaled = inst->change_speed / SPEED_SCALE;
       *((double*)param) = scaled;
       break;
+    case 4:
+      *((f0r_param_bool *)param) = inst->adaptive;
+      break;
     }
 
 }
 
 /* this will compute a displacement value such that 
-   0<=x_retval<xsize and 0<=y_retval<ysize. */ 
-static inline void plasmaFunction
-(int32_t* x_retval, int32_t* y_retval, 
- unsigned int x, unsigned int y,
- unsigned int w, unsigned int h,
- double amp, double freq, double t)
+   0<=x_retval<xsize and 0<=y_retval<ysize, for every point of a grid
+   with blocks of 2^grid_log pixels.
+
+   The x displacement of a point only depends on its column through dx
+   and on its row through the sine, and the other way round for y, so
+   the terms are computed once per grid column and row. */
+static void plasmaGrid(distorter_instance_t* inst, unsigned int grid_log,
+                       double t)
 {
+  unsigned int w = inst->width;
+  unsigned int h = inst->height;
+  unsigned int size = 1u << grid_log;
+  unsigned int grid_x = (w + size - 1) >> grid_log;
+  unsigned int grid_y = (h + size - 1) >> grid_log;
+  double amp = inst->amplitude, freq = inst->frequency;
   double time = fmod(t, 2*M_PI);
   double h_ = (double)h -1; double w_ = (double)w-1;
-  double dx = (-4./(w_*w_)*x + 4./w_)*x;
-  double dy = (-4./(h_*h_)*y + 4./h_)*y;
-  *x_retval = (int32_t)(65536.0*((double)x+amp*(w/4)*dx*sin(freq*y/h + time)));
-  *y_retval = (int32_t)(65536.0*((double)y+amp*(h/4)*dy*sin(freq*x/w + time)));
+  double* col = inst->col_terms;
+  double* row = inst->row_terms;
+  grid_point_t* pt = inst->grid;
+  unsigned int i, j, x, y;
 
+  for (i = 0; i <= grid_x; i++)
+    {
+      x = i << grid_log;
+      col[2*i]   = (-4./(w_*w_)*x + 4./w_)*x;
+      col[2*i+1] = sin(freq*x/w + time);
+    }
+  for (j = 0; j <= grid_y; j++)
+    {
+      y = j << grid_log;
+      row[2*j]   = (-4./(h_*h_)*y + 4./h_)*y;
+      row[2*j+1] = sin(freq*y/h + time);
+    }
+
+  for (j = 0; j <= grid_y; j++)
+    for (i = 0; i <= grid_x; i++, ++pt)
+      {
+        x = i << grid_log;
+        y = j << grid_log;
+        pt->u = (int32_t)(65536.0*((double)x+amp*(w/4)*col[2*i]*row[2*j+1]));
+        pt->v = (int32_t)(65536.0*((double)y+amp*(h/4)*row[2*j]*col[2*i+1]));
+      }
+}
+
+/* Coarsest grid whose bilinear interpolation stays within about half a
+   pixel of the plasma displacement: the error of a linear segment of
+   length s over a curve is bounded by s^2/8 times its second
+   derivative, here the sine and the parabola of each displacement. */
+static unsigned int adaptiveGridLog(distorter_instance_t* inst)
+{
+  double w = inst->width, h = inst->height;
+  double amp = fabs(inst->amplitude), freq = inst->frequency;
+  double ku = freq / h, kv = freq / w;
+  double cu = amp*(w/4)*(ku*ku + 8./(w*w) + 4.*ku/w);
+  double cv = amp*(h/4)*(kv*kv + 8./(h*h) + 4.*kv/h);
+  double c = cu > cv ? cu : cv;
+  unsigned int grid_log = GRID_SIZE_LOG_MAX;
+
+  while (grid_log > GRID_SIZE_LOG_MIN)
+    {
+      double size = (double)(1u << grid_log);
+      if (c*size*size/8. <= 0.5)
+        break;
+      --grid_log;
+    }
+  return grid_log;
 }
 
 void f0r_update(f0r_instance_t instance, double time,
@@ -184,42 +265,55 @@ void f0r_update(f0r_instance_t instance, double time,
 {
   assert(instance);
   distorter_instance_t* inst = (distorter_instance_t*)instance;
-  unsigned int w = inst->width;
-  unsigned int h = inst->height;
-  unsigned int x,y;
+  unsigned int grid_log = GRID_SIZE_LOG;
 
   inst->time_stack+=inst->change_speed;
 
-  grid_point_t* pt = inst->grid;
-  for(y=0;y<=h;y+= GRID_SIZE)    
-      for(x=0;x<=w;x+=GRID_SIZE,++pt)
-	{
-	  plasmaFunction(&pt->u, &pt->v, x, y, w, h, 
-	                 inst->amplitude, inst->frequency, inst->mode?inst->time_stack:time);
-	}
+  if (inst->adaptive)
+    grid_log = adaptiveGridLog(inst);
+
+  plasmaGrid(inst, grid_log, inst->mode?inst->time_stack:time);
 
-  interpolateGrid(inst->grid, w, h, inframe, outframe);
+  interpolateGrid(inst->grid, inst->width, inst->height, grid_log,
+                  inframe, outframe);
 }
 
-void interpolateGrid(grid_point_t* grid, unsigned int w, unsigned int h,
-		     const uint32_t* src, uint32_t* dst)
+#define MIN4(a,b,c,d) MIN(MIN(a,b),MIN(c,d))
+#define MAX4(a,b,c,d) MAX(MAX(a,b),MAX(c,d))
+
+typedef struct interpolate_job
+{
+  grid_point_t* grid;
+  unsigned int w, h, grid_log;
+  const uint32_t* src;
+  uint32_t* dst;
+} interpolate_job_t;
+
+/* fill the blocks of grid rows [first,last) */
+static void interpolateRows(void* arg, int first, int last, int slice)
 {
-  unsigned int x, y, block_x, block_y;
-  unsigned int tex_x = 0, tex_y = 0;
-  unsigned int grid_x = (w / GRID_SIZE);
-  unsigned int grid_y = (h / GRID_SIZE);
-  for(y=0, tex_y=0; y < grid_y; y++)
+  interpolate_job_t* job = (interpolate_job_t*)arg;
+  unsigned int w = job->w, h = job->h, grid_log = job->grid_log;
+  unsigned int size = 1u << grid_log;
+  unsigned int grid_x = (w + size - 1) >> grid_log;
+  int32_t last_pixel = (int32_t)(w*h) - 1;
+  int32_t margin = 2 << grid_log;
+  int32_t u_end = (int32_t)w << 16, v_end = (int32_t)h << 16;
+  unsigned int x, y, block_y, block_w, block_h;
+  int inside;
+  (void)slice;
+
+  for(y=first; y < (unsigned int)last; y++)
     {
-      for(x=0, tex_x=0; x < grid_x; x++)
+      block_h = h - (y<<grid_log) < size ? h - (y<<grid_log) : size;
+      for(x=0; x < grid_x; x++)
 	{
 	  unsigned int offset = x + y*(grid_x+1); 
 	  
-	  grid_point_t* upper_left  = grid + offset; 
-	  grid_point_t* lower_left  = grid + offset + grid_x + 1; 
-	  grid_point_t* upper_right = grid + offset + 1; 
-	  grid_point_t* lower_right = grid + offset + grid_x + 2; 
-	  
-	  int32_t u_left, u_right, v_left, v_right; 
+	  grid_point_t* upper_left  = job->grid + offset; 
+	  grid_point_t* lower_left  = job->grid + offset + grid_x + 1; 
+	  grid_point_t* upper_right = job->grid + offset + 1; 
+	  grid_point_t* lower_right = job->grid + offset + grid_x + 2; 
 	  
 	  int32_t start_col_uu = upper_left->u; 
 	  int32_t start_col_vv = upper_left->v; 
@@ -227,51 +321,63 @@ void interpolateGrid(grid_point_t* grid, unsigned int w, unsigned int h,
 	  int32_t end_col_vv   = upper_right->v; 
 	  
 	  int32_t step_start_col_u = (lower_left->u - upper_left->u) 
-	    >> GRID_SIZE_LOG; 
+	    >> grid_log; 
 	  int32_t step_start_col_v = (lower_left->v - upper_left->v) 
-	    >> GRID_SIZE_LOG; 
+	    >> grid_log; 
 	  int32_t step_end_col_u   = (lower_right->u - upper_right->u) 
-	    >> GRID_SIZE_LOG; 
+	    >> grid_log; 
 	  int32_t step_end_col_v   = (lower_right->v - upper_right->v) 
-	    >> GRID_SIZE_LOG; 
-	  
-	  int32_t u_line_index, v_line_index; 
-	  int32_t step_line_u, step_line_v; 
-	  
+	    >> grid_log; 
 	  
-	  uint32_t* pos = dst+ (y<<GRID_SIZE_LOG)*w + (x<<GRID_SIZE_LOG);
+	  uint32_t* pos = job->dst + (y<<grid_log)*w + (x<<grid_log);
+
+	  block_w = w - (x<<grid_log) < size ? w - (x<<grid_log) : size;
+
+	  /* stepping truncates towards -infinity and can undershoot the
+	     corners by up to 2 steps of 1/65536, so only blocks clear of
+	     the frame edges by that much skip the clamping */
+	  inside = MIN4(upper_left->u, upper_right->u, lower_left->u, lower_right->u) >= margin
+	    && MIN4(upper_left->v, upper_right->v, lower_left->v, lower_right->v) >= margin
+	    && MAX4(upper_left->u, upper_right->u, lower_left->u, lower_right->u) < u_end
+	    && MAX4(upper_left->v, upper_right->v, lower_left->v, lower_right->v) < v_end;
       
-	  for(block_y = 0; block_y < GRID_SIZE; ++block_y) 
+	  for(block_y = 0; block_y < block_h; ++block_y) 
 	    { 
-	      u_left  = start_col_uu; 
-	      u_right = end_col_uu; 
-	      v_left  = start_col_vv; 
-	      v_right = end_col_vv; 
-	      
-	      u_line_index = start_col_uu; 
-	      v_line_index = start_col_vv; 
-	      
-	      step_line_u = (int32_t) ((u_right-u_left) >> GRID_SIZE_LOG); 
-	      step_line_v = (int32_t) ((v_right-v_left) >> GRID_SIZE_LOG); 
-	      
-	      for(block_x=0; block_x < GRID_SIZE; ++block_x) 
-		{ 
-		  int uu = u_line_index >> 16;
-		  int vv = v_line_index >> 16;
-		  
-		  u_line_index += step_line_u; 
-		  v_line_index += step_line_v; 
-		  
-		  *pos++ = src[uu + vv * w]; 
-		} 
+	      int32_t step_line_u = (end_col_uu-start_col_uu) >> grid_log;
+	      int32_t step_line_v = (end_col_vv-start_col_vv) >> grid_log;
+
+	      if (inside)
+	        f0r_warp_span_inside(pos, job->src, block_w,
+	                             start_col_uu, start_col_vv,
+	                             step_line_u, step_line_v, w);
+	      else
+	        f0r_warp_span(pos, job->src, block_w,
+	                      start_col_uu, start_col_vv,
+	                      step_line_u, step_line_v, w, last_pixel);
 	      
 	      start_col_uu += step_start_col_u; 
 	      end_col_uu   += step_end_col_u; 
 	      start_col_vv += step_start_col_v; 
 	      end_col_vv   += step_end_col_v; 
 	      
-	      pos += (w - GRID_SIZE); 
+	      pos += w; 
 	    }   
 	}
     }
 }
+
+void interpolateGrid(grid_point_t* grid, unsigned int w, unsigned int h,
+		     unsigned int grid_log, const uint32_t* src, uint32_t* dst)
+{
+  interpolate_job_t job;
+  unsigned int grid_y = (h + (1u << grid_log) - 1) >> grid_log;
+
+  job.grid = grid;
+  job.w = w;
+  job.h = h;
+  job.grid_log = grid_log;
+  job.src = src;
+  job.dst = dst;
+  f0r_parallel_for(grid_y, 64 >> grid_log > 0 ? 64 >> grid_log : 1,
+                   interpolateRows, &job);
+}
@@ -23,11 +23,17 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_thread.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 int ditherMagic2x2Matrix[] = {
 	 	 0, 2,
@@ -134,14 +140,192 @@ int* matrixes[] = {ditherMagic2x2Matrix, ditherMagic4x4Matrix, ditherOrdered4x4M
                   ditherLines4x4Matrix, dither90Halftone6x6Matrix, ditherOrdered6x6Matrix, 
                   ditherOrdered8x8Matrix, ditherCluster3Matrix, ditherCluster4Matrix, ditherCluster8Matrix};
 
+/* Bayer matrices 2x2 .. 16x16, by the recursive rule
+   M(2n) = [4M, 4M+2; 4M+3, 4M+1] from M(1) = 0 */
+int bayerMatrix2[] = {
+		  0,  2,
+		  3,  1 };
+
+int bayerMatrix4[] = {
+		  0,  8,  2, 10,
+		 12,  4, 14,  6,
+		  3, 11,  1,  9,
+		 15,  7, 13,  5 };
+
+int bayerMatrix8[] = {
+		  0, 32,  8, 40,  2, 34, 10, 42,
+		 48, 16, 56, 24, 50, 18, 58, 26,
+		 12, 44,  4, 36, 14, 46,  6, 38,
+		 60, 28, 52, 20, 62, 30, 54, 22,
+		  3, 35, 11, 43,  1, 33,  9, 41,
+		 51, 19, 59, 27, 49, 17, 57, 25,
+		 15, 47,  7, 39, 13, 45,  5, 37,
+		 63, 31, 55, 23, 61, 29, 53, 21 };
+
+int bayerMatrix16[] = {
+		  0,128, 32,160,  8,136, 40,168,  2,130, 34,162, 10,138, 42,170,
+		192, 64,224, 96,200, 72,232,104,194, 66,226, 98,202, 74,234,106,
+		 48,176, 16,144, 56,184, 24,152, 50,178, 18,146, 58,186, 26,154,
+		240,112,208, 80,248,120,216, 88,242,114,210, 82,250,122,218, 90,
+		 12,140, 44,172,  4,132, 36,164, 14,142, 46,174,  6,134, 38,166,
+		204, 76,236,108,196, 68,228,100,206, 78,238,110,198, 70,230,102,
+		 60,188, 28,156, 52,180, 20,148, 62,190, 30,158, 54,182, 22,150,
+		252,124,220, 92,244,116,212, 84,254,126,222, 94,246,118,214, 86,
+		  3,131, 35,163, 11,139, 43,171,  1,129, 33,161,  9,137, 41,169,
+		195, 67,227, 99,203, 75,235,107,193, 65,225, 97,201, 73,233,105,
+		 51,179, 19,147, 59,187, 27,155, 49,177, 17,145, 57,185, 25,153,
+		243,115,211, 83,251,123,219, 91,241,113,209, 81,249,121,217, 89,
+		 15,143, 47,175,  7,135, 39,167, 13,141, 45,173,  5,133, 37,165,
+		207, 79,239,111,199, 71,231,103,205, 77,237,109,197, 69,229,101,
+		 63,191, 31,159, 55,183, 23,151, 61,189, 29,157, 53,181, 21,149,
+		255,127,223, 95,247,119,215, 87,253,125,221, 93,245,117,213, 85 };
+int* bayerMatrixes[] = {bayerMatrix2, bayerMatrix4, bayerMatrix8, bayerMatrix16};
+
+/* 64x64 blue noise texture, built by getBlueNoise() the first time an
+   instance uses it */
+#define BLUE_SIZE 64
+int blueNoise[BLUE_SIZE*BLUE_SIZE];
+#if defined(F0R_HAVE_PTHREAD)
+static pthread_once_t blueNoiseOnce = PTHREAD_ONCE_INIT;
+#else
+static int blueNoiseReady = 0;
+#endif
+
+/* patterns, in the order of the pattern parameter */
+#define PATTERN_MATRIX    0 /* one of the matrixes above, see matrixid */
+#define PATTERN_BAYER     1 /* 1..4: Bayer 2x2, 4x4, 8x8, 16x16 */
+#define PATTERN_BLUENOISE 5
+#define PATTERN_DIFFUSION 6 /* Floyd-Steinberg error diffusion */
+#define PATTERN_COUNT     7
+
+/* error diffusion tiles, see diffuse() */
+#define DIFFUSE_ROWS 32
+#define DIFFUSE_COLS 128
+
 typedef struct dither_instance
 {
   unsigned int width;
   unsigned int height;
   double levels;
   double matrixid;
+  double patternid;
+
+  /* thresholds of every pixel of the rows 0..rows-1, repeated below */
+  int16_t* thresholds;
+  int* thresholdMatrix;
+  int rows;
+  int rc;
+
+  /* error diffusion state */
+  int16_t* errors;  /* 3 channels, per row, errors pushed down from above */
+  int* carry;       /* 3 channels, per row, error pushed right to the next tile */
+  const unsigned char* src;
+  unsigned char* dst;
+  int levelCount;
+  int map[256];
+  int div[256];
+  int mod[256];
+  unsigned char nearest[256]; /* closest level, for error diffusion */
+  int step;
+  int firstGroup;
 } dither_instance_t;
 
+/* Void-and-cluster blue noise (Ulichney): a sparse random pattern is
+   relaxed until its tightest cluster and its largest void coincide, then
+   pixels are ranked by removing clusters and filling voids.  Ranks are
+   scaled to 0..255. */
+static void initBlueNoise(void)
+{
+  const int n = BLUE_SIZE, size = BLUE_SIZE*BLUE_SIZE;
+  float* kernel = (float*)malloc(size*sizeof(float));
+  float* energy = (float*)malloc(size*sizeof(float));
+  float* energy0 = (float*)malloc(size*sizeof(float));
+  unsigned char* bits = (unsigned char*)calloc(size, 1);
+  unsigned char* bits0 = (unsigned char*)malloc(size);
+  int ones = size/10, i, r, x, y;
+  uint32_t seed = 12345;
+
+  for (y = 0; y < n; y++)
+    for (x = 0; x < n; x++)
+    {
+      int dx = x < n/2 ? x : x - n, dy = y < n/2 ? y : y - n;
+      kernel[y*n + x] = (float)exp(-(dx*dx + dy*dy) / (2.0 * 1.5 * 1.5));
+    }
+  memset(energy, 0, size*sizeof(float));
+
+#define SPLAT(i, sign) \
+  do { \
+    int cx = (i) % n, cy = (i) / n, ex, ey; \
+    for (ey = 0; ey < n; ey++) \
+      for (ex = 0; ex < n; ex++) \
+        energy[ey*n + ex] += sign kernel[((ey-cy)&(n-1))*n + ((ex-cx)&(n-1))]; \
+  } while (0)
+
+  for (i = 0; i < ones; )
+  {
+    seed = seed*1103515245 + 12345;
+    r = (seed >> 8) % size;
+    if (!bits[r]) { bits[r] = 1; SPLAT(r, +); i++; }
+  }
+
+  // relax: move the tightest cluster to the largest void until stable
+  for (i = 0; i < size; i++)
+  {
+    int cluster = -1, hole = -1;
+    for (r = 0; r < size; r++)
+      if (bits[r] && (cluster < 0 || energy[r] > energy[cluster])) cluster = r;
+    bits[cluster] = 0; SPLAT(cluster, -);
+    for (r = 0; r < size; r++)
+      if (!bits[r] && (hole < 0 || energy[r] < energy[hole])) hole = r;
+    bits[hole] = 1; SPLAT(hole, +);
+    if (hole == cluster) break;
+  }
+  memcpy(bits0, bits, size);
+  memcpy(energy0, energy, size*sizeof(float));
+
+  // ranks below the prototype: remove tightest clusters
+  for (i = ones - 1; i >= 0; i--)
+  {
+    int cluster = -1;
+    for (r = 0; r < size; r++)
+      if (bits[r] && (cluster < 0 || energy[r] > energy[cluster])) cluster = r;
+    bits[cluster] = 0; SPLAT(cluster, -);
+    blueNoise[cluster] = i;
+  }
+  memcpy(bits, bits0, size);
+  memcpy(energy, energy0, size*sizeof(float));
+
+  // ranks above it: fill largest voids
+  for (i = ones; i < size; i++)
+  {
+    int hole = -1;
+    for (r = 0; r < size; r++)
+      if (!bits[r] && (hole < 0 || energy[r] < energy[hole])) hole = r;
+    bits[hole] = 1; SPLAT(hole, +);
+    blueNoise[hole] = i;
+  }
+#undef SPLAT
+
+  for (i = 0; i < size; i++)
+    blueNoise[i] = blueNoise[i] * 256 / size;
+
+  free(kernel); free(energy); free(energy0); free(bits); free(bits0);
+}
+
+static int* getBlueNoise(void)
+{
+#if defined(F0R_HAVE_PTHREAD)
+  pthread_once(&blueNoiseOnce, initBlueNoise);
+#else
+  if (!blueNoiseReady)
+  {
+    initBlueNoise();
+    blueNoiseReady = 1;
+  }
+#endif
+  return blueNoise;
+}
+
 int f0r_init()
 {
   return 1;
@@ -158,11 +342,16 @@ void f0r_get_plugin_info(f0r_plugin_info_t* dither_info)
   dither_info->color_model = F0R_COLOR_MODEL_RGBA8888;
   dither_info->frei0r_version = FREI0R_MAJOR_VERSION;
   dither_info->major_version = 0; 
-  dither_info->minor_version = 1; 
-  dither_info->num_params =  2; 
+  dither_info->minor_version = 2; 
+  dither_info->num_params =  3; 
   dither_info->explanation = "Dithers the image and reduces the number of available colors";
 }
 
+unsigned int f0r_get_capabilities(void)
+{
+  return F0R_CAP_INPLACE;
+}
+
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
   switch(param_index)
@@ -177,6 +366,11 @@ void f0r_get_param_info(f0r_param_info_t* info, int param_index)
     info->type = F0R_PARAM_DOUBLE;
     info->explanation = "Id of matrix used for dithering";
     break;
+  case 2:
+    info->name = "patternid";
+    info->type = F0R_PARAM_DOUBLE;
+    info->explanation = "Dither pattern: matrix selected by matrixid, Bayer 2x2, 4x4, 8x8, 16x16, blue noise or error diffusion";
+    break;
   }
 }
 
@@ -189,11 +383,16 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->matrixid = 1.0; // input range 0.0 - 1.0 will be interpreted as matrixid 0 - 9
                         // e.g. values 0.0, 0.12, 0.23, 0.34, 0.45, 0.56, 0.67, 0.78, 0.89, 1.0
                         // will select matrixes 0 to 9
+  inst->patternid = 0.0; // input range 0.0 - 1.0 will be interpreted as pattern 0 - 6
 	return (f0r_instance_t)inst;
 }
 
 void f0r_destruct(f0r_instance_t instance)
 {
+  dither_instance_t* inst = (dither_instance_t*)instance;
+  free(inst->thresholds);
+  free(inst->errors);
+  free(inst->carry);
   free(instance);
 }
 
@@ -211,6 +410,9 @@ void f0r_set_param_value(f0r_instance_t instance,
   case 1:
     inst->matrixid = *((double*)param);
     break;
+  case 2:
+    inst->patternid = *((double*)param);
+    break;
   }
 }
 
@@ -228,6 +430,207 @@ void f0r_get_param_value(f0r_instance_t instance,
   case 1:
     *((double*)param) = inst->matrixid;
     break;
+  case 2:
+    *((double*)param) = inst->patternid;
+    break;
+  }
+}
+
+/* Lay out the threshold matrix over full rows, so that the dither loop
+   does not need x % cols.  Only redone when the matrix changes. */
+static void initThresholds(dither_instance_t* inst, int* matrix, int rows, int cols, int rc)
+{
+  unsigned int x;
+  int y;
+
+  if (inst->thresholdMatrix == matrix)
+    return;
+  free(inst->thresholds);
+  inst->thresholds = (int16_t*)malloc(rows * inst->width * sizeof(int16_t));
+  for (y = 0; y < rows; y++)
+    for (x = 0; x < inst->width; x++)
+      inst->thresholds[y*inst->width + x] = (int16_t)matrix[y*cols + x%cols];
+  inst->thresholdMatrix = matrix;
+  inst->rows = rows;
+  inst->rc = rc;
+}
+
+/* Ordered dither of rows [first,last).  A channel value c becomes level
+   (levels-1)*c/256, plus one if c*rc/256 exceeds the threshold. */
+static void orderedRows(void* arg, int first, int last, int slice)
+{
+  dither_instance_t* inst = (dither_instance_t*)arg;
+  unsigned int width = inst->width;
+  int levels = inst->levelCount;
+  int y;
+  (void)slice;
+
+  for (y = first; y < last; ++y)
+  {
+    const unsigned char* src = inst->src + (size_t)y*width*4;
+    unsigned char* dst = inst->dst + (size_t)y*width*4;
+    const int16_t* thr = inst->thresholds + (y % inst->rows)*width;
+    unsigned int x = 0;
+    int v;
+
+#if defined(__SSE2__)
+    // 4 pixels at a time in 16 bit lanes; level*255/(levels-1) is a
+    // multiply-high by a rounded up reciprocal, corrected by one where
+    // it overshoots
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rc = _mm_set1_epi16((short)inst->rc);
+    const __m128i lm1 = _mm_set1_epi16((short)(levels - 1));
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i recip = _mm_set1_epi16((short)((255*256 + levels - 2) / (levels - 1)));
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    for (; x + 4 <= width; x += 4)
+    {
+      __m128i p = _mm_loadu_si128((const __m128i*)(src + 4*x));
+      __m128i t = _mm_loadl_epi64((const __m128i*)(thr + x));
+      __m128i res[2];
+      int h;
+      t = _mm_unpacklo_epi16(t, t);
+      for (h = 0; h < 2; h++)
+      {
+        __m128i c = h ? _mm_unpackhi_epi8(p, zero) : _mm_unpacklo_epi8(p, zero);
+        __m128i th = h ? _mm_unpackhi_epi32(t, t) : _mm_unpacklo_epi32(t, t);
+        __m128i mod = _mm_srli_epi16(_mm_mullo_epi16(c, rc), 8);
+        __m128i lev = _mm_srli_epi16(_mm_mullo_epi16(c, lm1), 8);
+        __m128i n, q;
+        lev = _mm_sub_epi16(lev, _mm_cmpgt_epi16(mod, th));
+        n = _mm_mullo_epi16(lev, c255);
+        q = _mm_mulhi_epu16(_mm_slli_epi16(lev, 8), recip);
+        q = _mm_add_epi16(q, _mm_cmpgt_epi16(_mm_mullo_epi16(q, lm1), n));
+        res[h] = q;
+      }
+      p = _mm_or_si128(_mm_andnot_si128(alpha, _mm_packus_epi16(res[0], res[1])),
+                       _mm_and_si128(alpha, p));
+      _mm_storeu_si128((__m128i*)(dst + 4*x), p);
+    }
+#endif
+    for (; x < width; ++x)
+    {
+      const unsigned char* s = src + 4*x;
+      unsigned char* d = dst + 4*x;
+      v = thr[x];
+      d[0] = inst->map[inst->mod[s[0]] > v ? inst->div[s[0]] + 1 : inst->div[s[0]]];
+      d[1] = inst->map[inst->mod[s[1]] > v ? inst->div[s[1]] + 1 : inst->div[s[1]]];
+      d[2] = inst->map[inst->mod[s[2]] > v ? inst->div[s[2]] + 1 : inst->div[s[2]]];
+      d[3] = s[3];//copy alpha
+    }
+  }
+}
+
+/* Floyd-Steinberg on one row of a tile, pixels [x0,x1).  Errors pushed
+   down land in the next row's error row, the error pushed right is
+   carried in a register and handed to the next tile through carry[]. */
+static void diffuseRow(dither_instance_t* inst, int y, int x0, int x1)
+{
+  int width = inst->width;
+  const unsigned char* src = inst->src + (size_t)y*width*4;
+  unsigned char* dst = inst->dst + (size_t)y*width*4;
+  const int16_t* here = inst->errors + (size_t)y*(width + 2)*3 + 3;
+  int16_t* below = (int16_t*)here + (width + 2)*3;
+  const unsigned char* nearest = inst->nearest;
+  int x, ch;
+
+  if (x0 == 0)
+  {
+    memset(below - 3, 0, (width + 2)*3*sizeof(int16_t));
+    inst->carry[y*3] = inst->carry[y*3 + 1] = inst->carry[y*3 + 2] = 0;
+  }
+  // the three channels are independent chains, interleaved so that their
+  // latencies overlap; the errors for x-1 and x below are kept in
+  // registers and only stored once complete
+  int carry[3], left[3], mid[3];
+  for (ch = 0; ch < 3; ++ch)
+  {
+    carry[ch] = inst->carry[y*3 + ch];
+    left[ch] = below[3*(x0 - 1) + ch];
+    mid[ch] = below[3*x0 + ch];
+  }
+  for (x = x0; x < x1; ++x)
+  {
+    for (ch = 0; ch < 3; ++ch)
+    {
+      int v = src[4*x + ch] + here[3*x + ch] + carry[ch];
+      int q, e, e7, e3, e5;
+      v = CLAMP(v, 0, 255);
+      q = nearest[v];
+      dst[4*x + ch] = (unsigned char)q;
+      e = v - q;
+      e7 = e*7/16; e3 = e*3/16; e5 = e*5/16;
+      carry[ch] = e7;
+      below[3*(x - 1) + ch] = (int16_t)(left[ch] + e3);
+      left[ch] = mid[ch] + e5;
+      mid[ch] = e - e7 - e3 - e5;
+    }
+    dst[4*x + 3] = src[4*x + 3];
+  }
+  for (ch = 0; ch < 3; ++ch)
+  {
+    below[3*(x1 - 1) + ch] = (int16_t)left[ch];
+    below[3*x1 + ch] = (int16_t)mid[ch];
+    inst->carry[y*3 + ch] = carry[ch];
+  }
+}
+
+/* Tiles are DIFFUSE_ROWS high parallelograms, every row starting one
+   pixel further left than the one above.  Then a tile only depends on
+   its left neighbour and on the tile above right of it, so all tiles on
+   a diagonal c + 2*g = step can be diffused at the same time, giving the
+   same result as diffusing the rows in order. */
+static void diffuseTiles(void* arg, int first, int last, int slice)
+{
+  dither_instance_t* inst = (dither_instance_t*)arg;
+  int width = inst->width, height = inst->height;
+  int i, y;
+  (void)slice;
+
+  for (i = first; i < last; ++i)
+  {
+    int g = inst->firstGroup + i, c = inst->step - 2*g;
+    for (y = g*DIFFUSE_ROWS; y < (g + 1)*DIFFUSE_ROWS && y < height; ++y)
+    {
+      int shift = y - g*DIFFUSE_ROWS;
+      int x0 = c*DIFFUSE_COLS - shift, x1 = x0 + DIFFUSE_COLS;
+      if (x0 < 0) x0 = 0;
+      if (x1 > width) x1 = width;
+      if (x0 < x1)
+        diffuseRow(inst, y, x0, x1);
+    }
+  }
+}
+
+static void diffuse(dither_instance_t* inst)
+{
+  int width = inst->width, height = inst->height;
+  int groups = (height + DIFFUSE_ROWS - 1) / DIFFUSE_ROWS;
+  int tiles = (width + DIFFUSE_ROWS + DIFFUSE_COLS - 1) / DIFFUSE_COLS;
+  int y;
+
+  if (!inst->errors)
+  {
+    inst->errors = (int16_t*)malloc((size_t)(height + 1)*(width + 2)*3*sizeof(int16_t));
+    inst->carry = (int*)malloc(height*3*sizeof(int));
+  }
+  memset(inst->errors, 0, (width + 2)*3*sizeof(int16_t));
+
+  if (f0r_cpu_count() == 1)
+  {
+    for (y = 0; y < height; ++y)
+      diffuseRow(inst, y, 0, width);
+    return;
+  }
+
+  for (inst->step = 0; inst->step < tiles + 2*(groups - 1); ++inst->step)
+  {
+    // groups g with 0 <= step - 2*g < tiles
+    int gmin = inst->step - tiles + 1 > 0 ? (inst->step - tiles + 2) / 2 : 0;
+    int gmax = inst->step / 2 < groups - 1 ? inst->step / 2 : groups - 1;
+    inst->firstGroup = gmin;
+    if (gmax >= gmin)
+      f0r_parallel_for(gmax - gmin + 1, 1, diffuseTiles, inst);
   }
 }
 
@@ -237,8 +640,6 @@ void f0r_update(f0r_instance_t instance, double time,
   //init and get params
   assert(instance);
   dither_instance_t* inst = (dither_instance_t*)instance;
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
 
   double levelsInput = inst->levels * 48.0;
   levelsInput = CLAMP(levelsInput, 0.0, 48.0) + 2.0;
@@ -247,56 +648,59 @@ void f0r_update(f0r_instance_t instance, double time,
   double matrixIdInput = inst->matrixid * 9.0;
   matrixIdInput = CLAMP(matrixIdInput, 0.0, 9.0);
   int matrixid = (int)matrixIdInput;
-  int* matrix = matrixes[matrixid];
-  int matrixLength = matrixSizes[matrixid];
+
+  double patternIdInput = inst->patternid * (PATTERN_COUNT - 1);
+  patternIdInput = CLAMP(patternIdInput, 0.0, PATTERN_COUNT - 1);
+  int patternid = (int)patternIdInput;
 
   // init look-ups
 	int rows, cols;
-  rows = cols = (int)sqrt(matrixLength);
-  int map[levels];
   int i,v;
+  int* matrix;
+  if (patternid == PATTERN_MATRIX || patternid == PATTERN_DIFFUSION)
+  {
+    matrix = matrixes[matrixid];
+    rows = cols = (int)sqrt(matrixSizes[matrixid]);
+  }
+  else if (patternid < PATTERN_BLUENOISE)
+  {
+    matrix = bayerMatrixes[patternid - PATTERN_BAYER];
+    rows = cols = 2 << (patternid - PATTERN_BAYER);
+  }
+  else
+  {
+    matrix = getBlueNoise();
+    rows = cols = 16; // ranks are 0..255
+  }
+	int rc = (rows * cols + 1);
+  if (matrix == blueNoise)
+    rows = cols = BLUE_SIZE;
+
 	for (i = 0; i < levels; i++)
   {
 		v = 255 * i / (levels-1);
-		map[i] = v;
+		inst->map[i] = v;
 	}
 
-	int div[256];
-	int mod[256];
-	int rc = (rows * cols + 1);
 	for (i = 0; i < 256; i++)
   {
-		div[i] = (levels-1) * i / 256;
-		mod[i] = i * rc /256;
+		inst->div[i] = (levels-1) * i / 256;
+		inst->mod[i] = i * rc /256;
 	}
 
-  // filter image
-  unsigned int width = inst->width;
-  unsigned int height = inst->height;
-  unsigned int x,y,col,row;
-  unsigned char r, g, b;
-  for (y = 0; y < height; ++y)
+  inst->levelCount = levels;
+  inst->src = (const unsigned char*)inframe;
+  inst->dst = (unsigned char*)outframe;
+
+  if (patternid == PATTERN_DIFFUSION)
   {
-      for (x=0; x < width; ++x)
-      {
-        r = *src++;
-        g = *src++;
-        b = *src++;
-
-	      col = x % cols;
-	      row = y % rows;
-
-	      v = matrix[ row * cols + col];
-	      r = map[mod[r] > v ? div[r] + 1 : div[r]];
-		    g = map[mod[g] > v ? div[g] + 1 : div[g]];
-		    b = map[mod[b] > v ? div[b] + 1 : div[b]];
-
-        *dst++ = r;
-        *dst++ = g;
-        *dst++ = b;
-        *dst++ = *src++;//copy alpha
-      }
+    for (i = 0; i < 256; i++)
+      inst->nearest[i] = (unsigned char)inst->map[(i*(levels - 1) + 127) / 255];
+    diffuse(inst);
+    return;
   }
-}
-
 
+  // filter image
+  initThresholds(inst, matrix, rows, cols, rc);
+  f0r_parallel_for(inst->height, 16, orderedRows, inst);
+}
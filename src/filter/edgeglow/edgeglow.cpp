@@ -30,14 +30,18 @@ public:
   double lredscale;
 
 
+  static void describe(frei0r::param_list<edgeglow>& params)
+  {
+    params.add(&edgeglow::lthresh, "lthresh", "threshold for edge lightening");
+    params.add(&edgeglow::lupscale, "lupscale", "multiplier for upscaling edge brightness");
+    params.add(&edgeglow::lredscale, "lredscale", "multiplier for downscaling non-edge brightness");
+  }
+
   edgeglow(unsigned int width, unsigned int height)
   {
     lthresh = 0.0;
     lupscale = 0.0;
     lredscale = 0.0;
-    register_param(lthresh, "lthresh", "threshold for edge lightening");
-    register_param(lupscale, "lupscale", "multiplier for upscaling edge brightness");
-    register_param(lredscale, "lredscale", "multiplier for downscaling non-edge brightness");
   }
   
   virtual void update(double time,
@@ -17,6 +17,7 @@
  */
 
 #include "frei0r.hpp"
+#include "frei0r_thread.h"
 
 // Limits (min/max values) of various data types
 #include <limits>
@@ -25,6 +26,10 @@
 // pow() and other mathematical functions
 #include <cmath>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define PI 3.141592654
 
 /**
@@ -38,6 +43,11 @@ typedef struct {
     unsigned int lowerXPos;
     double lowerWeight;
     double higherWeight;
+    // the same in 8.8 fixed point: blend of the pixels at fixedPos
+    // and fixedPos+1, which always both lie within the row
+    unsigned int fixedPos;
+    uint16_t fixedLowerWeight;
+    uint16_t fixedHigherWeight;
 } TransformationElem;
 
 
@@ -46,17 +56,20 @@ class ElasticScale : public frei0r::filter
 
 public:
 
+    static void describe(frei0r::param_list<ElasticScale>& params)
+    {
+        params.add(&ElasticScale::m_scaleCenter,"Center","Horizontal center position of the linear area");
+        params.add(&ElasticScale::m_linearScaleArea,"Linear Width","Width of the linear area");
+        params.add(&ElasticScale::m_linearScaleFactor,"Linear Scale Factor","Amount how much the linear area is scaled");
+        params.add(&ElasticScale::m_nonLinearScaleFactor,"Non-Linear Scale Factor","Amount how much the outer left and outer right areas are scaled non linearly");
+    }
+
     ElasticScale(unsigned int width, unsigned int height)
 
     {
         this->width = width;
         this->height = height;
 
-        register_param(m_scaleCenter,"Center","Horizontal center position of the linear area");
-        register_param(m_linearScaleArea,"Linear Width","Width of the linear area");
-        register_param(m_linearScaleFactor,"Linear Scale Factor","Amount how much the linear area is scaled");
-        register_param(m_nonLinearScaleFactor,"Non-Linear Scale Factor","Amount how much the outer left and outer right areas are scaled non linearly");
-
         // default values for sinus based scaling
         m_scaleCenter = 0.5;
         m_linearScaleArea = 0.0;
@@ -84,47 +97,62 @@ public:
             calcTransformationFactors();
         }
 
-        // pad the rowWidth to be a multiple of 8
-        unsigned int paddedRowWidth = width;
-        if (paddedRowWidth % 8 != 0)
-        {
-            paddedRowWidth = (unsigned int)(ceil((double)width/8)*8);
-        }
+        m_in = in;
+        m_out = out;
+        f0r_parallel_for(height, 16, scaleRows, this);
+    }
 
-        for (unsigned int colIdx = 0; colIdx < width; colIdx++)
+private:
+
+    const uint32_t* m_in;
+    uint32_t* m_out;
+
+    // Horizontal resampling of a band of rows, row by row so both frames
+    // are walked sequentially.
+    static void scaleRows(void* arg, int first, int last, int slice)
+    {
+        ElasticScale* self = static_cast<ElasticScale*>(arg);
+        const TransformationElem* columns = self->m_transformationCalculations;
+        unsigned int width = self->width;
+        (void)slice;
+
+        for (int rowIdx = first; rowIdx < last; rowIdx++)
         {
-            double lowerWeight = m_transformationCalculations[colIdx].lowerWeight;
-            double higherWeight = m_transformationCalculations[colIdx].higherWeight;
+            const uint32_t* src = self->m_in + width * rowIdx;
+            uint32_t* dst = self->m_out + width * rowIdx;
 
-            for (unsigned int rowIdx = 0; rowIdx < height; rowIdx++)
+            if (width < 2)
             {
-                uint32_t newValue = 0;
-                unsigned int lowerXPos = paddedRowWidth * rowIdx + m_transformationCalculations[colIdx].lowerXPos;
-                unsigned int higherXPos = paddedRowWidth * rowIdx + m_transformationCalculations[colIdx].higherXPos;
-                unsigned int curPosDst = paddedRowWidth * rowIdx + colIdx;
-
-                if (higherXPos == lowerXPos) {
-                    newValue = in[higherXPos];
-                } else {
-                    for (int i=0; i<4; i++)
-                    {
-                        uint16_t cFold = uint8_t(in[lowerXPos] >> 8*i);
-                        uint16_t cCold = uint8_t(in[higherXPos] >> 8*i);
-                        cFold = (uint16_t)((double)cFold*(1-lowerWeight));
-                        cCold = (uint16_t)((double)cCold*(1-higherWeight));
-                        newValue |= ((uint8_t)((cFold + cCold)) << 8*i);
-                    }
-                }
-
-                out[curPosDst] = newValue;
+                if (width == 1)
+                    dst[0] = src[0];
+                continue;
             }
 
+            for (unsigned int colIdx = 0; colIdx < width; colIdx++)
+            {
+                const TransformationElem& c = columns[colIdx];
+#if defined(__SSE2__)
+                // both source pixels in one load, their channels
+                // interleaved as pairs for a multiply-add with the weights
+                __m128i p = _mm_loadl_epi64((const __m128i*)(src + c.fixedPos));
+                p = _mm_unpacklo_epi8(p, _mm_setzero_si128());
+                p = _mm_unpacklo_epi16(p, _mm_srli_si128(p, 8));
+                __m128i v = _mm_madd_epi16(p, _mm_set1_epi32((c.fixedHigherWeight << 16) | c.fixedLowerWeight));
+                v = _mm_srli_epi32(_mm_add_epi32(v, _mm_set1_epi32(128)), 8);
+                v = _mm_packs_epi32(v, v);
+                dst[colIdx] = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+#else
+                const uint8_t* lo = (const uint8_t*)(src + c.fixedPos);
+                const uint8_t* hi = lo + 4;
+                uint32_t newValue = 0;
+                for (int i=0; i<4; i++)
+                    newValue |= ((lo[i] * c.fixedLowerWeight + hi[i] * c.fixedHigherWeight + 128) >> 8) << 8*i;
+                dst[colIdx] = newValue;
+#endif
+            }
         }
-
     }
 
-private:
-
     // input params    
     double m_linearScaleArea;
     double m_scaleCenter;
@@ -297,6 +325,18 @@ private:
             m_transformationCalculations[colIdx].higherWeight = higherWeight;
             m_transformationCalculations[colIdx].lowerWeight = lowerWeight;
 
+            TransformationElem& elem = m_transformationCalculations[colIdx];
+            elem.fixedPos = elem.lowerXPos;
+            elem.fixedHigherWeight = elem.higherXPos == elem.lowerXPos ? 0 : (uint16_t)floor(lowerWeight * 256 + 0.5);
+            elem.fixedLowerWeight = 256 - elem.fixedHigherWeight;
+            if (width > 1 && elem.fixedPos >= width - 1)
+            {
+                // last pixel of the row, blend it from the left instead
+                elem.fixedPos = width - 2;
+                elem.fixedHigherWeight = 256;
+                elem.fixedLowerWeight = 0;
+            }
+
         }
     }
 
@@ -19,85 +19,150 @@
 
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_thread.h"
 #include <string.h>
 
-#include <cstring>
+#include <vector>
 
 class equaliz0r : public frei0r::filter
 {
-  // Look-up tables for equaliz0r values.
-  unsigned char rlut[256];
-  unsigned char glut[256];
-  unsigned char blut[256];
-  
-  // Intensity histograms.
-  unsigned int rhist[256];
-  unsigned int ghist[256];
-  unsigned int bhist[256];
+  // Parameters.
+  double smoothing;
+  double subsample;
+  bool   clahe;
+  double tiles;
+  double cliplimit;
+
+  // Tile grid the look-up tables below were built for; global
+  // equalization is the special case of a single tile.
+  unsigned int ntiles;
+
+  // Look-up tables for equaliz0r values, 3 x 256 entries per tile.  The
+  // float copy carries the temporal smoothing from frame to frame.
+  std::vector<float> smoothed;
+  std::vector<unsigned char> luts;
+  bool primed;
+
+  // Intensity histograms, 3 x 256 bins per slice (global mode) or per
+  // tile (CLAHE mode).
+  std::vector<unsigned int> hists;
 
-  void updateLookUpTables(const uint32_t* in)
+  // CLAHE interpolation tables: the two neighbouring tiles of every
+  // column / row and the 8 bit weight of the second one.
+  std::vector<unsigned int> xtile, ytile;
+  std::vector<unsigned int> xweight, yweight;
+
+  // Current frame and sampling step, for the slice workers.
+  const uint32_t* src;
+  uint32_t* dst;
+  unsigned int step;
+
+  unsigned int tileX(unsigned int t) const { return width * t / ntiles; }
+  unsigned int tileY(unsigned int t) const { return height * t / ntiles; }
+
+  // Adds every step-th pixel of every step-th row of a region to hist.
+  unsigned int accumulate(unsigned int* hist,
+                          unsigned int x0, unsigned int y0,
+                          unsigned int x1, unsigned int y1) const
   {
-    unsigned int size = width*height;
-    
-    // First pass : build histograms.
-    
-    // Reset histograms.
-    memset(rhist, 0, 256*sizeof(unsigned int));
-    memset(ghist, 0, 256*sizeof(unsigned int));
-    memset(bhist, 0, 256*sizeof(unsigned int));
-
-    // Update histograms.
-    const unsigned char *in_ptr = (const unsigned char*) in;
-    for (unsigned int i=0; i<size; ++i)
+    unsigned int count = 0;
+    for (unsigned int y = y0; y < y1; y += step)
     {
-      // update 'em
-      rhist[*in_ptr++]++;
-      ghist[*in_ptr++]++;
-      bhist[*in_ptr++]++;
-      in_ptr++; // skip alpha
+      const unsigned char *in_ptr = (const unsigned char*) (src + y*width + x0);
+      for (unsigned int x = x0; x < x1; x += step, in_ptr += 4*step)
+      {
+        hist[      in_ptr[0]]++;
+        hist[256 + in_ptr[1]]++;
+        hist[512 + in_ptr[2]]++;
+      }
+      count += (x1 - x0 + step - 1) / step;
     }
+    return count;
+  }
 
-    // Second pass : update look-up tables.
-    in_ptr = (const unsigned char*) in;
+  // Turns the histograms of one tile into its look-up tables.  With a
+  // clip limit the bins are cut at that multiple of the mean bin height
+  // and the excess is handed back evenly, which is what bounds the
+  // contrast gain in CLAHE.
+  void equalize(unsigned int* hist, unsigned int count, unsigned int tile)
+  {
+    if (count == 0)
+      count = 1;
+
+    unsigned int clip = 0;
+    if (clahe && cliplimit > 0)
+      clip = (unsigned int) (cliplimit * 10.0 * count / 256) + 1;
 
-    // Cumulative intensities of histograms.
-    unsigned int
-      rcum = 0,
-      gcum = 0,
-      bcum = 0;
-      
-    for (int i=0; i<256; ++i)
+    float* smooth = &smoothed[tile * 768];
+    unsigned char* lut = &luts[tile * 768];
+    float keep = primed ? (float) CLAMP(smoothing, 0.0, 1.0) : 0.0f;
+
+    for (int c=0; c<3; ++c, hist += 256, smooth += 256, lut += 256)
     {
-      // update cumulatives
-      rcum += rhist[i];
-      gcum += ghist[i];
-      bcum += bhist[i];
-      
-      // update 'em
-      rlut[i] = CLAMP0255( (rcum << 8) / size ); // = 256 * rcum / size
-      glut[i] = CLAMP0255( (gcum << 8) / size ); // = 256 * gcum / size
-      blut[i] = CLAMP0255( (bcum << 8) / size ); // = 256 * bcum / size
-      
-      in_ptr++; // skip alpha
+      unsigned int bonus = 0, total = count;
+      if (clip)
+      {
+        unsigned int excess = 0;
+        for (int i=0; i<256; ++i)
+          if (hist[i] > clip)
+          {
+            excess += hist[i] - clip;
+            hist[i] = clip;
+          }
+        bonus = excess / 256;
+        total -= excess % 256; // what the even split leaves over
+      }
+
+      // Cumulative intensities of histograms.
+      unsigned long long cum = 0;
+      for (int i=0; i<256; ++i)
+      {
+        cum += hist[i] + bonus;
+        float target = (float) ((cum << 8) / total); // = 256 * cum / total
+        smooth[i] = keep * smooth[i] + (1.0f - keep) * target;
+        lut[i] = CLAMP0255(ROUND(smooth[i]));
+      }
     }
+  }
 
+  // First pass of global mode: one partial histogram per slice of rows.
+  static void histogramSlice(void* arg, int first, int last, int slice)
+  {
+    equaliz0r* self = static_cast<equaliz0r*>(arg);
+    unsigned int* hist = &self->hists[slice * 768];
+    memset(hist, 0, 768*sizeof(unsigned int));
+    self->accumulate(hist, 0, first * self->step, self->width,
+                     MIN(last * self->step, self->height));
   }
-  
-public:
-  equaliz0r(unsigned int width, unsigned int height)
+
+  // First pass of CLAHE mode: histogram and look-up tables of each tile.
+  static void tileSlice(void* arg, int first, int last, int slice)
   {
+    equaliz0r* self = static_cast<equaliz0r*>(arg);
+    (void)slice;
+    for (int t=first; t<last; ++t)
+    {
+      unsigned int tx = t % self->ntiles, ty = t / self->ntiles;
+      unsigned int* hist = &self->hists[t * 768];
+      memset(hist, 0, 768*sizeof(unsigned int));
+      unsigned int count = self->accumulate(hist,
+                                            self->tileX(tx), self->tileY(ty),
+                                            self->tileX(tx+1), self->tileY(ty+1));
+      self->equalize(hist, count, t);
+    }
   }
-  
-  virtual void update(double time,
-                      uint32_t* out,
-                      const uint32_t* in)
+
+  // Second pass of global mode.
+  static void applySlice(void* arg, int first, int last, int slice)
   {
-    std::copy(in, in + width*height, out);
-    updateLookUpTables(in);
-    unsigned int size = width*height;
-    const unsigned char *in_ptr = (const unsigned char*) in;
-    unsigned char *out_ptr = (unsigned char*) out;
-    for (unsigned int i=0; i<size; ++i)
+    equaliz0r* self = static_cast<equaliz0r*>(arg);
+    (void)slice;
+    const unsigned char* rlut = &self->luts[0];
+    const unsigned char* glut = rlut + 256;
+    const unsigned char* blut = rlut + 512;
+    const unsigned char *in_ptr = (const unsigned char*) (self->src + first*self->width);
+    unsigned char *out_ptr = (unsigned char*) (self->dst + first*self->width);
+    for (unsigned int i=first*self->width; i<last*self->width; ++i)
     {
       *out_ptr++ = rlut[*in_ptr++];
       *out_ptr++ = glut[*in_ptr++];
@@ -105,6 +170,131 @@ public:
       *out_ptr++ = *in_ptr++; // copy alpha
     }
   }
+
+  // Second pass of CLAHE mode: bilinear blend of the four nearest tiles.
+  static void applyTilesSlice(void* arg, int first, int last, int slice)
+  {
+    equaliz0r* self = static_cast<equaliz0r*>(arg);
+    (void)slice;
+    const unsigned int n = self->ntiles;
+    for (int y=first; y<last; ++y)
+    {
+      const unsigned char* row0 = &self->luts[self->ytile[y] * n * 768];
+      const unsigned char* row1 = row0 + (self->ytile[y] + 1 < n ? n * 768 : 0);
+      unsigned int wy = self->yweight[y];
+      const unsigned char *in_ptr = (const unsigned char*) (self->src + y*self->width);
+      unsigned char *out_ptr = (unsigned char*) (self->dst + y*self->width);
+      for (unsigned int x=0; x<self->width; ++x)
+      {
+        unsigned int t0 = self->xtile[x] * 768;
+        unsigned int t1 = self->xtile[x] + 1 < n ? t0 + 768 : t0;
+        unsigned int wx = self->xweight[x];
+        for (int c=0; c<3; ++c)
+        {
+          unsigned int v = c*256 + *in_ptr++;
+          unsigned int top = row0[t0 + v] * (256 - wx) + row0[t1 + v] * wx;
+          unsigned int bottom = row1[t0 + v] * (256 - wx) + row1[t1 + v] * wx;
+          *out_ptr++ = (top * (256 - wy) + bottom * wy + 32768) >> 16;
+        }
+        *out_ptr++ = *in_ptr++; // copy alpha
+      }
+    }
+  }
+
+  // Tile index and weight of every pixel along one axis, measured from
+  // the tile centres.
+  static void interpolation(unsigned int length, unsigned int n,
+                            std::vector<unsigned int>& tile,
+                            std::vector<unsigned int>& weight)
+  {
+    tile.resize(length);
+    weight.resize(length);
+    for (unsigned int i=0; i<length; ++i)
+    {
+      double f = (i + 0.5) * n / length - 0.5;
+      if (f <= 0)
+      {
+        tile[i] = 0;
+        weight[i] = 0;
+      }
+      else if (f >= n - 1)
+      {
+        tile[i] = n - 1;
+        weight[i] = 0;
+      }
+      else
+      {
+        tile[i] = (unsigned int) f;
+        weight[i] = ROUND((f - tile[i]) * 256);
+      }
+    }
+  }
+
+  void updateLookUpTables()
+  {
+    unsigned int n = clahe ? CLAMP(ROUND(tiles * 100), 2, 16) : 1;
+    if (n != ntiles)
+    {
+      ntiles = n;
+      smoothed.assign(n * n * 768, 0.0f);
+      luts.assign(n * n * 768, 0);
+      primed = false;
+    }
+    step = 1 + ROUND(CLAMP(subsample, 0.0, 1.0) * 15);
+
+    if (clahe)
+    {
+      hists.resize(n * n * 768);
+      f0r_parallel_for(n * n, 1, tileSlice, this);
+      interpolation(width, n, xtile, xweight);
+      interpolation(height, n, ytile, yweight);
+    }
+    else
+    {
+      // Histograms of all slices, then reduced into the first one.
+      int rows = (height + step - 1) / step;
+      int slices = f0r_slice_count(rows, 16);
+      hists.resize(slices * 768);
+      f0r_parallel_for(rows, 16, histogramSlice, this);
+      for (int s=1; s<slices; ++s)
+        for (int i=0; i<768; ++i)
+          hists[i] += hists[s*768 + i];
+
+      unsigned int count = ((width + step - 1) / step) * rows;
+      equalize(&hists[0], count, 0);
+    }
+    primed = true;
+  }
+
+public:
+  static void describe(frei0r::param_list<equaliz0r>& params)
+  {
+    params.add(&equaliz0r::smoothing, "Smoothing", "Temporal smoothing of the look-up tables; 0 follows every frame, close to 1 adapts slowly and removes flicker");
+    params.add(&equaliz0r::subsample, "Subsample", "Build the histograms from every n-th row and column only, n divided by 16");
+    params.add(&equaliz0r::clahe, "CLAHE", "Contrast limited equalization per tile instead of over the whole frame");
+    params.add(&equaliz0r::tiles, "Tiles", "Number of CLAHE tiles per side, divided by 100");
+    params.add(&equaliz0r::cliplimit, "Clip limit", "CLAHE histogram clip limit as a multiple of the mean bin height, divided by 10; 0 disables clipping");
+  }
+
+  equaliz0r(unsigned int width, unsigned int height)
+    : ntiles(0), primed(false)
+  {
+    smoothing = 0.0;
+    subsample = 0.0;
+    clahe = false;
+    tiles = 0.08;
+    cliplimit = 0.3;
+  }
+  
+  virtual void update(double time,
+                      uint32_t* out,
+                      const uint32_t* in)
+  {
+    src = in;
+    dst = out;
+    updateLookUpTables();
+    f0r_parallel_for(height, 16, clahe ? applyTilesSlice : applySlice, this);
+  }
 };
 
 
@@ -18,9 +18,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_worker.hpp"
 
 class TrackedObj {
 public:
@@ -47,6 +49,7 @@ const int TrackedObj::hist_bins = 30;
 class FaceBl0r: public frei0r::filter {
 
 public:
+    static void describe(frei0r::param_list<FaceBl0r>& params);
     FaceBl0r(int wdt, int hgt);
     ~FaceBl0r() = default;
 
@@ -58,6 +61,20 @@ private:
 
 //trackface
     std::vector<cv::Rect> detect_face();
+    std::vector<cv::Rect> detect_face_async();
+
+    // a gray frame and the search parameters handed to the detector
+    struct detect_job
+    {
+        cv::Mat gray;
+        double scale;
+        int neighbors;
+        int min;
+    };
+    detect_job prepare();
+    std::vector<cv::Rect> detect_gray(const detect_job& job);
+
+    typedef frei0r::latest_worker<detect_job, std::vector<cv::Rect> > detect_worker;
 
     TrackedObj tracked_obj;
 
@@ -75,11 +92,17 @@ private:
     double neighbors;
     double smallest;
     double largest;
+    bool async;
+    double staleness;
 
     std::string old_classifier;
 
     unsigned int face_found;
     unsigned int face_notfound;
+    unsigned long frame;
+
+    // declared last so it is joined before the cascade it uses goes away
+    std::unique_ptr<detect_worker> worker;
 };
 
 
@@ -88,36 +111,45 @@ frei0r::construct<FaceBl0r> plugin("FaceBl0r",
 				  "ZioKernel, Biilly, Jilt, Jaromil, ddennedy",
 				  1,1, F0R_COLOR_MODEL_BGRA8888);
 
+void FaceBl0r::describe(frei0r::param_list<FaceBl0r>& params)
+{
+  params.add(&FaceBl0r::classifier,
+             "Classifier",
+             "Full path to the XML pattern model for recognition; look in /usr/share/opencv/haarcascades");
+  params.add(&FaceBl0r::ellipse, "Ellipse", "Draw a red ellipse around the object");
+  params.add(&FaceBl0r::recheck, "Recheck", "How often to detect an object in number of frames, divided by 1000");
+  params.add(&FaceBl0r::threads, "Threads", "How many threads to use divided by 100; 0 uses CPU count");
+  params.add(&FaceBl0r::search_scale, "Search scale", "The search window scale factor, divided by 10");
+  params.add(&FaceBl0r::neighbors, "Neighbors", "Minimum number of rectangles that makes up an object, divided by 100");
+  params.add(&FaceBl0r::smallest, "Smallest", "Minimum window size in pixels, divided by 1000");
+  params.add(&FaceBl0r::largest, "Largest", "Maximum object size in pixels, divided by 10000");
+  params.add(&FaceBl0r::async, "Async", "Detect on a background thread instead of stalling the frame that rechecks");
+  params.add(&FaceBl0r::staleness, "Staleness", "In async mode, ignore detections older than this many frames, divided by 1000; 0 accepts all");
+}
+
 FaceBl0r::FaceBl0r(int wdt, int hgt) {
 
   face_found = 0;
+  frame = 0;
 
   classifier = "/usr/share/opencv/haarcascades/haarcascade_frontalface_default.xml";
-  register_param(classifier,
-                 "Classifier",
-                 "Full path to the XML pattern model for recognition; look in /usr/share/opencv/haarcascades");
   ellipse = false;
-  register_param(ellipse, "Ellipse", "Draw a red ellipse around the object");
   recheck = 0.025;
   face_notfound = cvRound(recheck * 1000);
-  register_param(recheck, "Recheck", "How often to detect an object in number of frames, divided by 1000");
   threads = 0.01; //number of CPUs
-  register_param(threads, "Threads", "How many threads to use divided by 100; 0 uses CPU count");
   search_scale = 0.12; // increase size of search window by 20% on each pass
-  register_param(search_scale, "Search scale", "The search window scale factor, divided by 10");
   neighbors = 0.02; // require 2 neighbors
-  register_param(neighbors, "Neighbors", "Minimum number of rectangles that makes up an object, divided by 100");
   smallest = 0.0; // smallest window size is trained default
-  register_param(smallest, "Smallest", "Minimum window size in pixels, divided by 1000");
   largest = 0.0500; // largest object size shown is 500 px
-  register_param(largest, "Largest", "Maximum object size in pixels, divided by 10000");
+  async = false;
+  staleness = 0.0;
 }
 
 void FaceBl0r::update(double time,
                       uint32_t* out,
                       const uint32_t* in)
 {
-    if (cascade.empty()) {
+    if (cascade.empty() || classifier != old_classifier) {
         cv::setNumThreads(cvRound(threads * 100));
         if (classifier.length() == 0 || classifier == old_classifier) {
             // same as before, avoid repeating error messages
@@ -125,13 +157,14 @@ void FaceBl0r::update(double time,
             return;
         }
         old_classifier = classifier;
-    }
+        worker.reset();
 
-    if (!cascade.load(classifier.c_str())) {
-        fprintf(stderr, "ERROR in filter facebl0r, classifier cascade not found:\n");
-        fprintf(stderr, " %s\n", classifier.c_str());
-        memcpy(out, in, size * 4);
-        return;
+        if (!cascade.load(classifier.c_str())) {
+            fprintf(stderr, "ERROR in filter facebl0r, classifier cascade not found:\n");
+            fprintf(stderr, " %s\n", classifier.c_str());
+            memcpy(out, in, size * 4);
+            return;
+        }
     }
 
   // sanitize parameters
@@ -142,6 +175,9 @@ void FaceBl0r::update(double time,
   // copy input image to OpenCV
   image = cv::Mat(height, width, CV_8UC4, (void*)in);
   tracked_obj.update_hue_image(image);
+  frame++;
+  if (!async)
+      worker.reset();
 
   /*
     no face*
@@ -153,7 +189,9 @@ void FaceBl0r::update(double time,
    */
   if(face_notfound>0) {
       std::vector<cv::Rect> faces;
-      if(face_notfound % cvRound(recheck * 1000) == 0)
+      if (async)
+          faces = detect_face_async();
+      else if(face_notfound % cvRound(recheck * 1000) == 0)
           faces = detect_face();
 
       // if no face detected
@@ -202,6 +240,53 @@ void FaceBl0r::update(double time,
 
 /* Given an image and a classider, detect and return region. */
 std::vector<cv::Rect> FaceBl0r::detect_face()
+{
+    if (cascade.empty()) {
+        return std::vector<cv::Rect>();
+    }
+
+     return detect_gray(prepare());
+}
+
+/* Snapshot the frame and the parameters, which the host may change while
+   the worker thread is still searching. */
+FaceBl0r::detect_job FaceBl0r::prepare()
+{
+    detect_job job;
+    cv::cvtColor(image, job.gray, cv::COLOR_BGR2GRAY);
+    job.scale = search_scale * 10.0;
+    job.neighbors = cvRound(neighbors * 100);
+    job.min = cvRound(smallest * 1000);
+    return job;
+}
+
+/* Hand the current frame to the background detector when it is idle and
+   return its newest result, as long as that is not too old to track from. */
+std::vector<cv::Rect> FaceBl0r::detect_face_async()
+{
+    if (!worker)
+        worker.reset(new detect_worker(
+            std::bind(&FaceBl0r::detect_gray, this, std::placeholders::_1)));
+
+    std::vector<cv::Rect> faces;
+    unsigned long seq;
+    bool fresh = worker->fetch(faces, seq);
+
+    if (!worker->busy())
+        worker->submit(prepare(), frame);
+
+    unsigned long maxAge = abs(cvRound(staleness * 1000));
+    if (!fresh || (maxAge > 0 && frame - seq > maxAge))
+        faces.clear();
+    else
+        for (size_t i = 0; i < faces.size(); i++)
+            faces[i] &= cv::Rect({0, 0}, image.size());
+    return faces;
+}
+
+/* Run the cascade on a gray image; may be called from the worker thread,
+   so it touches nothing but the job and the cascade. */
+std::vector<cv::Rect> FaceBl0r::detect_gray(const detect_job& job)
 {
     if (cascade.empty()) {
         return std::vector<cv::Rect>();
@@ -209,18 +294,16 @@ std::vector<cv::Rect> FaceBl0r::detect_face()
 
      //use an equalized gray image for better recognition
      cv::Mat gray;
-     cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-     cv::equalizeHist(gray, gray);
+     cv::equalizeHist(job.gray, gray);
 
       //get a sequence of faces in image
-      int min = cvRound(smallest * 1000);
       std::vector<cv::Rect> faces;
       cascade.detectMultiScale(gray, faces,
-         search_scale * 10.0,
-         cvRound(neighbors * 100),
+         job.scale,
+         job.neighbors,
          cv::CASCADE_FIND_BIGGEST_OBJECT|//since we track only the first, get the biggest
          cv::CASCADE_DO_CANNY_PRUNING,  //skip regions unlikely to contain a face
-         cv::Size(min, min));
+         cv::Size(job.min, job.min));
 
     return faces;
 }
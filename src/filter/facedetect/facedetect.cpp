@@ -20,9 +20,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_worker.hpp"
 
 #define USE_ROI
 #define PAD (40)
@@ -37,9 +39,24 @@ class FaceDetect: public frei0r::filter
 {
 
 private:
+    // a downscaled gray frame, cut to the region of interest, handed to
+    // the detector
+    struct detect_job
+    {
+        cv::Mat small;
+        cv::Rect roi;
+        double scale;
+        int min;
+    };
+    typedef frei0r::latest_worker<detect_job, std::vector<cv::Rect> > detect_worker;
+
     cv::Mat image;
     unsigned count;
+    unsigned long frame;
     std::vector<cv::Rect> objects;
+    unsigned long objects_frame;
+    std::vector<cv::Rect> previous;
+    unsigned long previous_frame;
     cv::Rect roi;
     cv::CascadeClassifier cascade;
 
@@ -56,54 +73,70 @@ private:
     bool   antialias;
     double alpha;
     f0r_param_color  color[5];
+    bool   async;
+    double staleness;
+    bool   interpolate;
 
     std::string old_classifier;
 
+    // declared last so it is joined before the cascade it uses goes away
+    std::unique_ptr<detect_worker> worker;
+
 public:
+    static void describe(frei0r::param_list<FaceDetect>& params)
+    {
+        params.add(&FaceDetect::classifier,
+                   "Classifier",
+                   "Full path to the XML pattern model for recognition; look in /usr/share/opencv/haarcascades");
+        params.add(&FaceDetect::threads, "Threads", "How many threads to use divided by 100; 0 uses CPU count");
+        params.add(&FaceDetect::shape, "Shape", "The shape to draw: 0=circle, 0.1=ellipse, 0.2=rectangle, 1=random");
+        params.add(&FaceDetect::recheck, "Recheck", "How often to detect an object in number of frames, divided by 1000");
+        params.add(&FaceDetect::search_scale, "Search scale", "The search window scale factor, divided by 10");
+        params.add(&FaceDetect::neighbors, "Neighbors", "Minimum number of rectangles that makes up an object, divided by 100");
+        params.add(&FaceDetect::smallest, "Smallest", "Minimum window size in pixels, divided by 1000");
+        params.add(&FaceDetect::scale, "Scale", "Down scale the image prior detection");
+        params.add(&FaceDetect::stroke, "Stroke", "Line width, divided by 100, or fill if 0");
+        params.add(&FaceDetect::antialias, "Antialias", "Draw with antialiasing");
+        params.add(&FaceDetect::alpha, "Alpha", "The alpha channel value for the shapes");
+        params.add(&FaceDetect::color, 0, "Color 1", "The color of the first object");
+        params.add(&FaceDetect::color, 1, "Color 2", "The color of the second object");
+        params.add(&FaceDetect::color, 2, "Color 3", "The color of the third object");
+        params.add(&FaceDetect::color, 3, "Color 4", "The color of the fourth object");
+        params.add(&FaceDetect::color, 4, "Color 5", "The color of the fifth object");
+        params.add(&FaceDetect::async, "Async", "Detect on a background thread and draw the latest results without waiting");
+        params.add(&FaceDetect::staleness, "Staleness", "In async mode, drop results older than this many frames, divided by 1000; 0 keeps them");
+        params.add(&FaceDetect::interpolate, "Interpolate", "In async mode, move the shapes along with the motion between the last two detections");
+    }
+
     FaceDetect(int width, int height)
-        : count(0)
+        : count(0), frame(0), objects_frame(0), previous_frame(0)
     {
         roi.width = roi.height = 0;
         roi.x = roi.y = 0;
         classifier = "/usr/share/opencv/haarcascades/haarcascade_frontalface_default.xml";
-        register_param(classifier,
-                       "Classifier",
-                       "Full path to the XML pattern model for recognition; look in /usr/share/opencv/haarcascades"); 
         threads = 0.01; //number of CPUs
-        register_param(threads, "Threads", "How many threads to use divided by 100; 0 uses CPU count");
         shape = 0.0;
-        register_param(shape, "Shape", "The shape to draw: 0=circle, 0.1=ellipse, 0.2=rectangle, 1=random");
         recheck = 0.025;
-        register_param(recheck, "Recheck", "How often to detect an object in number of frames, divided by 1000");
         search_scale = 0.12; // increase size of search window by 20% on each pass
-        register_param(search_scale, "Search scale", "The search window scale factor, divided by 10");
         neighbors = 0.02; // require 2 neighbors
-        register_param(neighbors, "Neighbors", "Minimum number of rectangles that makes up an object, divided by 100");
         smallest = 0.0; // smallest window size is trained default
-        register_param(smallest, "Smallest", "Minimum window size in pixels, divided by 1000");
         scale = 1.0 / 1.5;
-        register_param(scale, "Scale", "Down scale the image prior detection");
         stroke = 0.0;
-        register_param(stroke, "Stroke", "Line width, divided by 100, or fill if 0");
         antialias = false;
-        register_param(antialias, "Antialias", "Draw with antialiasing");
         alpha = 1.0;
-        register_param(alpha, "Alpha", "The alpha channel value for the shapes");
         f0r_param_color color0 = {1.0, 1.0, 1.0};
         color[0] = color0;
-        register_param(color[0], "Color 1", "The color of the first object");
         f0r_param_color color1 = {0.0, 0.5, 1.0};
         color[1] = color1;
-        register_param(color[1], "Color 2", "The color of the second object");
         f0r_param_color color2 = {0.0, 1.0, 1.0};
         color[2] = color2;
-        register_param(color[2], "Color 3", "The color of the third object");
         f0r_param_color color3 = {0.0, 1.0, 0.0};
         color[3] = color3;
-        register_param(color[3], "Color 4", "The color of the fourth object");
         f0r_param_color color4 = {1.0, 0.5, 0.0};
         color[4] = color4;
-        register_param(color[4], "Color 5", "The color of the fifth object");
+        async = false;
+        staleness = 0.0;
+        interpolate = false;
         srand(::time(NULL));
     }
 
@@ -111,6 +144,27 @@ public:
     {
     }
 
+    // keeps the loaded cascade; the objects found so far are scaled to
+    // the new frame and the background detector starts over
+    virtual bool resize(unsigned int new_width, unsigned int new_height)
+    {
+        worker.reset();
+        if (width == 0 || height == 0) {
+            objects.clear();
+            previous.clear();
+            roi = cv::Rect();
+            return true;
+        }
+        double sx = double(new_width) / width;
+        double sy = double(new_height) / height;
+        for (size_t i = 0; i < objects.size(); i++)
+            objects[i] = scaled(objects[i], sx, sy);
+        for (size_t i = 0; i < previous.size(); i++)
+            previous[i] = scaled(previous[i], sx, sy);
+        roi = scaled(roi, sx, sy) & cv::Rect(0, 0, new_width, new_height);
+        return true;
+    }
+
     void update(double time,
                 uint32_t* out,
                 const uint32_t* in)
@@ -118,6 +172,7 @@ public:
         if (cascade.empty()) {
             cv::setNumThreads(cvRound(threads * 100));
             if (classifier.length() > 0 && classifier != old_classifier) {
+                worker.reset();
                 if (!cascade.load(classifier.c_str()))
                     fprintf(stderr, "ERROR: Could not load classifier cascade %s\n", classifier.c_str());
 		old_classifier = classifier;
@@ -134,6 +189,14 @@ public:
 
         // copy input image to OpenCV
         image = cv::Mat(height, width, CV_8UC4, (void*)in);
+        frame++;
+
+        if (async) {
+            update_async();
+            memcpy(out, image.data, size * 4);
+            return;
+        }
+        worker.reset();
 
         // only re-detect periodically to control performance and reduce shape jitter
         int recheckInt = abs(cvRound(recheck * 1000));
@@ -163,22 +226,89 @@ public:
 //            fprintf(stderr, "detection time = %gms counter %u\n", elapsed, count);
         }
         
-        draw();
+        draw(objects);
 
         // copy filtered OpenCV image to output
         memcpy(out, image.data, size * 4);
     }
     
 private:
-    std::vector<cv::Rect> detect()
+    static cv::Rect scaled(const cv::Rect& r, double sx, double sy)
     {
-        std::vector<cv::Rect> faces;
-        if (cascade.empty()) return faces;
-        double scale = this->scale == 0? 1.0 : this->scale;
+        return cv::Rect(cvRound(r.x * sx), cvRound(r.y * sy),
+                        cvRound(r.width * sx), cvRound(r.height * sy));
+    }
+
+    void update_async()
+    {
+        if (!worker)
+            worker.reset(new detect_worker(
+                std::bind(&FaceDetect::detect_job_run, this, std::placeholders::_1)));
+
+        // pick up whatever the worker finished since the last frame
+        std::vector<cv::Rect> result;
+        unsigned long seq;
+        if (worker->fetch(result, seq)) {
+            update_roi(result);
+            previous.swap(objects);
+            previous_frame = objects_frame;
+            objects.swap(result);
+            objects_frame = seq;
+        }
+
+        // feed it the current frame only once it is free, so it always
+        // works on the newest picture and never queues up behind itself
+        if (!worker->busy())
+            worker->submit(prepare(), frame);
+
+        unsigned long age = frame - objects_frame;
+        unsigned long maxAge = abs(cvRound(staleness * 1000));
+        if (maxAge > 0 && age > maxAge)
+            return;
+
+        if (interpolate && age > 0 && previous_frame < objects_frame)
+            draw(extrapolate(age));
+        else
+            draw(objects);
+    }
+
+    // Shift each object by its velocity between the previous and the last
+    // detection, matching objects by nearest center.
+    std::vector<cv::Rect> extrapolate(unsigned long age)
+    {
+        std::vector<cv::Rect> moved(objects);
+        double span = objects_frame - previous_frame;
+        for (size_t i = 0; i < moved.size(); i++)
+        {
+            cv::Rect& r = moved[i];
+            int best = -1;
+            double bestDist = (r.width * r.width + r.height * r.height) * 0.25;
+            for (size_t j = 0; j < previous.size(); j++)
+            {
+                double dx = (previous[j].x + previous[j].width * 0.5) - (r.x + r.width * 0.5);
+                double dy = (previous[j].y + previous[j].height * 0.5) - (r.y + r.height * 0.5);
+                double dist = dx * dx + dy * dy;
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = j;
+                }
+            }
+            if (best >= 0) {
+                r.x += cvRound((double) (r.x - previous[best].x) * age / span);
+                r.y += cvRound((double) (r.y - previous[best].y) * age / span);
+            }
+        }
+        return moved;
+    }
+
+    detect_job prepare()
+    {
+        detect_job job;
+        job.scale = this->scale == 0? 1.0 : this->scale;
+        job.roi = roi;
         cv::Mat image_roi = image;
-        cv::Mat gray, small;
-        int min = cvRound(smallest * 1000. * scale);
-        
+        cv::Mat gray;
+
         // use a region of interest to improve performance
         // This idea comes from the More than Technical blog:
         // http://www.morethantechnical.com/2009/08/09/near-realtime-face-detection-on-the-iphone-w-opencv-port-wcodevideo/
@@ -187,17 +317,47 @@ private:
             image_roi = image(roi);
         }
 
-        // use an equalized grayscale to improve detection
+        // use a smaller grayscale image to improve performance
         cv::cvtColor(image_roi, gray, cv::COLOR_BGR2GRAY);
+        cv::resize(gray, job.small, cv::Size(cvRound(gray.cols * job.scale), cvRound(gray.rows * job.scale)));
+        job.min = cvRound(smallest * 1000. * job.scale);
+        return job;
+    }
+
+    // runs on the worker thread; touches nothing but the job and the cascade
+    std::vector<cv::Rect> detect_job_run(const detect_job& job)
+    {
+        std::vector<cv::Rect> faces;
+        if (cascade.empty()) return faces;
+        cv::Mat small;
+
+        // use an equalized grayscale to improve detection
+        cv::equalizeHist(job.small, small);
 
-        // use a smaller image to improve performance
-        cv::resize(gray, small, cv::Size(cvRound(gray.cols * scale), cvRound(gray.rows * scale)));
-        cv::equalizeHist(small, small);
-        
         // detect with OpenCV
-        cascade.detectMultiScale(small, faces, 1.1, 2, 0, cv::Size(min, min));
-        
+        cascade.detectMultiScale(small, faces, 1.1, 2, 0, cv::Size(job.min, job.min));
+
+        // back to the coordinates of the whole (scaled) frame
+        for (size_t i = 0; i < faces.size(); i++)
+        {
+            faces[i].x+= job.roi.x * job.scale;
+            faces[i].y+= job.roi.y * job.scale;
+        }
+        return faces;
+    }
+
+    std::vector<cv::Rect> detect()
+    {
+        std::vector<cv::Rect> faces = detect_job_run(prepare());
+        update_roi(faces);
+        return faces;
+    }
+
+    // Narrow the next search to the detected objects and some margin.
+    void update_roi(const std::vector<cv::Rect>& faces)
+    {
 #ifdef USE_ROI
+        double scale = this->scale == 0? 1.0 : this->scale;
         if (faces.size() == 0)
         {
             // clear the region of interest
@@ -209,11 +369,9 @@ private:
             // determine the region of interest from the detected objects
             int minx = width * scale;
             int miny = height * scale;
-            int maxx, maxy = 0;
+            int maxx = 0, maxy = 0;
             for (size_t i = 0; i < faces.size(); i++)
             {
-                faces[i].x+= roi.x * scale;
-                faces[i].y+= roi.y * scale;
                 minx = MIN(faces[i].x, minx);
                 miny = MIN(faces[i].y, miny);
                 maxx = MAX(faces[i].x + faces[i].width, maxx);
@@ -230,11 +388,12 @@ private:
             roi.width = (maxx - minx) / scale;
             roi.height = (maxy - miny) / scale; 
         }
+#else
+        (void)faces;
 #endif
-        return faces;
     }
     
-    void draw()
+    void draw(const std::vector<cv::Rect>& shapes)
     {
         double scale = this->scale == 0? 1.0 : this->scale;
         cv::Scalar colors[5] = {
@@ -245,9 +404,9 @@ private:
             cv::Scalar(cvRound(color[4].r * 255), cvRound(color[4].g * 255), cvRound(color[4].b * 255), cvRound(alpha * 255)),
         }; 
         
-        for (size_t i = 0; i < objects.size(); i++)
+        for (size_t i = 0; i < shapes.size(); i++)
         {
-            cv::Rect* r = (cv::Rect*) &objects[i];
+            const cv::Rect* r = &shapes[i];
             cv::Point center;
             int thickness = stroke <= 0? cv::FILLED : cvRound(stroke * 100);
             int linetype = antialias? cv::LINE_AA : 8;
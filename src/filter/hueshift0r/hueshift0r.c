@@ -64,6 +64,11 @@ void f0r_get_plugin_info(f0r_plugin_info_t* info)
   info->explanation = "Shifts the hue of a source image";
 }
 
+unsigned int f0r_get_capabilities(void)
+{
+  return F0R_CAP_INPLACE;
+}
+
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
   switch(param_index)
@@ -133,7 +138,8 @@ void f0r_update(f0r_instance_t instance, double time,
   hueshift0r_instance_t* inst = (hueshift0r_instance_t*)instance;
   unsigned int len = inst->width * inst->height;
   
-  memcpy(outframe, inframe, len*sizeof(uint32_t));
+  if (outframe != inframe)
+    memcpy(outframe, inframe, len*sizeof(uint32_t));
   applymatrix((unsigned long*)outframe, inst->mat, len);
 }
 
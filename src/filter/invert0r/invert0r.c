@@ -30,6 +30,11 @@ void f0r_get_plugin_info(f0r_plugin_info_t* inverterInfo)
   inverterInfo->explanation = "Inverts all colors of a source image";
 }
 
+unsigned int f0r_get_capabilities(void)
+{
+  return F0R_CAP_INPLACE;
+}
+
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
   /* no params */
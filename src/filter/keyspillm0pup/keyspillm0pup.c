@@ -34,6 +34,7 @@ Copyright (C) 2012  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 #include <stdio.h>
 #include <math.h>
 #include <frei0r.h>
+#include "frei0r_pixel.h"
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
@@ -675,6 +676,7 @@ typedef struct
 	int m2a;
 	int fo;		//foreground only (speed)
 	int cm;		//color model 0=rec601  1=rec 709
+	unsigned int model;	//frei0r color model of the frames
 	
 	//internal variables
 	float_rgba krgb;
@@ -726,6 +728,12 @@ void f0r_get_plugin_info(f0r_plugin_info_t* info)
 	info->explanation="Reduces the visibility of key color spill in chroma keying";
 }
 
+//--------------------------------------------------
+unsigned int f0r_get_capabilities(void)
+{
+	return F0R_CAP_INPLACE | F0R_CAP_RGBA16161616 | F0R_CAP_RGBA_FLOAT32;
+}
+
 //--------------------------------------------------
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
@@ -828,6 +836,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 	in->m2a=0;
 	in->fo=1;
 	in->cm=1;
+	in->model=F0R_COLOR_MODEL_RGBA8888;
 	
 	const char* sval = "0";
 	in->liststr = (char*)malloc( strlen(sval) + 1 );
@@ -1015,6 +1024,16 @@ void f0r_get_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
 	}
 }
 
+//--------------------------------------------------
+int f0r_set_color_model(f0r_instance_t instance, unsigned int color_model)
+{
+	inst *in=(inst*)instance;
+	
+	if (!f0r_pixel_model_ok(color_model, f0r_get_capabilities())) return 0;
+	in->model=color_model;
+	return 1;
+}
+
 //==============================================================
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
 {
@@ -1026,10 +1045,24 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 	assert(instance);
 	in=(inst*)instance;
 	
-	sl = calloc(in->w * in->h, sizeof(float_rgba));
 	mask = calloc(in->w * in->h, sizeof(float));
 	
-	RGBA8888_2_float(inframe, sl, in->w, in->h);
+	switch(in->model)
+	{
+	case F0R_COLOR_MODEL_RGBA_FLOAT32:	//already float, work in the output frame
+		sl = (float_rgba*)outframe;
+		if (outframe != inframe)
+			memcpy(sl, inframe, in->w * in->h * sizeof(float_rgba));
+		break;
+	case F0R_COLOR_MODEL_RGBA16161616:
+		sl = calloc(in->w * in->h, sizeof(float_rgba));
+		f0r_pixels_to_float(inframe, in->model, (float*)sl, in->w * in->h, 1.0);
+		break;
+	default:
+		sl = calloc(in->w * in->h, sizeof(float_rgba));
+		RGBA8888_2_float(inframe, sl, in->w, in->h);
+		break;
+	}
 	
 	switch(in->maskType)		//GENERATE MASK
 	{
@@ -1119,7 +1152,11 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 	}      
 	
 	
-	float_2_RGBA8888(sl, outframe, in->w, in->h);
+	if (in->model == F0R_COLOR_MODEL_RGBA8888)
+		float_2_RGBA8888(sl, outframe, in->w, in->h);
+	else
+		f0r_pixels_from_float((float*)sl, in->model, outframe, in->w * in->h, 1.0);
 	free(mask);
-	free(sl);
+	if (sl != (float_rgba*)outframe)
+		free(sl);
 }
@@ -23,6 +23,7 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_remap.h"
 
 typedef struct lenscorrection_instance
 {
@@ -33,6 +34,8 @@ typedef struct lenscorrection_instance
   double correctionnearcenter;
   double correctionnearedges;
   double brightness;
+  f0r_remap_entry_t* map; /* where each output pixel comes from */
+  int dirty; /* map needs to be rebuilt */
 } lenscorrection_instance_t;
 
 
@@ -99,11 +102,15 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->correctionnearcenter = 0.5;
   inst->correctionnearedges = 0.5;
   inst->brightness = 0.5;
+  inst->map = (f0r_remap_entry_t*)malloc(sizeof(f0r_remap_entry_t) * width * height);
+  inst->dirty = 1;
   return (f0r_instance_t)inst;
 }
 
 void f0r_destruct(f0r_instance_t instance)
 {
+  lenscorrection_instance_t* inst = (lenscorrection_instance_t*)instance;
+  free(inst->map);
   free(instance);
 }
 
@@ -137,6 +144,7 @@ void f0r_set_param_value(f0r_instance_t instance,
 			inst->brightness = val;
 			break;
 	}
+	inst->dirty = 1;
 }
 
 void f0r_get_param_value(f0r_instance_t instance,
@@ -165,19 +173,20 @@ void f0r_get_param_value(f0r_instance_t instance,
 	}
 }
 
-void f0r_update(f0r_instance_t instance, double time,
-		const uint32_t* inframe, uint32_t* outframe)
+static void make_map_rows(void* arg, int first, int last, int slice)
 {
 	//Algorithm fetched from Krita
 	int x, y;
-	assert(instance);
-	lenscorrection_instance_t* inst = (lenscorrection_instance_t*)instance;
+	lenscorrection_instance_t* inst = (lenscorrection_instance_t*)arg;
+	int w = inst->width;
+	int h = inst->height;
 
 	double xcenter = inst->xcenter;
 	double ycenter = inst->ycenter;
 	double correctionnearcenter = inst->correctionnearcenter;
 	double correctionnearedges = inst->correctionnearedges;
 	/* double brightness = inst->brightness; */
+	(void)slice;
 
 	double normallise_radius_sq = 4.0 / (inst->width * inst->width + inst->height * inst->height );
 	xcenter = inst->width * xcenter;
@@ -185,8 +194,9 @@ void f0r_update(f0r_instance_t instance, double time,
 	double mult_sq = ( correctionnearcenter - 0.5 );
 	double mult_qd = ( correctionnearedges - 0.5);
 
-	for ( y = 0; y < inst->height; y++ ) {
-		for ( x = 0; x < inst->width; x++ ) {
+	for ( y = first; y < last; y++ ) {
+		f0r_remap_entry_t* row = inst->map + y * w;
+		for ( x = 0; x < w; x++ ) {
 			double off_x = x - xcenter;
 			double off_y = y - ycenter;
 			double radius_sq = ( (off_x * off_x) + (off_y * off_y) ) * normallise_radius_sq;
@@ -204,46 +214,26 @@ void f0r_update(f0r_instance_t instance, double time,
 			int sy;
 			sx = srcX;
 			sy = srcY;
-			if ( sx < 0 || sy < 0 || sx >= inst->width || sy >= inst->height ) {
-				outframe[x + y * inst->width] =	0x00000000;
+			if ( sx < 0 || sy < 0 || sx >= w || sy >= h ) {
+				f0r_remap_clear(&row[x]);
 				continue;
 			}
-			//FIXME: interpolate pixel!!
-			outframe[x + y * inst->width] = inframe[sx + sy * inst->width];
+			f0r_remap_set(&row[x], w, h, srcX, srcY);
 		}
 	}
 }
 
-uint32_t interpolate_pixel( uint8_t* frame, int w, int h, double x, double y ) {
-/*
-	+--+--+
-	|  |  |
-	+--+--+
-	|  |  |
-	+--+--+
-
-
-	0.5 is full pixel value
-
-	0.25 interpolate to left pixel
-	0.75 interpolate to right pixel
-*/
-
-/*  //Disabled to avoid warnings when compiling
-double xoff = x - floor(x);
-
-int xc = (int)floor(x);
-int yc = (int)floor(y);
-
-int i = (xc+yc*w)*4;
-uint8_t color1_r = (uint8_t)( xoff * frame[i] + ( 1.0 - xoff ) * frame[i] );
-uint8_t color1_g = (uint8_t)( xoff * frame[i+1] + ( 1.0 - xoff ) * frame[i+1] );
-uint8_t color1_b = (uint8_t)( xoff * frame[i+2] + ( 1.0 - xoff ) * frame[i+2] );
-uint8_t color1_a = (uint8_t)( xoff * frame[i+3] + ( 1.0 - xoff ) * frame[i+3] );
-*/
-
-
+void f0r_update(f0r_instance_t instance, double time,
+		const uint32_t* inframe, uint32_t* outframe)
+{
+	assert(instance);
+	lenscorrection_instance_t* inst = (lenscorrection_instance_t*)instance;
 
-return 0;
+	// the mapping only depends on the parameters
+	if (inst->dirty) {
+		f0r_parallel_for(inst->height, 16, make_map_rows, inst);
+		inst->dirty = 0;
+	}
+	f0r_remap(inframe, inst->width, inst->height, outframe,
+	          inst->width, inst->height, inst->map, 0x00000000);
 }
-
@@ -118,6 +118,26 @@ class LightGraffiti : public frei0r::filter
 
 public:
 
+    static void describe(frei0r::param_list<LightGraffiti>& params)
+    {
+        params.add(&LightGraffiti::m_pSensitivity, "sensitivity", "Sensitivity of the effect for light (higher sensitivity will lead to brighter lights)");
+        params.add(&LightGraffiti::m_pBackgroundWeight, "backgroundWeight", "Describes how strong the (accumulated) background should shine through");
+        params.add(&LightGraffiti::m_pThresholdBrightness, "thresholdBrightness", "Brightness threshold to distinguish between foreground and background");
+        params.add(&LightGraffiti::m_pThresholdDifference, "thresholdDifference", "Threshold: Difference to background to distinguish between fore- and background");
+        params.add(&LightGraffiti::m_pThresholdDiffSum, "thresholdDiffSum", "Threshold for sum of differences. Can in most cases be ignored (set to 0).");
+        params.add(&LightGraffiti::m_pDim, "dim", "Dimming of the light mask");
+        params.add(&LightGraffiti::m_pSaturation, "saturation", "Saturation of lights");
+        params.add(&LightGraffiti::m_pLowerOverexposure, "lowerOverexposure", "Prevents some overexposure if the light source stays steady too long (varying speed)");
+        params.add(&LightGraffiti::m_pStatsBrightness, "statsBrightness", "Display the brightness and threshold, for adjusting the brightness threshold parameter");
+        params.add(&LightGraffiti::m_pStatsDiff, "statsDifference", "Display the background difference and threshold");
+        params.add(&LightGraffiti::m_pStatsDiffSum, "statsDiffSum", "Display the sum of the background difference and the threshold");
+        params.add(&LightGraffiti::m_pReset, "reset", "Reset filter masks");
+        params.add(&LightGraffiti::m_pTransparentBackground, "transparentBackground", "Make the background transparent");
+        params.add(&LightGraffiti::m_pBlackReference, "blackReference", "Uses black as background image instead of the first frame.");
+        params.add(&LightGraffiti::m_pLongAlpha, "longAlpha", "Alpha value for moving average");
+        params.add(&LightGraffiti::m_pNonlinearDim, "nonlinearDim", "Nonlinear dimming (may look more natural)");
+    }
+
     LightGraffiti(unsigned int width, unsigned int height) :
             m_lightMask(width*height, 0),
             m_alphaMap(4*width*height, 0),
@@ -147,22 +167,6 @@ public:
         m_prevMask = std::vector<RGBFloat>(width*height, rgb0);
 #endif
 
-        register_param(m_pSensitivity, "sensitivity", "Sensitivity of the effect for light (higher sensitivity will lead to brighter lights)");
-        register_param(m_pBackgroundWeight, "backgroundWeight", "Describes how strong the (accumulated) background should shine through");
-        register_param(m_pThresholdBrightness, "thresholdBrightness", "Brightness threshold to distinguish between foreground and background");
-        register_param(m_pThresholdDifference, "thresholdDifference", "Threshold: Difference to background to distinguish between fore- and background");
-        register_param(m_pThresholdDiffSum, "thresholdDiffSum", "Threshold for sum of differences. Can in most cases be ignored (set to 0).");
-        register_param(m_pDim, "dim", "Dimming of the light mask");
-        register_param(m_pSaturation, "saturation", "Saturation of lights");
-        register_param(m_pLowerOverexposure, "lowerOverexposure", "Prevents some overexposure if the light source stays steady too long (varying speed)");
-        register_param(m_pStatsBrightness, "statsBrightness", "Display the brightness and threshold, for adjusting the brightness threshold parameter");
-        register_param(m_pStatsDiff, "statsDifference", "Display the background difference and threshold");
-        register_param(m_pStatsDiffSum, "statsDiffSum", "Display the sum of the background difference and the threshold");
-        register_param(m_pReset, "reset", "Reset filter masks");
-        register_param(m_pTransparentBackground, "transparentBackground", "Make the background transparent");
-        register_param(m_pBlackReference, "blackReference", "Uses black as background image instead of the first frame.");
-        register_param(m_pLongAlpha, "longAlpha", "Alpha value for moving average");
-        register_param(m_pNonlinearDim, "nonlinearDim", "Nonlinear dimming (may look more natural)");
         m_pLongAlpha = 1/128.0;
         m_pSensitivity = 1 / 5.;
         m_pBackgroundWeight = 0;
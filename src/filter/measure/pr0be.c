@@ -30,6 +30,7 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 #include <frei0r.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <assert.h>
 
 #include "font2.h"
@@ -37,6 +38,9 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 
 double PI=3.14159265358979;
 
+//length of the crosshair legs
+#define CROSS_LEG 15
+
 //---------------------------------------------------------------
 void draw_rectangle(float_rgba *s, int w, int h, float x, float y, float wr, float hr, float_rgba c)
 {
@@ -268,6 +272,83 @@ if (sy>np)
 
 }
 
+//--------------------------------------------------------------
+//position and size of the info window
+//x=position of probe
+//poz=position of info window	0=left   1=right  (updated from x)
+//m,sha,bw as in sonda()
+void info_window(int w, int h, int x, int *poz, int m, int sha, int bw, int *x0, int *y0, int *vx, int *vy)
+{
+//if (x<5*w/12) *poz=1;	//right
+//if (x>7*w/12) *poz=0;	//left
+if (x<w/2-30) *poz=1;	//right
+if (x>w/2+30) *poz=0;	//left
+*y0=h/20;
+if (bw==1)		//big window
+  {
+  *vx=240;
+  *vy = (m<=2) ? 320 : 300;
+  }
+else			//small window
+  {
+  *vx=152;
+  *vy = (m<=2) ? 230 : 210;
+  }
+*x0 = (*poz==0) ? h/20 : w-h/20-*vx;
+if (sha==1) *vy=*vy+20;
+}
+
+//--------------------------------------------------------------
+//layout inside the info window
+//vp=pixel size in magnifier
+//np=size of magnifier
+//xn,yn=origin of the text
+void info_layout(int x0, int y0, int m, int bw, int *vp, int *np, int *xn, int *yn)
+{
+*vp=9;
+if (bw==1)		//big window
+  {
+  *np=25;
+  *xn = (m<=2) ? x0+8 : x0+70;
+  }
+else			//small window
+  {
+  *np=15;
+  *xn = (m<=2) ? x0+15 : x0+25;
+  }
+*yn=y0+(*np+1)**vp+8;
+}
+
+//--------------------------------------------------------------
+//grows vx,vy to cover everything sonda() draws for the info
+//window: the "out of box" arrows of the magnifier, and the text,
+//which may run past the window (the widest line is formatted by
+//izpis() at its widest values, signed ones in 0-255 units)
+//m,u,sha,bw as in sonda()
+void info_extent(int x0, int y0, int m, int u, int sha, int bw, int *vx, int *vy)
+{
+int vp,np,xn,yn,n;
+char string[256];
+stat wide={-0.5,0.5,-0.5,-0.5};
+
+info_layout(x0, y0, m, bw, &vp, &np, &xn, &yn);
+if ((np+2)*vp>*vx) *vx=(np+2)*vp;
+if ((np+2)*vp>*vy) *vy=(np+2)*vp;
+
+if (m<=2)
+  {
+  izpis(string, " Pr", wide, u, 1, bw);
+  n = (sha==1) ? 4 : 3;		//lines below the title
+  }
+else
+  {
+  sprintf(string," Hue = %5.1f",180.0);
+  n = (sha==1) ? 3 : 2;		//lines below the first
+  }
+if (xn+8*(int)strlen(string)-x0>*vx) *vx=xn+8*(int)strlen(string)-x0;
+if (yn+5+17*n+16-y0>*vy) *vy=yn+5+17*n+16-y0;
+}
+
 //--------------------------------------------------------------
 //draw info window
 //sx,sy=size of probe   (must be odd)
@@ -292,32 +373,9 @@ float_rgba dgreen={0.0,0.7,0.0,1.0};
 float_rgba lblue={0.3,0.3,1.0,1.0};
 
 //position and size of info window
-//if (x<5*w/12) *poz=1;	//right
-//if (x>7*w/12) *poz=0;	//left
-if (x<w/2-30) *poz=1;	//right
-if (x>w/2+30) *poz=0;	//left
-vp=9;			//pixel size in magnifier
-y0=h/20;
-if (bw==1)		//big window
-  {
-  vx=240;
-  vy = (m<=2) ? 320 : 300; 
-  x0 = (*poz==0) ? h/20 : w-h/20-vx;
-  np=25;  		//size of magnifier
-  xn = (m<=2) ? x0+8 : x0+70;
-  yn=y0+(np+1)*vp+8;
-  }
-else			//small window
-  {
-  vx=152;
-  vy = (m<=2) ? 230 : 210;
-  x0 = (*poz==0) ? h/20 : w-h/20-vx;
-  np=15;  		//size of magnifier
-  xn = (m<=2) ? x0+15 : x0+25;
-  yn=y0+(np+1)*vp+8;
-  }
+info_window(w, h, x, poz, m, sha, bw, &x0, &y0, &vx, &vy);
+info_layout(x0, y0, m, bw, &vp, &np, &xn, &yn);
 np2=np/2+1;
-if (sha==1) vy=vy+20;
 
 //keep probe inside
 if (x<sx/2) x=sx/2;
@@ -458,37 +516,51 @@ switch (m)
 }
 
 //-----------------------------------------------------
-//converts the internal RGBA float image into
-//Frei0r rgba8888 color
-void floatrgba2color(float_rgba *sl, uint32_t* outframe, int w , int h)
+//converts a rectangle of the internal RGBA float image
+//into Frei0r rgba8888 color
+//x,y,wr,hr=rectangle, clipped to the image
+void floatrgba2color(float_rgba *sl, uint32_t* outframe, int w , int h, int x, int y, int wr, int hr)
 {
-int i;
+int i,j,k;
 uint32_t p;
 
-for (i=0;i<w*h;i++)
-	{
-	p=(uint32_t)(255.0*sl[i].a) & 0xFF;
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].b) & 0xFF);
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].g) & 0xFF);
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].r) & 0xFF);
-	outframe[i]=p;
-	}
+if (x<0) {wr=wr+x; x=0;}
+if (y<0) {hr=hr+y; y=0;}
+if (x+wr>w) wr=w-x;
+if (y+hr>h) hr=h-y;
+for (i=y;i<y+hr;i++)
+	for (j=x;j<x+wr;j++)
+		{
+		k=i*w+j;
+		p=(uint32_t)(255.0*sl[k].a) & 0xFF;
+		p=(p<<8) + ((uint32_t)(255.0*sl[k].b) & 0xFF);
+		p=(p<<8) + ((uint32_t)(255.0*sl[k].g) & 0xFF);
+		p=(p<<8) + ((uint32_t)(255.0*sl[k].r) & 0xFF);
+		outframe[k]=p;
+		}
 }
 
 //-----------------------------------------------------
-//converts the Frei0r rgba8888 color image into
-//internal float RGBA
-void color2floatrgba(const uint32_t* inframe, float_rgba *sl, int w , int h)
+//converts a rectangle of the Frei0r rgba8888 color image
+//into internal float RGBA
+//x,y,wr,hr=rectangle, clipped to the image
+void color2floatrgba(const uint32_t* inframe, float_rgba *sl, int w , int h, int x, int y, int wr, int hr)
 {
-int i;
-
-for (i=0;i<w*h;i++)
-	{
-	sl[i].r=((float)(inframe[i] & 0x000000FF))*0.00392157;
-	sl[i].g=((float)((inframe[i] & 0x0000FF00)>>8))*0.00392157;
-	sl[i].b=((float)((inframe[i] & 0x00FF0000)>>16))*0.00392157;
-	sl[i].a=((float)((inframe[i] & 0xFF000000)>>24))*0.00392157;
-	}
+int i,j,k;
+
+if (x<0) {wr=wr+x; x=0;}
+if (y<0) {hr=hr+y; y=0;}
+if (x+wr>w) wr=w-x;
+if (y+hr>h) hr=h-y;
+for (i=y;i<y+hr;i++)
+	for (j=x;j<x+wr;j++)
+		{
+		k=i*w+j;
+		sl[k].r=((float)(inframe[k] & 0x000000FF))*0.00392157;
+		sl[k].g=((float)((inframe[k] & 0x0000FF00)>>8))*0.00392157;
+		sl[k].b=((float)((inframe[k] & 0x00FF0000)>>16))*0.00392157;
+		sl[k].a=((float)((inframe[k] & 0xFF000000)>>24))*0.00392157;
+		}
 }
 
 //-----------------------------------------------------
@@ -734,15 +806,33 @@ switch(param_index)
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
 {
 inst *in;
+int x0,y0,vx,vy,vp,np,xn,yn,r,rs;
 
 assert(instance);
 in=(inst*)instance;
 
-color2floatrgba(inframe, in->sl, in->w , in->h);
+//only the info window and the surroundings of the probe are
+//read or drawn on, the rest of the frame passes through as is
+//(the 8 bit -> float -> 8 bit round trip is exact)
+info_window(in->w, in->h, in->x, &in->poz, in->mer, in->sha, in->bw, &x0, &y0, &vx, &vy);
+info_extent(x0, y0, in->mer, in->un, in->sha, in->bw, &vx, &vy);
+//the probe may be pushed inside the frame by up to half its size,
+//and the magnifier and the measurements read around it from there;
+//the crosshair legs reach out CROSS_LEG from the probe edges
+info_layout(x0, y0, in->mer, in->bw, &vp, &np, &xn, &yn);
+r = in->sx + ((np/2>in->sx) ? np/2 : in->sx);
+if (r<in->sx+CROSS_LEG) r=in->sx+CROSS_LEG;
+rs = in->sy + ((np/2>in->sy) ? np/2 : in->sy);
+if (rs<in->sy+CROSS_LEG) rs=in->sy+CROSS_LEG;
+
+if (inframe!=outframe)
+	memcpy(outframe, inframe, in->w*in->h*sizeof(uint32_t));
+color2floatrgba(inframe, in->sl, in->w, in->h, x0, y0, vx, vy);
+color2floatrgba(inframe, in->sl, in->w, in->h, in->x-r, in->y-rs, 2*r+1, 2*rs+1);
 
 sonda(in->sl, in->w, in->h, in->x, in->y, 2*in->sx+1, 2*in->sy+1, &in->poz, in->mer, in->un, in->sha, in->bw);
-crosshair(in->sl, in->w, in->h, in->x, in->y, 2*in->sx+1, 2*in->sy+1, 15);
+crosshair(in->sl, in->w, in->h, in->x, in->y, 2*in->sx+1, 2*in->sy+1, CROSS_LEG);
 
-floatrgba2color(in->sl, outframe, in->w , in->h);
+floatrgba2color(in->sl, outframe, in->w, in->h, x0, y0, vx, vy);
+floatrgba2color(in->sl, outframe, in->w, in->h, in->x-r, in->y-rs, 2*r+1, 2*rs+1);
 }
-
@@ -39,6 +39,12 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 
 double PI=3.14159265358979;
 
+//half length of the end marks and length of the marker ticks
+//drawn by pmarker() across the profile line
+#define MARK_LEN 10.0
+//shown instead of the numeric display when it does not fit
+#define NO_SPACE "<- NOT ENOUGH SPACE ->"
+
 //---------------------------------------------------------------
 void draw_rectangle(float_rgba *s, int w, int h, float x, float y, float wr, float hr, float_rgba c)
 {
@@ -178,7 +184,7 @@ dx=dx/dd;
 dy=dy/dd;
 
 s2=1.415;
-s3=10.0;
+s3=MARK_LEN;
 
 //lower line
 draw_line(s, w, h, xz-s2*dy, yz+s2*dx, xk-s2*dy, yk+s2*dx, c);
@@ -374,6 +380,56 @@ if ((dit&0x00000100)!=0)	//MAX of profile
   }
 }
 
+//-------------------------------------------------------------
+//position and size of the info window
+//y=vertical position of profile
+//poz=position of info window	0=top   1=bottom  (updated from y)
+void info_window(int w, int h, int y, int *poz, int *x0, int *y0, int *vx, int *vy)
+{
+if (y<h/2-20) *poz=1;	//bottom
+if (y>h/2+20) *poz=0;	//top
+*x0=h/20;
+*vx=w*15/16;
+*vy = h*6/16;
+*y0 = (*poz==0) ? h/20 : h-h/20-*vy;
+}
+
+//-------------------------------------------------------------
+//rectangle covering everything prof() draws for the info window
+//xa,ya=top left corner    xe,ye=bottom right corner (exclusive)
+//the scope spans x0+49...x0+vx-5 and y0+5...y0+vy-35, which turns
+//inside out and sticks out of a small window; draw_trace() starts
+//each trace unclamped, and Pr and Pb (up to +-1 around their 0.5
+//offset) can put that start half a scope height above or below;
+//the numeric display may run up to (vx-55)/8 characters from
+//x0+60, and NO_SPACE is centered on a window that may be narrower
+//than it
+void info_extent(int x0, int y0, int vx, int vy, int *xa, int *ya, int *xe, int *ye)
+{
+int l=8*(int)strlen(NO_SPACE);
+int xl[3]={x0, x0+vx-6, x0+vx/2-l/2};
+int xr[6]={x0+vx, x0+51, x0+vx-4, x0+36, x0+60+8*((vx-55)/8), x0+vx/2+l/2};
+int ya0=y0+5-(vy-40)/2, ya1=y0+5+3*(vy-40)/2;
+int yt[5]={y0, y0+vy-36, y0+vy-25, ya0-1, ya1-1};
+int yb[6]={y0+vy, y0+7, y0+vy-34, y0+vy-9, ya0+2, ya1+2};
+int i;
+
+*xa=xl[0]; for (i=1;i<3;i++) if (xl[i]<*xa) *xa=xl[i];
+*xe=xr[0]; for (i=1;i<6;i++) if (xr[i]>*xe) *xe=xr[i];
+*ya=yt[0]; for (i=1;i<5;i++) if (yt[i]<*ya) *ya=yt[i];
+*ye=yb[0]; for (i=1;i<6;i++) if (yb[i]>*ye) *ye=yb[i];
+}
+
+//-------------------------------------------------------------
+//end points of the profile line
+void profile_ends(int x, int y, float tilt, int len, int *xz, int *yz, int *xk, int *yk)
+{
+*xz=x-len/2.0*cosf(tilt);
+*xk=x+len/2.0*cosf(tilt);
+*yz=y-len/2.0*sinf(tilt);
+*yk=y+len/2.0*sinf(tilt);
+}
+
 //--------------------------------------------------------------
 //draw info window
 //sx,sy=size of probe   (must be odd)
@@ -404,18 +460,10 @@ float_rgba magenta={0.8,0.0,0.8,1.0};
 float_rgba cyan={0.0,0.7,0.8,1.0};
 
 //position and size of info window
-if (y<h/2-20) *poz=1;	//bottom
-if (y>h/2+20) *poz=0;	//top
-x0=h/20;
-vx=w*15/16;
-vy = h*6/16; 
-y0 = (*poz==0) ? h/20 : h-h/20-vy;
+info_window(w, h, y, poz, &x0, &y0, &vx, &vy);
 
 //end points of profile
-xz=x-len/2.0*cosf(tilt);
-xk=x+len/2.0*cosf(tilt);
-yz=y-len/2.0*sinf(tilt);
-yk=y+len/2.0*sinf(tilt);
+profile_ends(x, y, tilt, len, &xz, &yz, &xk, &yk);
 
 //measure
 meriprof(s, w, h, xz, yz, xk, yk, sir, p);
@@ -479,8 +527,8 @@ izpis(*p,string,m,u,m1,m2,dit);
 sl=strlen(string);
 if (sl>((vx-55)/8))
   {
-  sprintf(string,"<- NOT ENOUGH SPACE ->");
-  draw_string(s, w, h, x0+vx/2-88, y0+vy-25, string, white);
+  sprintf(string,NO_SPACE);
+  draw_string(s, w, h, x0+vx/2-4*(int)strlen(string), y0+vy-25, string, white);
   return;
   }
 switch (m>>24)	//which channel data under the scope
@@ -522,37 +570,51 @@ switch (m>>24)	//which channel data under the scope
 }
 
 //-----------------------------------------------------
-//converts the internal RGBA float image into
-//Frei0r rgba8888 color
-void floatrgba2color(float_rgba *sl, uint32_t* outframe, int w , int h)
+//converts a rectangle of the internal RGBA float image
+//into Frei0r rgba8888 color
+//x,y,wr,hr=rectangle, clipped to the image
+void floatrgba2color(float_rgba *sl, uint32_t* outframe, int w , int h, int x, int y, int wr, int hr)
 {
-int i;
+int i,j,k;
 uint32_t p;
 
-for (i=0;i<w*h;i++)
-	{
-	p=(uint32_t)(255.0*sl[i].a) & 0xFF;
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].b) & 0xFF);
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].g) & 0xFF);
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].r) & 0xFF);
-	outframe[i]=p;
-	}
+if (x<0) {wr=wr+x; x=0;}
+if (y<0) {hr=hr+y; y=0;}
+if (x+wr>w) wr=w-x;
+if (y+hr>h) hr=h-y;
+for (i=y;i<y+hr;i++)
+	for (j=x;j<x+wr;j++)
+		{
+		k=i*w+j;
+		p=(uint32_t)(255.0*sl[k].a) & 0xFF;
+		p=(p<<8) + ((uint32_t)(255.0*sl[k].b) & 0xFF);
+		p=(p<<8) + ((uint32_t)(255.0*sl[k].g) & 0xFF);
+		p=(p<<8) + ((uint32_t)(255.0*sl[k].r) & 0xFF);
+		outframe[k]=p;
+		}
 }
 
 //-----------------------------------------------------
-//converts the Frei0r rgba8888 color image into
-//internal float RGBA
-void color2floatrgba(const uint32_t* inframe, float_rgba *sl, int w , int h)
+//converts a rectangle of the Frei0r rgba8888 color image
+//into internal float RGBA
+//x,y,wr,hr=rectangle, clipped to the image
+void color2floatrgba(const uint32_t* inframe, float_rgba *sl, int w , int h, int x, int y, int wr, int hr)
 {
-int i;
-
-for (i=0;i<w*h;i++)
-	{
-	sl[i].r=((float)(inframe[i] & 0x000000FF))*0.00392157;
-	sl[i].g=((float)((inframe[i] & 0x0000FF00)>>8))*0.00392157;
-	sl[i].b=((float)((inframe[i] & 0x00FF0000)>>16))*0.00392157;
-	sl[i].a=((float)((inframe[i] & 0xFF000000)>>24))*0.00392157;
-	}
+int i,j,k;
+
+if (x<0) {wr=wr+x; x=0;}
+if (y<0) {hr=hr+y; y=0;}
+if (x+wr>w) wr=w-x;
+if (y+hr>h) hr=h-y;
+for (i=y;i<y+hr;i++)
+	for (j=x;j<x+wr;j++)
+		{
+		k=i*w+j;
+		sl[k].r=((float)(inframe[k] & 0x000000FF))*0.00392157;
+		sl[k].g=((float)((inframe[k] & 0x0000FF00)>>8))*0.00392157;
+		sl[k].b=((float)((inframe[k] & 0x00FF0000)>>16))*0.00392157;
+		sl[k].a=((float)((inframe[k] & 0xFF000000)>>24))*0.00392157;
+		}
 }
 
 //-----------------------------------------------------
@@ -607,6 +669,40 @@ profdata *p;
 
 } inst;
 
+//-----------------------------------------------------
+//converts the surroundings of the profile line, in squares
+//along it, so that slanted profiles do not need their whole
+//bounding box
+//dir=0  8 bit -> float      dir=1  float -> 8 bit
+void profile_region(inst *in, const uint32_t* inframe, uint32_t* outframe, int dir)
+{
+int xz,yz,xk,yk,d,e,n,i,x,y,r,b;
+
+profile_ends(in->x, in->y, in->tilt, in->len, &xz, &yz, &xk, &yk);
+d =  abs(xk-xz)>abs(yk-yz) ? abs(xk-xz) : abs(yk-yz);
+//the marker ticks sit m1/d, m2/d along the line, past its end
+//when the markers were set on a longer profile
+e=d;
+if (in->m1>e) e=in->m1;
+if (in->m2>e) e=in->m2;
+if (d==0) {d=1; e=1;}
+//pmarker() draws up to MARK_LEN from the line, plus one for
+//truncating its end points; the squares are spaced by that
+//reach and each covers it on both sides of its stretch
+r=MARK_LEN+1;
+n=e/r+1;
+b=3*r+2;
+for (i=0;i<=n;i++)
+	{
+	x=xz+(xk-xz)*e/d*i/n-b/2;
+	y=yz+(yk-yz)*e/d*i/n-b/2;
+	if (dir==0)
+		color2floatrgba(inframe, in->sl, in->w, in->h, x, y, b, b);
+	else
+		floatrgba2color(in->sl, outframe, in->w, in->h, x, y, b, b);
+	}
+}
+
 //***********************************************
 // OBVEZNE FREI0R FUNKCIJE
 
@@ -1025,14 +1121,24 @@ switch(param_index)
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
 {
 inst *in;
+int x0,y0,vx,vy,xa,ya,xe,ye;
 
 assert(instance);
 in=(inst*)instance;
 
-color2floatrgba(inframe, in->sl, in->w , in->h);
+//only the info window and the surroundings of the profile line
+//are read or drawn on, the rest of the frame passes through as is
+//(the 8 bit -> float -> 8 bit round trip is exact)
+info_window(in->w, in->h, in->y, &in->poz, &x0, &y0, &vx, &vy);
+info_extent(x0, y0, vx, vy, &xa, &ya, &xe, &ye);
+
+if (inframe!=outframe)
+	memcpy(outframe, inframe, in->w*in->h*sizeof(uint32_t));
+color2floatrgba(inframe, in->sl, in->w, in->h, xa, ya, xe-xa, ye-ya);
+profile_region(in, inframe, outframe, 0);
 
 prof(in->sl, in->w, in->h, &in->poz, in->x, in->y, in->tilt, in->len, 1, in->mer, in->un, 0, in->m1, in->m2, in->dit, in->chc, in->col, in->p);
 
-floatrgba2color(in->sl, outframe, in->w , in->h);
+floatrgba2color(in->sl, outframe, in->w, in->h, xa, ya, xe-xa, ye-ya);
+profile_region(in, inframe, outframe, 1);
 }
-
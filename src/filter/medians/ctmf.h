@@ -48,6 +48,8 @@ typedef UINT32 uint32_t;
 #include <stdint.h>
 #endif
 
+#include "frei0r_cpu.h"
+
 /* Intrinsic declarations */
 #if defined(__SSE2__) || defined(__MMX__)
 #if defined(__SSE2__)
@@ -113,11 +115,25 @@ typedef struct align(16)
     h_coarse[ 16*(n*c+j) + (x>>4) ] op; \
     h_fine[ 16 * (n*(16*c+(x>>4)) + j) + (x & 0xF) ] op;
 
+/**
+ * With runtime dispatch, the 16 bins of a histogram are one vector: two SSE2
+ * registers in the baseline build, one register in the AVX2 variant of
+ * ctmf_helper().
+ */
+#if defined(F0R_HAVE_AVX2)
+typedef uint16_t histogram_bins __attribute__ ((vector_size (32), aligned (16), may_alias));
+#endif
+
 /**
  * Adds histograms \a x and \a y and stores the result in \a y. Makes use of
- * SSE2, MMX or Altivec, if available.
+ * SSE2, AVX2, MMX or Altivec, if available.
  */
-#if defined(__SSE2__)
+#if defined(F0R_HAVE_AVX2)
+static inline void histogram_add( const uint16_t x[16], uint16_t y[16] )
+{
+    *(histogram_bins*) y += *(const histogram_bins*) x;
+}
+#elif defined(__SSE2__)
 static inline void histogram_add( const uint16_t x[16], uint16_t y[16] )
 {
     *(__m128i*) &y[0] = _mm_add_epi16( *(__m128i*) &y[0], *(__m128i*) &x[0] );
@@ -149,9 +165,14 @@ static inline void histogram_add( const uint16_t x[16], uint16_t y[16] )
 
 /**
  * Subtracts histogram \a x from \a y and stores the result in \a y. Makes use
- * of SSE2, MMX or Altivec, if available.
+ * of SSE2, AVX2, MMX or Altivec, if available.
  */
-#if defined(__SSE2__)
+#if defined(F0R_HAVE_AVX2)
+static inline void histogram_sub( const uint16_t x[16], uint16_t y[16] )
+{
+    *(histogram_bins*) y -= *(const histogram_bins*) x;
+}
+#elif defined(__SSE2__)
 static inline void histogram_sub( const uint16_t x[16], uint16_t y[16] )
 {
     *(__m128i*) &y[0] = _mm_sub_epi16( *(__m128i*) &y[0], *(__m128i*) &x[0] );
@@ -338,6 +359,20 @@ static void ctmf_helper(
 #endif
 }
 
+#if defined(F0R_HAVE_AVX2)
+F0R_TARGET_AVX2 static void ctmf_helper_avx2(
+        const unsigned char* const src, unsigned char* const dst,
+        const int width, const int height,
+        const int src_step, const int dst_step,
+        const int r, const int cn,
+        const int pad_left, const int pad_right
+        )
+{
+    ctmf_helper( src, dst, width, height, src_step, dst_step, r, cn,
+            pad_left, pad_right );
+}
+#endif
+
 /**
  * \brief Constant-time median filtering
  *
@@ -416,6 +451,15 @@ void ctmf(
 
     int i;
 
+    void (*helper)( const unsigned char* const, unsigned char* const,
+            const int, const int, const int, const int, const int, const int,
+            const int, const int ) = ctmf_helper;
+#if defined(F0R_HAVE_AVX2)
+    if ( f0r_cpu_features() & F0R_CPU_AVX2 ) {
+        helper = ctmf_helper_avx2;
+    }
+#endif
+
     for ( i = 0; i < width; i += stripe_size - 2*r ) {
         int stripe = stripe_size;
         /* Make sure that the filter kernel fits into one stripe. */
@@ -423,7 +467,7 @@ void ctmf(
             stripe = width - i;
         }
 
-        ctmf_helper( src + cn*i, dst + cn*i, stripe, height, src_step, dst_step, r, cn,
+        helper( src + cn*i, dst + cn*i, stripe, height, src_step, dst_step, r, cn,
                 i == 0, stripe == width - i );
 
         if ( stripe == width - i ) {
@@ -20,8 +20,10 @@
 #endif
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_thread.h"
 #include "gradientlut.hpp"
 #include <string>
+#include <vector>
 #include <stdlib.h>
 
 /**
@@ -49,12 +51,15 @@ class Ndvi : public frei0r::filter
 {
 public:
     Ndvi(unsigned int width, unsigned int height);
+    static void describe(frei0r::param_list<Ndvi>& params);
     virtual void update(double time,
                         uint32_t* out,
                         const uint32_t* in);
 
 private:
-    void initLut();
+    bool initLut();
+    void initTable();
+    static void mapRows(void* arg, int first, int last, int slice);
     double getComponent(uint8_t *sample, unsigned int chan, double offset, double scale);
     void setColor(uint8_t *sample, double index);
     void drawLegend(uint32_t *out);
@@ -75,6 +80,19 @@ private:
     unsigned int lutLevels;
     std::string colorMap;
     GradientLut gradient;
+
+    // False color of every (vis, nir) byte pair, indexed by vis << 8 | nir,
+    // and the parameters it was built for.
+    std::vector<uint32_t> table;
+    double tableVisScale;
+    double tableVisOffset;
+    double tableNirScale;
+    double tableNirOffset;
+    bool tableVi;
+    unsigned int visChan;
+    unsigned int nirChan;
+    const uint32_t* mapIn;
+    uint32_t* mapOut;
 };
 
 Ndvi::Ndvi(unsigned int width, unsigned int height)
@@ -91,76 +109,127 @@ Ndvi::Ndvi(unsigned int width, unsigned int height)
  , lutLevels(0)
  , colorMap("")
  , gradient()
+ , table(256 * 256)
+ , tableVisScale(-1.0)
+ , tableVisOffset(-1.0)
+ , tableNirScale(-1.0)
+ , tableNirOffset(-1.0)
+ , tableVi(false)
+ , visChan(2)
+ , nirChan(0)
+ , mapIn(0)
+ , mapOut(0)
+{
+}
+
+// The constructor allocates the 256x256 colour table, so hosts get the
+// parameters from here (see frei0r::param_list).
+void Ndvi::describe(frei0r::param_list<Ndvi>& params)
 {
-    register_param(paramColorMap,  "Color Map",
+    params.add(&Ndvi::paramColorMap,  "Color Map",
             "The color map to use. One of 'earth', 'grayscale', 'heat' or 'rainbow'.");
-    register_param(paramLutLevels, "Levels",
+    params.add(&Ndvi::paramLutLevels, "Levels",
             "The number of color levels to use in the false image (divided by 1000).");
-    register_param(paramVisScale, "VIS Scale",
+    params.add(&Ndvi::paramVisScale, "VIS Scale",
             "A scaling factor to be applied to the visible component (divided by 10).");
-    register_param(paramVisOffset, "VIS Offset",
+    params.add(&Ndvi::paramVisOffset, "VIS Offset",
             "An offset to be applied to the visible component (mapped to [-100%, 100%].");
-    register_param(paramNirScale, "NIR Scale",
+    params.add(&Ndvi::paramNirScale, "NIR Scale",
             "A scaling factor to be applied to the near-infrared component (divided by 10).");
-    register_param(paramNirOffset, "NIR Offset",
+    params.add(&Ndvi::paramNirOffset, "NIR Offset",
             "An offset to be applied to the near-infrared component (mapped to [-100%, 100%].");
-    register_param(paramVisChan,  "Visible Channel",
+    params.add(&Ndvi::paramVisChan,  "Visible Channel",
             "The channel to use for the visible component. One of 'r', 'g', or 'b'.");
-    register_param(paramNirChan,  "NIR Channel",
+    params.add(&Ndvi::paramNirChan,  "NIR Channel",
             "The channel to use for the near-infrared component. One of 'r', 'g', or 'b'.");
-    register_param(paramIndex,  "Index Calculation",
+    params.add(&Ndvi::paramIndex,  "Index Calculation",
             "The index calculation to use. One of 'ndvi' or 'vi'.");
-    register_param(paramLegend,  "Legend",
+    params.add(&Ndvi::paramLegend,  "Legend",
             "Control legend display. One of 'off' or 'bottom'.");
 }
 
 void Ndvi::update(double time,
                   uint32_t* out,
                   const uint32_t* in) {
-    uint8_t *inP = (uint8_t*)in;
-    uint8_t *outP = (uint8_t*)out;
+    visChan = ColorIndex(paramVisChan);
+    nirChan = ColorIndex(paramNirChan);
+
+    initTable();
+
+    mapIn = in;
+    mapOut = out;
+    f0r_parallel_for(height, 16, mapRows, this);
+
+    if( paramLegend == "bottom" ) {
+        drawLegend(out);
+    }
+}
+
+void Ndvi::mapRows(void* arg, int first, int last, int slice)
+{
+    Ndvi* self = (Ndvi*)arg;
+    const uint8_t *inP = (const uint8_t*)(self->mapIn + first * self->width);
+    uint32_t *outP = self->mapOut + first * self->width;
+    const uint32_t *table = &self->table[0];
+    unsigned int visChan = self->visChan;
+    unsigned int nirChan = self->nirChan;
+    unsigned int n = (last - first) * self->width;
+    (void)slice;
+
+    for (unsigned int i = 0; i < n; i++) {
+        outP[i] = table[(inP[visChan] << 8) | inP[nirChan]];
+        inP += 4;
+    }
+}
+
+void Ndvi::initTable() {
+    // The index only depends on the two input bytes, so evaluate it once
+    // per pair and only again when a parameter has changed.
+    bool vi = paramIndex == "vi";
+    bool lutChanged = initLut();
+    if (!lutChanged &&
+        tableVisScale == paramVisScale && tableVisOffset == paramVisOffset &&
+        tableNirScale == paramNirScale && tableNirOffset == paramNirOffset &&
+        tableVi == vi) {
+        return;
+    }
+    tableVisScale = paramVisScale;
+    tableVisOffset = paramVisOffset;
+    tableNirScale = paramNirScale;
+    tableNirOffset = paramNirOffset;
+    tableVi = vi;
+
     double visScale = paramVisScale * 10.0;
     double visOffset =  (paramVisOffset * 510) - 255;
     double nirScale = paramNirScale * 10.0;
     double nirOffset = (paramNirOffset * 510) - 255;
-    unsigned int visChan = ColorIndex(paramVisChan);
-    unsigned int nirChan = ColorIndex(paramNirChan);
-
-    initLut();
+    uint8_t sample[4];
+    uint8_t *outP = (uint8_t*)&table[0];
 
-    if (paramIndex == "vi") {
-        for (unsigned int i = 0; i < size; i++) {
-            double vis =  getComponent(inP, visChan, visOffset, visScale);
-            double nir =  getComponent(inP, nirChan, nirOffset, nirScale);
-            double vi = (nir - vis) / 255.0;
-            setColor(outP, vi);
-            inP += 4;
-            outP += 4;
-        }
-    } else { // ndvi
-        for (unsigned int i = 0; i < size; i++) {
-            double vis =  getComponent(inP, visChan, visOffset, visScale);
-            double nir =  getComponent(inP, nirChan, nirOffset, nirScale);
-            double ndvi = (nir - vis) / (nir + vis);
-            setColor(outP, ndvi);
-            inP += 4;
+    for (unsigned int v = 0; v < 256; v++) {
+        sample[0] = v;
+        double vis =  getComponent(sample, 0, visOffset, visScale);
+        for (unsigned int n = 0; n < 256; n++) {
+            sample[0] = n;
+            double nir =  getComponent(sample, 0, nirOffset, nirScale);
+            if (vi) {
+                setColor(outP, (nir - vis) / 255.0);
+            } else {
+                setColor(outP, (nir - vis) / (nir + vis));
+            }
             outP += 4;
         }
     }
-
-    if( paramLegend == "bottom" ) {
-        drawLegend(out);
-    }
 }
 
-void Ndvi::initLut() {
+bool Ndvi::initLut() {
     // Only update the LUT if a parameter has changed.
     unsigned int paramLutLevelsInt = paramLutLevels * 1000.0 + 0.5;
     if (paramLutLevelsInt < 2) paramLutLevelsInt = 2;
     if (paramLutLevelsInt > 1000) paramLutLevelsInt = 1000;
     if (lutLevels == paramLutLevelsInt &&
         colorMap == paramColorMap) {
-        return;
+        return false;
     } else {
         lutLevels = paramLutLevelsInt;
         colorMap = paramColorMap;
@@ -217,6 +286,7 @@ void Ndvi::initLut() {
         GradientLut::Color white = {0xff, 0xff, 0xff};
         gradient.fillRange( N2P(-1.0), black, N2P( 1.0), white );
     }
+    return true;
 }
 
 inline double Ndvi::getComponent(uint8_t *sample, unsigned int chan, double offset, double scale)
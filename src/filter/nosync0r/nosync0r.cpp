@@ -6,10 +6,14 @@
 class nosync0r : public frei0r::filter
 {
 public:
+  static void describe(frei0r::param_list<nosync0r>& params)
+  {
+    params.add(&nosync0r::hsync,"HSync","the hsync offset");
+  }
+
   nosync0r(unsigned int width, unsigned int height)
   {
     hsync = 0.0;
-    register_param(hsync,"HSync","the hsync offset");
   }
   
   virtual void update(double time,
@@ -1,17 +1,28 @@
 #include "frei0r.h"
+#include "frei0r_thread.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
-static uint32_t average(const uint32_t* start,
-                       int bxsize,
-                       int bysize, int xsize);
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-static void fill_block(uint32_t* start,
-                       int bxsize,
-                       int bysize,
-                       int xsize, uint32_t col);
+/*
+  Every block row is averaged in one streaming pass over its rows: each
+  pixel is added into the accumulator of its cell, then the averages are
+  laid out once as an output row and copied to all rows of the block.
+  Block rows are independent and run in parallel.
 
+  Cells are either rectangles, bricks (every other row shifted by half a
+  block) or hexagons (the pixels nearest to the centres of a brick
+  lattice).  Only the pixels inside the region are pixelized, the rest of
+  the frame is passed through.
+*/
+
+#define SHAPE_RECT  0
+#define SHAPE_BRICK 1
+#define SHAPE_HEX   2
 
 typedef struct pixelizer_instance
 {
@@ -19,8 +30,27 @@ typedef struct pixelizer_instance
   unsigned int height;
   unsigned int block_size_x;
   unsigned int block_size_y;
+  int shape;
+  double region[4]; /* x, y, width, height, relative to the frame */
+
+  /* hexagon geometry, per column and parity of the cell row */
+  int* hex_cell[2];
+  unsigned int* hex_dx2[2];
+  uint32_t* colors;  /* one colour per hexagon */
+  size_t colors_size;
 } pixelizer_instance_t;
 
+typedef struct pixelizer_job
+{
+  const pixelizer_instance_t* inst;
+  const uint32_t* src;
+  uint32_t* dst;
+  uint32_t* scratch; /* per slice */
+  size_t scratch_size;
+  int x0, x1, y0, y1; /* pixelized region */
+  int cells;          /* cells per block row */
+} pixelizer_job_t;
+
 int f0r_init()
 {
   return 1;
@@ -37,8 +67,8 @@ void f0r_get_plugin_info(f0r_plugin_info_t* pixelizerInfo)
   pixelizerInfo->color_model = F0R_COLOR_MODEL_PACKED32;
   pixelizerInfo->frei0r_version = FREI0R_MAJOR_VERSION;
   pixelizerInfo->major_version = 1; 
-  pixelizerInfo->minor_version = 0; 
-  pixelizerInfo->num_params =  2; 
+  pixelizerInfo->minor_version = 1; 
+  pixelizerInfo->num_params =  7; 
   pixelizerInfo->explanation = "Pixelize input image.";
 }
 
@@ -56,6 +86,31 @@ void f0r_get_param_info(f0r_param_info_t* info, int param_index)
       info->type = F0R_PARAM_DOUBLE;
       info->explanation = "Vertical size of one \"pixel\"";
       break;      
+    case 2:
+      info->name = "Shape";
+      info->type = F0R_PARAM_DOUBLE;
+      info->explanation = "Shape of the \"pixels\": 0 = rectangles, 0.5 = bricks, 1 = hexagons";
+      break;
+    case 3:
+      info->name = "Region X";
+      info->type = F0R_PARAM_DOUBLE;
+      info->explanation = "Left edge of the pixelized region";
+      break;
+    case 4:
+      info->name = "Region Y";
+      info->type = F0R_PARAM_DOUBLE;
+      info->explanation = "Top edge of the pixelized region";
+      break;
+    case 5:
+      info->name = "Region width";
+      info->type = F0R_PARAM_DOUBLE;
+      info->explanation = "Width of the pixelized region";
+      break;
+    case 6:
+      info->name = "Region height";
+      info->type = F0R_PARAM_DOUBLE;
+      info->explanation = "Height of the pixelized region";
+      break;
     }
 }
 
@@ -64,11 +119,22 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   pixelizer_instance_t* inst = (pixelizer_instance_t*)calloc(1, sizeof(*inst));
   inst->width = width; inst->height = height;
   inst->block_size_x = 8; inst->block_size_y = 8;
+  inst->shape = SHAPE_RECT;
+  inst->region[0] = 0.0; inst->region[1] = 0.0;
+  inst->region[2] = 1.0; inst->region[3] = 1.0;
+  inst->hex_cell[0] = (int*)malloc(2 * width * sizeof(int));
+  inst->hex_cell[1] = inst->hex_cell[0] + width;
+  inst->hex_dx2[0] = (unsigned int*)malloc(2 * width * sizeof(unsigned int));
+  inst->hex_dx2[1] = inst->hex_dx2[0] + width;
   return (f0r_instance_t)inst;
 }
 
 void f0r_destruct(f0r_instance_t instance)
 {
+  pixelizer_instance_t* inst = (pixelizer_instance_t*)instance;
+  free(inst->hex_cell[0]);
+  free(inst->hex_dx2[0]);
+  free(inst->colors);
   free(instance);
 }
 
@@ -88,6 +154,17 @@ void f0r_set_param_value(f0r_instance_t instance,
       // scale to [1..height]
       inst->block_size_y =  1 + ( *((double*)param) * (inst->height/2)) ;
       break;
+    case 2:
+      inst->shape = (int)(*((double*)param) * 2.0 + 0.5);
+      if (inst->shape < SHAPE_RECT) inst->shape = SHAPE_RECT;
+      if (inst->shape > SHAPE_HEX) inst->shape = SHAPE_HEX;
+      break;
+    case 3:
+    case 4:
+    case 5:
+    case 6:
+      inst->region[param_index - 3] = *((double*)param);
+      break;
     }  
 }
 
@@ -107,9 +184,268 @@ void f0r_get_param_value(f0r_instance_t instance,
       // scale back to [0..1]
       *((double*)param) = (double)(inst->block_size_y-1)/(inst->height/2);
       break;
+    case 2:
+      *((double*)param) = inst->shape / 2.0;
+      break;
+    case 3:
+    case 4:
+    case 5:
+    case 6:
+      *((double*)param) = inst->region[param_index - 3];
+      break;
     }  
 }
 
+static inline uint32_t cell_color(const uint32_t* sum, uint32_t n)
+{
+  return (((sum[3] / n) & 0xff) << 24) + (((sum[2] / n) & 0xff) << 16)
+    + (((sum[1] / n) & 0xff) << 8) + ((sum[0] / n) & 0xff);
+}
+
+/* Add n pixels to the channel sums of one cell. */
+static inline void add_pixels(uint32_t* sum, const uint32_t* p, int n)
+{
+  int x;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_loadu_si128((const __m128i*)sum);
+  for (x = 0; x + 2 <= n; x += 2)
+    {
+      /* two pixels as 16 bit channels, then pairwise into 32 bit */
+      __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + x)), zero);
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(c, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(c, zero));
+    }
+  if (x < n)
+    {
+      __m128i c = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)p[x]), zero);
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(c, zero));
+    }
+  _mm_storeu_si128((__m128i*)sum, acc);
+#else
+  for (x = 0; x < n; ++x)
+    {
+      uint32_t c = p[x];
+      sum[0] += c & 0xff;
+      sum[1] += (c >> 8) & 0xff;
+      sum[2] += (c >> 16) & 0xff;
+      sum[3] += c >> 24;
+    }
+#endif
+}
+
+/* Write output row y: the pixelized row inside the region, the input
+   outside of it. */
+static void put_row(const pixelizer_job_t* j, int y, const uint32_t* row)
+{
+  unsigned int w = j->inst->width;
+  const uint32_t* s = j->src + (size_t)y * w;
+  uint32_t* d = j->dst + (size_t)y * w;
+
+  if (y < j->y0 || y >= j->y1)
+    {
+      if (d != s)
+        memcpy(d, s, w * sizeof(uint32_t));
+      return;
+    }
+  if (d != s)
+    {
+      memcpy(d, s, j->x0 * sizeof(uint32_t));
+      memcpy(d + j->x1, s + j->x1, (w - j->x1) * sizeof(uint32_t));
+    }
+  memcpy(d + j->x0, row + j->x0, (j->x1 - j->x0) * sizeof(uint32_t));
+}
+
+/* Rectangles and bricks, block rows [first,last). */
+static void block_rows(void* arg, int first, int last, int slice)
+{
+  const pixelizer_job_t* j = (const pixelizer_job_t*)arg;
+  const pixelizer_instance_t* inst = j->inst;
+  int w = inst->width, h = inst->height;
+  int bx = inst->block_size_x, by = inst->block_size_y;
+  uint32_t* sums = j->scratch + slice * j->scratch_size;
+  uint32_t* row = sums + 4 * j->cells;
+  int r, c, x, y;
+
+  for (r = first; r < last; ++r)
+    {
+      int y0 = r * by, y1 = y0 + by < h ? y0 + by : h;
+      int shift = (inst->shape == SHAPE_BRICK && (r & 1)) ? bx / 2 : 0;
+      int n;
+
+      if (y1 <= j->y0 || y0 >= j->y1)
+        {
+          for (y = y0; y < y1; ++y)
+            put_row(j, y, 0);
+          continue;
+        }
+
+      memset(sums, 0, 4 * j->cells * sizeof(uint32_t));
+      for (y = y0; y < y1; ++y)
+        {
+          const uint32_t* s = j->src + (size_t)y * w;
+          for (c = 0, x = 0; x < w; ++c)
+            {
+              n = (c + 1) * bx - shift;
+              if (n > w) n = w;
+              add_pixels(sums + 4 * c, s + x, n - x);
+              x = n;
+            }
+        }
+
+      for (c = 0, x = 0; x < w; ++c)
+        {
+          uint32_t col;
+          int x1 = (c + 1) * bx - shift;
+          if (x1 > w) x1 = w;
+          col = cell_color(sums + 4 * c, (uint32_t)((x1 - x) * (y1 - y0)));
+          for (; x < x1; ++x)
+            row[x] = col;
+        }
+
+      for (y = y0; y < y1; ++y)
+        put_row(j, y, row);
+    }
+}
+
+/* Hexagon of the pixels of row y: the nearest centre in the cell row of
+   y or in the neighbouring one on the side of y's half.  Coordinates are
+   doubled, so that pixel and cell centres are integers. */
+typedef struct hex_row
+{
+  int r[2];
+  unsigned int dy2[2];
+  int n;
+} hex_row_t;
+
+static void hex_row_init(const pixelizer_instance_t* inst, int y, int rows,
+                         hex_row_t* hr)
+{
+  int by = inst->block_size_y;
+  int y2 = 2 * y + 1;
+  int r = y / by, d = y2 - (2 * r + 1) * by;
+  int r1 = d < 0 ? r - 1 : r + 1;
+
+  hr->r[0] = r;
+  hr->dy2[0] = (unsigned int)(d * d);
+  hr->n = 1;
+  if (r1 >= 0 && r1 < rows)
+    {
+      d = y2 - (2 * r1 + 1) * by;
+      hr->r[1] = r1;
+      hr->dy2[1] = (unsigned int)(d * d);
+      hr->n = 2;
+    }
+}
+
+static inline int hex_cell(const pixelizer_instance_t* inst,
+                           const hex_row_t* hr, int x, int* r)
+{
+  int p = hr->r[0] & 1;
+  if (hr->n > 1)
+    {
+      int q = hr->r[1] & 1;
+      if (inst->hex_dx2[q][x] + hr->dy2[1] < inst->hex_dx2[p][x] + hr->dy2[0])
+        {
+          *r = hr->r[1];
+          return inst->hex_cell[q][x];
+        }
+    }
+  *r = hr->r[0];
+  return inst->hex_cell[p][x];
+}
+
+static void hex_tables(pixelizer_instance_t* inst)
+{
+  int bx = inst->block_size_x;
+  int x, p;
+
+  for (p = 0; p < 2; ++p)
+    for (x = 0; x < (int)inst->width; ++x)
+      {
+        /* centres of row parity p at (2i + 1 + p) * bx, i >= -1 */
+        int x2 = 2 * x + 1;
+        int i = (x2 - p * bx + 2 * bx) / (2 * bx) - 1;
+        int d = x2 - (2 * i + 1 + p) * bx;
+        inst->hex_cell[p][x] = i + 1;
+        inst->hex_dx2[p][x] = (unsigned int)(d * d);
+      }
+}
+
+/* Hexagon rows [first,last): sum the band of pixel rows they can reach. */
+static void hex_sum_rows(void* arg, int first, int last, int slice)
+{
+  const pixelizer_job_t* j = (const pixelizer_job_t*)arg;
+  const pixelizer_instance_t* inst = j->inst;
+  int w = inst->width, h = inst->height, by = inst->block_size_y;
+  int rows = (h + by - 1) / by;
+  uint32_t* sums = j->scratch + slice * j->scratch_size;
+  int r, c, x, y;
+
+  for (r = first; r < last; ++r)
+    {
+      int y0 = r * by - by / 2 - 1, y1 = (r + 1) * by + by / 2 + 1;
+      if (y0 < 0) y0 = 0;
+      if (y1 > h) y1 = h;
+
+      memset(sums, 0, 5 * j->cells * sizeof(uint32_t));
+      for (y = y0; y < y1; ++y)
+        {
+          const uint32_t* s = j->src + (size_t)y * w;
+          hex_row_t hr;
+          hex_row_init(inst, y, rows, &hr);
+          if (hr.r[0] != r && (hr.n < 2 || hr.r[1] != r))
+            continue;
+          for (x = 0; x < w; ++x)
+            {
+              int cr;
+              c = hex_cell(inst, &hr, x, &cr);
+              if (cr == r)
+                {
+                  add_pixels(sums + 5 * c, s + x, 1);
+                  sums[5 * c + 4]++;
+                }
+            }
+        }
+
+      for (c = 0; c < j->cells; ++c)
+        if (sums[5 * c + 4])
+          inst->colors[r * j->cells + c] = cell_color(sums + 5 * c, sums[5 * c + 4]);
+    }
+}
+
+/* Then lay out output rows [first,last). */
+static void hex_put_rows(void* arg, int first, int last, int slice)
+{
+  const pixelizer_job_t* j = (const pixelizer_job_t*)arg;
+  const pixelizer_instance_t* inst = j->inst;
+  int h = inst->height, by = inst->block_size_y;
+  int rows = (h + by - 1) / by;
+  uint32_t* row = j->scratch + slice * j->scratch_size;
+  int x, y;
+
+  for (y = first; y < last; ++y)
+    {
+      if (y >= j->y0 && y < j->y1)
+        {
+          hex_row_t hr;
+          hex_row_init(inst, y, rows, &hr);
+          for (x = j->x0; x < j->x1; ++x)
+            {
+              int r, c = hex_cell(inst, &hr, x, &r);
+              row[x] = inst->colors[r * j->cells + c];
+            }
+        }
+      put_row(j, y, row);
+    }
+}
+
+static int region_edge(double v, unsigned int size)
+{
+  int e = (int)(v * size + 0.5);
+  return e < 0 ? 0 : e > (int)size ? (int)size : e;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
 		const uint32_t* inframe, uint32_t* outframe)
 {
@@ -119,108 +455,56 @@ void f0r_update(f0r_instance_t instance, double time,
   unsigned int ysize = inst->height;
   unsigned int bsizex = inst->block_size_x;
   unsigned int bsizey = inst->block_size_y;
-  unsigned int offset = 0;
-  unsigned int blocks_x, blocks_y, xrest, yrest, xi, yi;
+  unsigned int rows = (ysize + bsizey - 1) / bsizey;
+  pixelizer_job_t job;
+  int slices;
 
+  job.inst = inst;
+  job.src = inframe;
+  job.dst = outframe;
+  job.x0 = region_edge(inst->region[0], xsize);
+  job.y0 = region_edge(inst->region[1], ysize);
+  job.x1 = region_edge(inst->region[0] + inst->region[2], xsize);
+  job.y1 = region_edge(inst->region[1] + inst->region[3], ysize);
+  if (job.x1 < job.x0) job.x1 = job.x0;
+  if (job.y1 < job.y0) job.y1 = job.y0;
 
-  blocks_x = xsize / bsizex;
-  blocks_y = ysize / bsizey;
-  xrest = xsize - blocks_x*bsizex;
-  yrest = ysize - blocks_y*bsizey;
-
-  uint32_t* dst = outframe;
-  const uint32_t* src = inframe;
+  if ((bsizex == 1 && bsizey == 1) || job.x0 == job.x1 || job.y0 == job.y1)
+    {
+      if (outframe != inframe)
+        memcpy(outframe, inframe, xsize*ysize*sizeof(uint32_t));
+      return;
+    }
 
+  /* one more cell for the half block sticking out of shifted rows */
+  job.cells = (xsize + bsizex - 1) / bsizex + 1;
 
-  if (bsizex == 1 && bsizey == 1)
+  if (inst->shape != SHAPE_HEX)
     {
-      memcpy(dst, src, xsize*ysize*sizeof(uint32_t));
+      slices = f0r_slice_count(rows, 1);
+      job.scratch_size = 4 * job.cells + xsize;
+      job.scratch = (uint32_t*)malloc(slices * job.scratch_size * sizeof(uint32_t));
+      f0r_parallel_for(rows, 1, block_rows, &job);
+      free(job.scratch);
+      return;
     }
 
-  
-  // now get average for every block and write the average color to the output
-  for (yi = 0; yi < blocks_y; ++yi)
-    {	  
-      offset = yi*bsizey*xsize;
-      for (xi = 0; xi < blocks_x; ++xi)
-	{
-	  uint32_t col = average(src + offset, bsizex, bsizey, xsize);
-	  fill_block(dst + offset, bsizex, bsizey, xsize, col);
-	  offset += bsizex;
-	}
-      if (xrest > 0)
-	{
-	  uint32_t col = average(src + offset, xrest, bsizey, xsize);
-	  fill_block(dst + offset, xrest, bsizey, xsize, col);
-	}
-    }
-  // check for last line
-  if (yrest > 0)
-    {
-      offset = blocks_y*bsizey*xsize;
-      for (xi = 0; xi < blocks_x; ++xi)
-	{
-	  uint32_t col = average(src + offset, bsizex, yrest, xsize);
-	  fill_block(dst + offset, bsizex, yrest, xsize, col);
-	  offset += bsizex;
-	}
-      if (xrest > 0)
-	{
-	  uint32_t col = average(src + offset, xrest, yrest, xsize);
-	  fill_block(dst + offset, xrest, yrest, xsize, col);
-	}
-    } 
-}
-
-
-static uint32_t average(const uint32_t* start, 
-			int bxsize, int bysize, int xsize)
-{
-  const uint32_t* p = start;
-  uint32_t alpha = 0, red = 0, green = 0, blue = 0;
-  uint32_t avg_alpha, avg_red, avg_green, avg_blue;
-  int x, y;
-  const uint32_t* pp;
-  uint32_t c;
-  
-  for (y = 0; y < bysize; ++y)
-    {
-      pp = p;
-      for (x = 0; x < bxsize; ++x)
-	{
-	  c = *(pp++);
-          alpha += (c & 0xff000000) >> 24;
-	  red   += (c & 0x00ff0000) >> 16;
-	  green += (c & 0x0000ff00) >> 8;
-	  blue  += (c & 0x000000ff);
-	}
-      p += xsize;
+  if (inst->colors_size < rows * job.cells)
+    {
+      free(inst->colors);
+      inst->colors_size = rows * job.cells;
+      inst->colors = (uint32_t*)malloc(inst->colors_size * sizeof(uint32_t));
     }
-  
-  avg_alpha = (alpha / (bxsize*bysize)) & 0xff;
-  avg_red   = (red   / (bxsize*bysize)) & 0xff;
-  avg_green = (green / (bxsize*bysize)) & 0xff;
-  avg_blue  = (blue  / (bxsize*bysize)) & 0xff;
-  
-  return (avg_alpha << 24) + (avg_red << 16) + (avg_green << 8) + avg_blue;
-}
-
-static void fill_block(uint32_t* start, int bxsize, int bysize,
-                       int xsize, uint32_t col)
-{
-	uint32_t* p = start;
-	int x, y;
-	uint32_t* pp;
-
-	for (y = 0; y < bysize; ++y)
-	{
-		pp = p;
-		for (x = 0; x < bxsize; ++x)
-		{
-			*(pp++) = col;
-		}
-		p += xsize;
-	}
+  hex_tables(inst);
 
+  slices = f0r_slice_count(rows, 1);
+  if (f0r_slice_count(ysize, 16) > slices)
+    slices = f0r_slice_count(ysize, 16);
+  job.scratch_size = 5 * (size_t)job.cells;
+  if (job.scratch_size < xsize)
+    job.scratch_size = xsize;
+  job.scratch = (uint32_t*)malloc(slices * job.scratch_size * sizeof(uint32_t));
+  f0r_parallel_for(rows, 1, hex_sum_rows, &job);
+  f0r_parallel_for(ysize, 16, hex_put_rows, &job);
+  free(job.scratch);
 }
-
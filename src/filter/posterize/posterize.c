@@ -56,6 +56,11 @@ void f0r_get_plugin_info(f0r_plugin_info_t* posterize_info)
   posterize_info->explanation = "Posterizes image by reducing the number of colors used in image";
 }
 
+unsigned int f0r_get_capabilities(void)
+{
+  return F0R_CAP_INPLACE;
+}
+
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
   switch(param_index)
@@ -24,10 +24,14 @@ class Premultiply : public frei0r::filter
 
 public:
 
+    static void describe(frei0r::param_list<Premultiply>& params)
+    {
+        params.add(&Premultiply::m_unpremultiply, "unpremultiply", "Whether to unpremultiply instead");
+    }
+
     Premultiply(unsigned int width, unsigned int height)
         : m_unpremultiply(0)
     {
-        register_param(m_unpremultiply, "unpremultiply", "Whether to unpremultiply instead");
     }
 
     ~Premultiply()
@@ -81,4 +85,5 @@ frei0r::construct<Premultiply> plugin("Premultiply or Unpremultiply",
                 "Multiply (or divide) each color component by the pixel's alpha value",
                 "Dan Dennedy",
                 0, 2,
-                F0R_COLOR_MODEL_RGBA8888);
+                F0R_COLOR_MODEL_RGBA8888,
+                F0R_CAP_INPLACE);
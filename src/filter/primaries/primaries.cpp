@@ -36,9 +36,12 @@ private:
 	double factor;
 	
 public:
+	static void describe(frei0r::param_list<primaries>& params) {
+		params.add(&primaries::factor, "Factor", "influence of mean px value. > 32 = 0");
+	}
+
 	primaries(unsigned int width, unsigned int height) {
 		factor = 1;
-		register_param(factor, "Factor", "influence of mean px value. > 32 = 0");
 	}
 	~primaries() {
 	}
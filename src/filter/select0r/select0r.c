@@ -30,6 +30,7 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 
 //#include <stdio.h>	/* for debug printf only +/
 #include <frei0r.h>
+#include "frei0r_pixel.h"
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
@@ -666,6 +667,7 @@ typedef struct
 	int soft;
 	int inv;
 	int op;
+	unsigned int model;	//frei0r color model of the frames
 } inst;
 
 //-----------------------------------------------------
@@ -711,6 +713,12 @@ void f0r_get_plugin_info(f0r_plugin_info_t* info)
 	info->explanation="Color based alpha selection";
 }
 
+//--------------------------------------------------
+unsigned int f0r_get_capabilities(void)
+{
+	return F0R_CAP_INPLACE | F0R_CAP_RGBA16161616 | F0R_CAP_RGBA_FLOAT32;
+}
+
 //--------------------------------------------------
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
@@ -790,6 +798,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 	in->soft=0;
 	in->inv=0;
 	in->op=0;
+	in->model=F0R_COLOR_MODEL_RGBA8888;
 	
 	return (f0r_instance_t)in;
 }
@@ -916,6 +925,40 @@ void f0r_get_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
 	}
 }
 
+//--------------------------------------------------
+int f0r_set_color_model(f0r_instance_t instance, unsigned int color_model)
+{
+	inst *in=(inst*)instance;
+	
+	if (!f0r_pixel_model_ok(color_model, f0r_get_capabilities())) return 0;
+	in->model=color_model;
+	return 1;
+}
+
+//-------------------------------------------------
+//combine the selection with the alpha of float RGBA pixels
+//(16 bit and float color models)
+void apply_alpha_f(float *px, const float_rgba *sl, int n, int op)
+{
+	int i;
+	float a;
+	
+	for (i=0;i<n;i++)
+	{
+		a=px[4*i+3];
+		switch (op)
+		{
+		case 0: a=sl[i].a; break;				//write on clear
+		case 1: if (sl[i].a>a) a=sl[i].a; break;	//max
+		case 2: if (sl[i].a<a) a=sl[i].a; break;	//min
+		case 3: a=a+sl[i].a; if (a>1.0) a=1.0; break;	//add
+		case 4: a=a-sl[i].a; if (a<0.0) a=0.0; break;	//subtract
+		default: break;
+		}
+		px[4*i+3]=a;
+	}
+}
+
 //-------------------------------------------------
 //RGBA8888 little endian
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
@@ -929,6 +972,7 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 	float f1=1.0/256.0;
 	uint8_t a1,a2;
 	float_rgba *sl;
+	float *px;
 
 	assert(instance);
 	in=(inst*)instance;
@@ -946,13 +990,31 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 	
 	//convert to float
 	sl = calloc(in->w * in->h, sizeof(float_rgba));
-	cin=(uint8_t *)inframe;
-	for (i=0;i<in->h*in->w;i++)
+	px = NULL;
+	if (in->model == F0R_COLOR_MODEL_RGBA8888)
 	{
-		sl[i].r=f1*(float)*cin++;
-		sl[i].g=f1*(float)*cin++;
-		sl[i].b=f1*(float)*cin++;
-		cin++;
+		cin=(uint8_t *)inframe;
+		for (i=0;i<in->h*in->w;i++)
+		{
+			sl[i].r=f1*(float)*cin++;
+			sl[i].g=f1*(float)*cin++;
+			sl[i].b=f1*(float)*cin++;
+			cin++;
+		}
+	}
+	else
+	{	//float frames are worked on in the output frame
+		if (in->model == F0R_COLOR_MODEL_RGBA_FLOAT32)
+			px = (float *)outframe;
+		else
+			px = malloc(4 * in->w * in->h * sizeof(float));
+		f0r_pixels_to_float(inframe, in->model, px, in->w * in->h, 1.0);
+		for (i=0;i<in->h*in->w;i++)
+		{
+			sl[i].r=px[4*i];
+			sl[i].g=px[4*i+1];
+			sl[i].b=px[4*i+2];
+		}
 	}
 	
 	//make the selection
@@ -976,6 +1038,16 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 		for (i=0;i<in->h*in->w;i++)
 			sl[i].a = 1.0 - sl[i].a;
 	
+	if (px != NULL)
+	{
+		apply_alpha_f(px, sl, in->w * in->h, in->op);
+		f0r_pixels_from_float(px, in->model, outframe, in->w * in->h, 1.0);
+		if (px != (float *)outframe)
+			free(px);
+		free(sl);
+		return;
+	}
+	
 	//apply alpha
 	cin=(uint8_t *)inframe;
 	cout=(uint8_t *)outframe;
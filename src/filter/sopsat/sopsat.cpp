@@ -76,22 +76,28 @@ public:
     double aPower;
     double saturation;
 
+    // The constructor builds the lookup tables, so hosts get the
+    // parameters from here (see frei0r::param_list).
+    static void describe(frei0r::param_list<SOPSat>& params)
+    {
+        params.add(&SOPSat::rSlope, "rSlope", "Slope of the red color component");
+        params.add(&SOPSat::gSlope, "gSlope", "Slope of the green color component");
+        params.add(&SOPSat::bSlope, "bSlope", "Slope of the blue color component");
+        params.add(&SOPSat::aSlope, "aSlope", "Slope of the alpha component");
+        params.add(&SOPSat::rOffset, "rOffset", "Offset of the red color component");
+        params.add(&SOPSat::gOffset, "gOffset", "Offset of the green color component");
+        params.add(&SOPSat::bOffset, "bOffset", "Offset of the blue color component");
+        params.add(&SOPSat::aOffset, "aOffset", "Offset of the alpha component");
+        params.add(&SOPSat::rPower, "rPower", "Power (Gamma) of the red color component");
+        params.add(&SOPSat::gPower, "gPower", "Power (Gamma) of the green color component");
+        params.add(&SOPSat::bPower, "bPower", "Power (Gamma) of the blue color component");
+        params.add(&SOPSat::aPower, "aPower", "Power (Gamma) of the alpha component");
+        params.add(&SOPSat::saturation, "saturation", "Overall saturation");
+    }
+
     SOPSat(unsigned int, unsigned int)
     {
 
-        register_param(rSlope, "rSlope", "Slope of the red color component");
-        register_param(gSlope, "gSlope", "Slope of the green color component");
-        register_param(bSlope, "bSlope", "Slope of the blue color component");
-        register_param(aSlope, "aSlope", "Slope of the alpha component");
-        register_param(rOffset, "rOffset", "Offset of the red color component");
-        register_param(gOffset, "gOffset", "Offset of the green color component");
-        register_param(bOffset, "bOffset", "Offset of the blue color component");
-        register_param(aOffset, "aOffset", "Offset of the alpha component");
-        register_param(rPower, "rPower", "Power (Gamma) of the red color component");
-        register_param(gPower, "gPower", "Power (Gamma) of the green color component");
-        register_param(bPower, "bPower", "Power (Gamma) of the blue color component");
-        register_param(aPower, "aPower", "Power (Gamma) of the alpha component");
-        register_param(saturation, "saturation", "Overall saturation");
         rSlope = 1 / 20.;
         gSlope = 1 / 20.;
         bSlope = 1 / 20.;
@@ -71,6 +71,11 @@ void f0r_get_plugin_info(f0r_plugin_info_t* threshold0r_info)
   threshold0r_info->explanation = "Thresholds a source image";
 }
 
+unsigned int f0r_get_capabilities(void)
+{
+  return F0R_CAP_INPLACE;
+}
+
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
   switch(param_index)
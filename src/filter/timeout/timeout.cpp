@@ -52,13 +52,16 @@ class Timeout : public frei0r::filter
 
 public:
 
+    static void describe(frei0r::param_list<Timeout>& params)
+    {
+        params.add(&Timeout::m_time, "time", "Current time");
+        params.add(&Timeout::m_color, "color", "Indicator colour");
+        params.add(&Timeout::m_transparency, "transparency", "Indicator transparency");
+    }
+
     Timeout(unsigned int width, unsigned int height)
 
     {
-        register_param(m_time, "time", "Current time");
-        register_param(m_color, "color", "Indicator colour");
-        register_param(m_transparency, "transparency", "Indicator transparency");
-
         W = std::min(width, height) / 20;
         H = W;
 
@@ -53,6 +53,11 @@ void f0r_get_plugin_info(f0r_plugin_info_t* tint0r_instance_t)
   tint0r_instance_t->explanation = "Tint a source image with specified color";
 }
 
+unsigned int f0r_get_capabilities(void)
+{
+  return F0R_CAP_INPLACE;
+}
+
 void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 {
   switch(param_index)
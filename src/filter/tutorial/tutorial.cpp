@@ -41,14 +41,21 @@ class Tutorial : public frei0r::filter
 
 public:
 
+    // Hosts ask for the parameters before (or without) building an instance.
+    // Listing them here spares building one just for that, which is worth it
+    // if the constructor is expensive like this one.
+    static void describe(frei0r::param_list<Tutorial>& params)
+    {
+        params.add(&Tutorial::m_barSize, "barSize", "Size of the black bar");
+        params.add(&Tutorial::m_pointerMethod, "pointerMethod", "Pointer Method (internal)");
+    }
+
     Tutorial(unsigned int width, unsigned int height)
 
     {
         // Everything here is example code and can be removed on copy/paste.
 
 
-        register_param(m_barSize, "barSize", "Size of the black bar");
-        register_param(m_pointerMethod, "pointerMethod", "Pointer Method (internal)");
         m_barSize = 0.1;
 
 
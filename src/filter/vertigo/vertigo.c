@@ -22,11 +22,17 @@
 
 
 #include "frei0r.h"
+#include "frei0r_thread.h"
+#include "frei0r_warp.h"
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 typedef struct vertigo_instance
 {
@@ -168,6 +174,76 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+typedef struct vertigo_job
+{
+  vertigo_instance_t* inst;
+  const uint32_t* src;
+  uint32_t* dst;
+} vertigo_job_t;
+
+/* Zoom rows [first,last): each row is a straight span through the
+   previous output, blended 3:1 with the input. */
+static void vertigo_rows(void* arg, int first, int last, int slice)
+{
+  vertigo_job_t* job = (vertigo_job_t*)arg;
+  vertigo_instance_t* inst = job->inst;
+  int w = inst->width;
+  int32_t offs[1024];
+  int y, x, n, k;
+  (void)slice;
+
+  for(y=first; y<last; y++)
+  {
+    /* where the row starts, as if stepped down from the first one */
+    int32_t ox = (int32_t)((uint32_t)inst->sx - (uint32_t)y * (uint32_t)inst->dy);
+    int32_t oy = (int32_t)((uint32_t)inst->sy + (uint32_t)y * (uint32_t)inst->dx);
+    const uint32_t* src = job->src + y*w;
+    uint32_t* dst = job->dst + y*w;
+    uint32_t* p = inst->alt_buffer + y*w;
+
+    for(x=0; x<w; x+=n)
+    {
+      n = w - x < 1024 ? w - x : 1024;
+      f0r_warp_offsets(offs, n, ox, oy, inst->dx, inst->dy, w,
+                       inst->pixels - 1);
+      k = 0;
+#if defined(__SSE2__)
+      {
+        const __m128i mask = _mm_set1_epi32(0xfcfcff);
+        const __m128i amask = _mm_set1_epi32(0xff000000);
+        const uint32_t* cur = inst->current_buffer;
+        for(; k+4<=n; k+=4)
+        {
+          __m128i s = _mm_loadu_si128((const __m128i*)(src + k));
+          __m128i v = _mm_setr_epi32(cur[offs[k]], cur[offs[k+1]],
+                                     cur[offs[k+2]], cur[offs[k+3]]);
+          v = _mm_and_si128(v, mask);
+          v = _mm_add_epi32(_mm_add_epi32(v, _mm_slli_epi32(v, 1)),
+                            _mm_and_si128(s, mask));
+          v = _mm_srli_epi32(v, 2);
+          _mm_storeu_si128((__m128i*)(p + k), v);
+          _mm_storeu_si128((__m128i*)(dst + k),
+                           _mm_or_si128(v, _mm_and_si128(s, amask)));
+        }
+      }
+#endif
+      for(; k<n; k++)
+      {
+        uint32_t v = inst->current_buffer[offs[k]] & 0xfcfcff;
+        uint32_t alpha = src[k] & 0xff000000;
+        v = (v * 3) + (src[k] & 0xfcfcff);
+        dst[k] = (v>>2) | alpha;
+        p[k] = (v>>2);
+      }
+      src += n;
+      dst += n;
+      p += n;
+      ox = (int32_t)((uint32_t)ox + (uint32_t)n * (uint32_t)inst->dx);
+      oy = (int32_t)((uint32_t)oy + (uint32_t)n * (uint32_t)inst->dy);
+    }
+  }
+}
+
 void f0r_update(f0r_instance_t instance, double time,
 		const uint32_t* inframe, uint32_t* outframe)
 {
@@ -183,10 +259,7 @@ void f0r_update(f0r_instance_t instance, double time,
   uint32_t* dst = outframe;
   const uint32_t* src = inframe;
   uint32_t *p;
-  uint32_t v;
-  uint32_t alpha;
-  int ox, oy;
-  int i;
+  vertigo_job_t job;
 
   double vx, vy;
   double dizz;
@@ -228,29 +301,10 @@ void f0r_update(f0r_instance_t instance, double time,
   inst->phase += inst->phase_increment;
   if(inst->phase > 5700000) inst->phase = 0;
 
-
-  p = inst->alt_buffer;
-
-  for(y=h; y>0; y--) 
-  {
-    ox = inst->sx;
-    oy = inst->sy;
-    for(x=w; x>0; x--) 
-    {
-      i = (oy>>16)*w + (ox>>16);
-      if(i<0) i = 0;
-      if(i>=inst->pixels) i = inst->pixels;
-      v = inst->current_buffer[i] & 0xfcfcff;
-      alpha = *src & 0xff000000;
-      v = (v * 3) + ((*src++) & 0xfcfcff);
-      *dst++ = (v>>2) | alpha;
-      *p++ = (v>>2);
-      ox += inst->dx;
-      oy += inst->dy;
-    }
-    inst->sx -= inst->dy;
-    inst->sy += inst->dx;
-  }
+  job.inst = inst;
+  job.src = src;
+  job.dst = dst;
+  f0r_parallel_for(h, 16, vertigo_rows, &job);
 
   p = inst->current_buffer;
   inst->current_buffer = inst->alt_buffer;
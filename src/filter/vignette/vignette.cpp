@@ -18,8 +18,14 @@
  */
 
 #include <cmath>
+#include <vector>
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_thread.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 /**
@@ -32,6 +38,10 @@
   the frame's aspect ratio). The ClearCenter value allows one to shift the
   vignetting away from the center, preserving it from changes.
 
+  The vignette is symmetric around the frame center, so only one quadrant
+  of it is evaluated and the mask keeps the rows of the lower half only,
+  as 1.15 fixed point factors; the upper half reads them mirrored.
+
   */
 class Vignette : public frei0r::filter
 {
@@ -42,14 +52,17 @@ public:
     double m_cc; ///< Neutral value: 0
     double m_soft; ///< Suggested value: 0.6
 
+    static void describe(frei0r::param_list<Vignette>& params)
+    {
+        params.add(&Vignette::m_aspect, "aspect", "Aspect ratio");
+        params.add(&Vignette::m_cc, "clearCenter", "Size of the unaffected center");
+        params.add(&Vignette::m_soft, "soft", "Softness");
+    }
+
     Vignette(unsigned int width, unsigned int height) :
         m_width(width),
         m_height(height)
     {
-        register_param(m_aspect, "aspect", "Aspect ratio");
-        register_param(m_cc, "clearCenter", "Size of the unaffected center");
-        register_param(m_soft, "soft", "Softness");
-
         // Suggested default values
         m_aspect = .5;
         m_cc = 0;
@@ -57,23 +70,30 @@ public:
 
         m_initialized = width*height > 0;
         if (m_initialized) {
-            m_vignette = new float[width*height];
+            m_vignette.resize((size_t)m_width * (m_height/2 + 1));
             updateVignette();
         }
     }
 
-    ~Vignette()
-    {
-        if (m_initialized) {
-            delete[] m_vignette;
-        }
-    }
-
     virtual void update(double time,
 	                    uint32_t* out,
                         const uint32_t* in)
     {
-        std::copy(in, in + m_width*m_height, out);
+        f0r_roi_t all = { 0, 0, int(m_width), int(m_height) };
+        update_ex(time, out, m_width*4, in, m_width*4, 0, 0, 0, 0, all);
+    }
+
+    // Works on strided rows directly, without the packed copies
+    virtual void update_ex(double time,
+                           uint32_t* out, int out_stride,
+                           const uint32_t* in, int in_stride,
+                           const uint32_t*, int,
+                           const uint32_t*, int,
+                           const f0r_roi_t& roi)
+    {
+        if (!m_initialized || roi.width <= 0 || roi.height <= 0) {
+            return;
+        }
 
         // Rebuild the vignette matrix if a parameter has changed
         if (m_prev_aspect != m_aspect
@@ -82,19 +102,13 @@ public:
             updateVignette();
         }
 
-        unsigned char *pixel = (unsigned char *) in;
-        unsigned char *dest = (unsigned char *) out;
-
         // Darken the pixels by multiplying with the vignette's factor
-        float *vignette = m_vignette;
-        for (unsigned int i = 0; i < size; i++) {
-            *dest++ = (char) (*vignette * *pixel++);
-            *dest++ = (char) (*vignette * *pixel++);
-            *dest++ = (char) (*vignette * *pixel++);
-            *dest++ = *pixel++;
-            vignette++;
-        }
-
+        m_in = in;
+        m_in_stride = in_stride;
+        m_out = out;
+        m_out_stride = out_stride;
+        m_roi = roi;
+        f0r_parallel_for(roi.height, 16, applyRows, this);
     }
 
 private:
@@ -102,12 +116,117 @@ private:
     double m_prev_cc;
     double m_prev_soft;
 
-    float *m_vignette;
+    // Factor of 32768 = 1 for every pixel of the rows |y - height/2|
+    std::vector<uint16_t> m_vignette;
     bool m_initialized;
 
     unsigned int m_width;
     unsigned int m_height;
 
+    // Settings of the current vignette, for buildRows()
+    float m_soft_f;
+    float m_scaleX;
+    float m_scaleY;
+    float m_rmax;
+
+    const uint32_t* m_in;
+    uint32_t* m_out;
+    int m_in_stride;
+    int m_out_stride;
+    f0r_roi_t m_roi;
+
+    const uint16_t* maskRow(int y) const
+    {
+        int dy = y - int(m_height/2);
+        return &m_vignette[(size_t)(dy < 0 ? -dy : dy) * m_width];
+    }
+
+    static void applyRows(void* arg, int first, int last, int slice)
+    {
+        Vignette* self = static_cast<Vignette*>(arg);
+        unsigned int x1 = self->m_roi.x + self->m_roi.width;
+        (void)slice;
+
+        for (int y = self->m_roi.y + first; y < self->m_roi.y + last; y++) {
+            const uint16_t* vignette = self->maskRow(y);
+            const unsigned char *pixel = (const unsigned char *) self->m_in + (ptrdiff_t)y*self->m_in_stride;
+            unsigned char *dest = (unsigned char *) self->m_out + (ptrdiff_t)y*self->m_out_stride;
+            unsigned int x = self->m_roi.x;
+#if defined(__SSE2__)
+            // 4 pixels at a time: (2*channel * factor) >> 16, alpha
+            // multiplied by 1
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rgb = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+            const __m128i alpha = _mm_set_epi16(-32768, 0, 0, 0, -32768, 0, 0, 0);
+            for (; x + 4 <= x1; x += 4) {
+                __m128i p = _mm_loadu_si128((const __m128i*)(pixel + 4*x));
+                __m128i f = _mm_loadl_epi64((const __m128i*)(vignette + x));
+                f = _mm_unpacklo_epi16(f, f);
+                __m128i flo = _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi32(f, f), rgb), alpha);
+                __m128i fhi = _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi32(f, f), rgb), alpha);
+                __m128i lo = _mm_slli_epi16(_mm_unpacklo_epi8(p, zero), 1);
+                __m128i hi = _mm_slli_epi16(_mm_unpackhi_epi8(p, zero), 1);
+                lo = _mm_mulhi_epu16(lo, flo);
+                hi = _mm_mulhi_epu16(hi, fhi);
+                _mm_storeu_si128((__m128i*)(dest + 4*x), _mm_packus_epi16(lo, hi));
+            }
+#endif
+            for (; x < x1; x++) {
+                unsigned int f = vignette[x];
+                dest[4*x+0] = (pixel[4*x+0] * f) >> 15;
+                dest[4*x+1] = (pixel[4*x+1] * f) >> 15;
+                dest[4*x+2] = (pixel[4*x+2] * f) >> 15;
+                dest[4*x+3] = pixel[4*x+3];
+            }
+        }
+    }
+
+    // Mask rows [first,last), i.e. |y - height/2| for the lower half.
+    // Each row evaluates the right half and mirrors it to the left.
+    static void buildRows(void* arg, int first, int last, int slice)
+    {
+        Vignette* self = static_cast<Vignette*>(arg);
+        int width = self->m_width;
+        int cx = width/2;
+        float cc = self->m_cc;
+        (void)slice;
+
+        for (int dy = first; dy < last; dy++) {
+            uint16_t* row = &self->m_vignette[(size_t)dy * width];
+            float yy = self->m_scaleY*dy;
+            for (int dx = 0; dx <= cx; dx++) {
+                float xx = self->m_scaleX*dx;
+
+                // Euclidian distance to the center, normalized to [0,1]
+                float r = std::sqrt(xx*xx + yy*yy)/self->m_rmax;
+
+                // Subtract the clear center
+                r -= cc;
+
+                float v;
+                if (r <= 0) {
+                    // Clear center: Do not modify the brightness here
+                    v = 1;
+                } else {
+                    r *= self->m_soft_f;
+                    if (r > M_PI_2) {
+                        v = 0;
+                    } else {
+                        float c = std::cos(r);
+                        c *= c;
+                        v = c*c;
+                    }
+                }
+
+                uint16_t f = uint16_t(v*32768 + .5f);
+                row[cx - dx] = f;
+                if (cx + dx < width) {
+                    row[cx + dx] = f;
+                }
+            }
+        }
+    }
+
     void updateVignette()
     {
 //        std::cout << "New settings: aspect = " << m_aspect << ", clear center = " << m_cc << ", soft = " << m_soft << std::endl;
@@ -133,34 +252,12 @@ private:
 
         int cx = m_width/2;
         int cy = m_height/2;
-        float rmax = std::sqrt(std::pow(float(cx), 2) + std::pow(float(cy), 2));
-        float r;
-
-        for (int y = 0; y < m_height; y++) {
-            for (int x = 0; x < m_width; x++) {
-
-                // Euclidian distance to the center, normalized to [0,1]
-                r = std::sqrt(std::pow(scaleX*(x-cx), 2) + std::pow(scaleY*(y-cy), 2))/rmax;
-
-                // Subtract the clear center
-                r -= m_cc;
-
-                if (r <= 0) {
-                    // Clear center: Do not modify the brightness here
-                    m_vignette[y*m_width+x] = 1;
-                } else {
-                    r *= soft;
-                    if (r > M_PI_2) {
-                        m_vignette[y*m_width+x] = 0;
-                    } else {
-                        m_vignette[y*m_width+x] = std::pow(std::cos(r), 4);
-                    }
-                }
-
-            }
-        }
-
+        m_rmax = std::sqrt(std::pow(float(cx), 2) + std::pow(float(cy), 2));
+        m_soft_f = soft;
+        m_scaleX = scaleX;
+        m_scaleY = scaleY;
 
+        f0r_parallel_for(cy + 1, 16, buildRows, this);
     }
 
 };
@@ -171,4 +268,5 @@ frei0r::construct<Vignette> plugin("Vignette",
                 "Lens vignetting effect, applies natural vignetting",
                 "Simon A. Eugster (Granjow)",
                 0,2,
-                F0R_COLOR_MODEL_RGBA8888);
+                F0R_COLOR_MODEL_RGBA8888,
+                F0R_CAP_INPLACE);
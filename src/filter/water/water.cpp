@@ -33,6 +33,12 @@
 #include <time.h>
 
 #include <frei0r.hpp>
+#include "frei0r_math.h"
+#include "frei0r_thread.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 #define CLIP_EDGES \
@@ -56,6 +62,13 @@
 #define PI 3.14159265358979323846
 #endif
 
+/* heights are 16 bit and saturate instead of wrapping */
+#define HMIN -32768
+#define HMAX 32767
+static inline int16_t hclip(int h) {
+  return (int16_t)(h < HMIN ? HMIN : h > HMAX ? HMAX : h);
+}
+
 typedef struct {
   int16_t w;
   int16_t h;
@@ -74,23 +87,37 @@ public:
   bool swirl;
   bool randomize_swirl;
 
+  // the constructor builds tables and buffers, so hosts get the
+  // parameters from here (see frei0r::param_list)
+  static void describe(frei0r::param_list<Water>& params) {
+    params.add(&Water::physics, "physics", "water density: from 1 to 4");
+    params.add(&Water::rain, "rain", "rain drops all over");
+    params.add(&Water::distort, "distort", "distort all surface like dropping a bucket to the floor");
+    params.add(&Water::smooth, "smooth", "smooth up all perturbations on the surface");
+    params.add(&Water::surfer, "surfer", "surf the surface with a wandering finger");
+    params.add(&Water::swirl, "swirl", "swirling whirpool in the center");
+    params.add(&Water::randomize_swirl, "randomize_swirl", "randomize the swirling angle");
+  }
+
   Water(unsigned int width, unsigned int height) {
     physics = 0.0;
-    register_param(physics, "physics", "water density: from 1 to 4");
-    register_param(rain, "rain", "rain drops all over");
-    register_param(distort, "distort", "distort all surface like dropping a bucket to the floor");
-    register_param(smooth, "smooth", "smooth up all perturbations on the surface");
-    register_param(surfer, "surfer", "surf the surface with a wandering finger");
-    register_param(swirl, "swirl", "swirling whirpool in the center");
-    register_param(randomize_swirl, "randomize_swirl", "randomize the swirling angle");
+    rain = false;
+    distort = false;
+    smooth = false;
+    surfer = false;
+    swirl = true;
+    randomize_swirl = false;
+    /* distort and randomize_swirl act once when they are switched on */
+    was_distort = false;
+    was_randomize_swirl = false;
 
     Hpage = 0;
-    ox = 80;
-    oy = 80;
+    ox = width>>1;
+    oy = height>>1;
     done = 0;
     mode = 0x4000;
 
-    BkGdImagePre = BkGdImage = BkGdImagePost = 0;
+    BkGdImage = 0;
     Height[0] = Height[1] = 0;
     
     /* default physics */
@@ -110,8 +137,7 @@ public:
     geo->h = height;
     geo->size =  width*height*sizeof(uint32_t);
 
-    water_surfacesize = geo->size;
-    calc_optimization = (height-1)*width;
+    water_surfacesize = width*height*sizeof(int16_t);
     
     xang = fastrand()%2048;
     yang = fastrand()%2048;
@@ -119,35 +145,42 @@ public:
     
     /* buffer allocation tango */
     if ( width*height > 0 ) {
-        Height[0] = (uint32_t*)calloc(width*height, sizeof(uint32_t));
-        Height[1] = (uint32_t*)calloc(width*height, sizeof(uint32_t));
+        Height[0] = (int16_t*)calloc(width*height, sizeof(int16_t));
+        Height[1] = (int16_t*)calloc(width*height, sizeof(int16_t));
     }
     //    buffer =    (uint32_t*)    malloc(geo->size);
     if ( geo->size > 0 ) {
-        BkGdImagePre = (uint32_t*) malloc(geo->size);
         BkGdImage =    (uint32_t*) malloc(geo->size);
-        BkGdImagePost = (uint32_t*)malloc(geo->size);
     }
 
-
-    swirl = 1;
-
   }
 
   ~Water() {
     delete geo;
     free(Height[0]);
     free(Height[1]);
-    free(BkGdImagePre);
     free(BkGdImage);
-    free(BkGdImagePost);
     //    free(buffer);
   }
 
-  virtual void update() {
+  virtual void update(double time,
+                      uint32_t* out,
+                      const uint32_t* in) {
+
+    if (width < 3 || height < 3) {
+      memcpy(out, in, width*height*sizeof(uint32_t));
+      return;
+    }
+
+    /* the surface refracts the input frame directly, unless the
+       output overwrites it */
+    if (in == out) {
+      memcpy(BkGdImage, in, width*height*sizeof(uint32_t));
+      in = BkGdImage;
+    }
+    bkgd = in;
+    this->out = out;
 
-    memcpy(BkGdImage, in, width*height*sizeof(uint32_t));
-    
     water_update();
 
   }
@@ -156,11 +189,13 @@ private:
   ScreenGeometry *geo;
 
   /* 2 pages of Height field */
-  uint32_t *Height[2];
-  /* 3 copies of the background */
-  uint32_t *BkGdImagePre;
+  int16_t *Height[2];
+  /* copy of the background, for in-place updates */
   uint32_t *BkGdImage;
-  uint32_t *BkGdImagePost;
+
+  /* current frame */
+  const uint32_t *bkgd;
+  uint32_t *out;
   
   //  uint32_t *buffer;
   
@@ -176,7 +211,6 @@ private:
   
   /* precalculated to optimize a bit */
   int water_surfacesize;
-  int calc_optimization;
   
   /* density: water density (step 1)
      pheight: splash height (step 40)
@@ -187,6 +221,9 @@ private:
   int raincount;
   int blend;
 
+  bool was_distort;
+  bool was_randomize_swirl;
+
   void water_clear();
   void water_distort();
   void water_setphysics(double physics);
@@ -197,8 +234,9 @@ private:
   void water_swirl();
   void water_3swirls();
   
-  void DrawWater(int page);
-  void CalcWater(int npage, int density);
+  void DrawWater(int page, int y);
+  void CalcWater(int npage, int density, int y);
+  static void WaterRows(void* arg, int first, int last, int slice);
   void CalcWaterBigFilter(int npage, int density);
   
   void SmoothWater(int npage);
@@ -228,6 +266,13 @@ private:
   void fastsrand(uint32_t seed) { randval = seed; };
   
   /* integer optimized square root by jaromil */
+  /* a random centre of a blob, radius pixels and more inside a row or
+     column of the given size, or its middle if the blob does not fit */
+  int randpos(int size, int radius) {
+    int span = size - 2*radius - 1;
+    return span > 0 ? 1 + radius + (int)(fastrand()%span) : size>>1;
+  }
+
   int isqrt(unsigned int x) {
     unsigned int m, y, b; m = 0x40000000;
     y = 0; while(m != 0) { b = y | m; y = y>>1;
@@ -324,6 +369,18 @@ void Water::water_setphysics(double physics) {
 
 void Water::water_update() {
 
+  water_setphysics(physics);
+
+  if(distort && !was_distort && !rain) water_distort();
+  was_distort = distort;
+
+  if(randomize_swirl && !was_randomize_swirl) {
+    swirlangle = fastrand()%2048;
+    xang = fastrand()%2048;
+    yang = fastrand()%2048;
+  }
+  was_randomize_swirl = randomize_swirl;
+
   if(rain) {
     raincount++;
     if(raincount>3) {
@@ -334,12 +391,24 @@ void Water::water_update() {
 
   if(swirl) water_swirl();
   if(surfer) water_surfer();
-  DrawWater(Hpage);
+  if(smooth) SmoothWater(Hpage);
 
-  CalcWater(Hpage^1, density);
+  /* render the current page and compute the next one in a single pass
+     over the rows: both only read the current page */
+  f0r_parallel_for(geo->h, 16, WaterRows, this);
   Hpage ^=1 ;
 }
 
+void Water::WaterRows(void* arg, int first, int last, int slice) {
+  Water* w = static_cast<Water*>(arg);
+  (void)slice;
+  for (int y = first; y < last; y++) {
+    w->DrawWater(w->Hpage, y);
+    if (y > 0 && y < w->geo->h - 1)
+      w->CalcWater(w->Hpage^1, w->density, y);
+  }
+}
+
 void Water::water_drop(int x, int y) {
   if(mode & 0x4000)
     HeightBlob(x,y, radius>>2, pheight, Hpage);
@@ -371,22 +440,27 @@ void Water::water_surfer() {
 	) >> 16);
   xang += 13;
   yang += 12;
+
+  /* the drops below touch the 4 neighbours of the finger, which thus
+     stays off the border of the frame */
+  x = CLAMP(x, 1, geo->w-2);
+  y = CLAMP(y, 1, geo->h-2);
   
   if(mode & 0x4000)
     {
       offset = (oy+y)/2*geo->w + ((ox+x)>>1); // QUAAA
-      Height[Hpage][offset] = pheight;
+      Height[Hpage][offset] = hclip(pheight);
       Height[Hpage][offset + 1] =
 	Height[Hpage][offset - 1] =
 	Height[Hpage][offset + geo->w] =
-	Height[Hpage][offset - geo->w] = pheight >> 1;
+	Height[Hpage][offset - geo->w] = hclip(pheight >> 1);
       
       offset = y*geo->w + x;
-      Height[Hpage][offset] = pheight<<1;
+      Height[Hpage][offset] = hclip(pheight<<1);
       Height[Hpage][offset + 1] =
 	Height[Hpage][offset - 1] =
 	Height[Hpage][offset + geo->w] =
-	Height[Hpage][offset - geo->w] = pheight;
+	Height[Hpage][offset - geo->w] = hclip(pheight);
     }
   else
     {
@@ -458,61 +532,101 @@ void Water::water_3swirls() {
 }
 
 /* internal physics routines */
-void Water::DrawWater(int page) {
-  int dx, dy;
-  int x, y;
-  int c;
-  int offset=geo->w + 1;
-  int *ptr = (int*)&Height[page][0];
-  
-  for (y = calc_optimization; offset < y; offset += 2) {
-    for (x = offset+geo->w-2; offset < x; offset++) {
-      dx = ptr[offset] - ptr[offset+1];
-      dy = ptr[offset] - ptr[offset+geo->w];
-      c = BkGdImage[offset + geo->w*(dy>>3) + (dx>>3)];
-      
-      out[offset] = c;
 
-      offset++;
-      dx = ptr[offset] - ptr[offset+1];
-      dy = ptr[offset] - ptr[offset+geo->w];
-      c = BkGdImage[offset + geo->w*(dy>>3) + (dx>>3)];
+/* Light refraction of row y: every pixel shows the background shifted
+   by the slope of the surface.  The border has no slope and is copied. */
+void Water::DrawWater(int page, int y) {
+  int w = geo->w, h = geo->h;
+  const int16_t *ptr = Height[page] + y*w;
+  const uint32_t *src = bkgd + y*w;
+  uint32_t *dst = out + y*w;
+  int dx, dy, sx, sy;
+  int x;
+
+  if (y == 0 || y == h - 1) {
+    memcpy(dst, src, w*sizeof(uint32_t));
+    return;
+  }
 
-      out[offset] = c;      
-    }
+  dst[0] = src[0];
+  for (x = 1; x < w - 1; x++) {
+    dx = ptr[x] - ptr[x+1];
+    dy = ptr[x] - ptr[x+w];
+    sx = x + (dx>>3);
+    sy = y + (dy>>3);
+    if ((unsigned int)sx >= (unsigned int)w) sx = sx < 0 ? 0 : w - 1;
+    if ((unsigned int)sy >= (unsigned int)h) sy = sy < 0 ? 0 : h - 1;
+    dst[x] = bkgd[sy*w + sx];
   }
+  dst[w-1] = src[w-1];
 }
 
-void Water::CalcWater(int npage, int density) {
+/* Wave propagation of row y into the next page, from the current one. */
+void Water::CalcWater(int npage, int density, int y) {
   int newh;
-  int count = geo->w + 1;
-  int *newptr = (int*) &Height[npage][0];
-  int *oldptr = (int*) &Height[npage^1][0];
-  int x, y;
-
-  for (y = calc_optimization; count < y; count += 2) {
-    for (x = count+geo->w-2; count < x; count++) {
-      /* eight pixels */
-      newh = ((oldptr[count + geo->w]
-	       + oldptr[count - geo->w]
-	       + oldptr[count + 1]
-	       + oldptr[count - 1]
-	       + oldptr[count - geo->w - 1]
-	       + oldptr[count - geo->w + 1]
-	       + oldptr[count + geo->w - 1]
-	       + oldptr[count + geo->w + 1]
-	       ) >> 2 )
-	- newptr[count];
-      newptr[count] =  newh - (newh >> density);
-    }
+  int w = geo->w;
+  int16_t *newptr = Height[npage] + y*w;
+  const int16_t *oldptr = Height[npage^1] + y*w;
+  int x = 1;
+
+#if defined(__SSE2__)
+  /* 8 heights at a time, the neighbours are summed pairwise into 32 bit
+     with a multiply-add so nothing can overflow */
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i shift = _mm_cvtsi32_si128(density);
+  for (; x + 8 <= w - 1; x += 8) {
+    const int16_t *up = oldptr + x - w, *mid = oldptr + x, *dn = oldptr + x + w;
+    __m128i ul = _mm_loadu_si128((const __m128i*)(up - 1));
+    __m128i uc = _mm_loadu_si128((const __m128i*)up);
+    __m128i ur = _mm_loadu_si128((const __m128i*)(up + 1));
+    __m128i ml = _mm_loadu_si128((const __m128i*)(mid - 1));
+    __m128i mr = _mm_loadu_si128((const __m128i*)(mid + 1));
+    __m128i dl = _mm_loadu_si128((const __m128i*)(dn - 1));
+    __m128i dc = _mm_loadu_si128((const __m128i*)dn);
+    __m128i dr = _mm_loadu_si128((const __m128i*)(dn + 1));
+    __m128i n = _mm_loadu_si128((const __m128i*)(newptr + x));
+
+    __m128i lo = _mm_add_epi32(
+      _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(ul, uc), ones),
+                    _mm_madd_epi16(_mm_unpacklo_epi16(ur, ml), ones)),
+      _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(mr, dl), ones),
+                    _mm_madd_epi16(_mm_unpacklo_epi16(dc, dr), ones)));
+    __m128i hi = _mm_add_epi32(
+      _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(ul, uc), ones),
+                    _mm_madd_epi16(_mm_unpackhi_epi16(ur, ml), ones)),
+      _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(mr, dl), ones),
+                    _mm_madd_epi16(_mm_unpackhi_epi16(dc, dr), ones)));
+
+    lo = _mm_sub_epi32(_mm_srai_epi32(lo, 2),
+                       _mm_srai_epi32(_mm_unpacklo_epi16(n, n), 16));
+    hi = _mm_sub_epi32(_mm_srai_epi32(hi, 2),
+                       _mm_srai_epi32(_mm_unpackhi_epi16(n, n), 16));
+    lo = _mm_sub_epi32(lo, _mm_sra_epi32(lo, shift));
+    hi = _mm_sub_epi32(hi, _mm_sra_epi32(hi, shift));
+    _mm_storeu_si128((__m128i*)(newptr + x), _mm_packs_epi32(lo, hi));
+  }
+#endif
+  for (; x < w - 1; x++) {
+    /* eight pixels */
+    newh = ((oldptr[x + w]
+	     + oldptr[x - w]
+	     + oldptr[x + 1]
+	     + oldptr[x - 1]
+	     + oldptr[x - w - 1]
+	     + oldptr[x - w + 1]
+	     + oldptr[x + w - 1]
+	     + oldptr[x + w + 1]
+	     ) >> 2 )
+      - newptr[x];
+    newptr[x] =  hclip(newh - (newh >> density));
   }
 }
 
 void Water::SmoothWater(int npage) {
   int newh;
   int count = geo->w + 1;
-  int *newptr = (int*) &Height[npage][0];
-  int *oldptr = (int*) &Height[npage^1][0];
+  int16_t *newptr = Height[npage];
+  int16_t *oldptr = Height[npage^1];
   int x, y;
 
   for(y=1; y<geo->h-1; y++) {
@@ -530,7 +644,7 @@ void Water::SmoothWater(int npage) {
 	+ newptr[count];
       
       
-      newptr[count] =  newh>>1;
+      newptr[count] =  hclip(newh>>1);
       count++;
     }
     count += 2;
@@ -540,8 +654,8 @@ void Water::SmoothWater(int npage) {
 void Water::CalcWaterBigFilter(int npage, int density) {
   int newh;
   int count = (geo->w<<1) + 2;
-  int *newptr = (int*) &Height[npage][0];
-  int *oldptr = (int*) &Height[npage^1][0];
+  int16_t *newptr = Height[npage];
+  int16_t *oldptr = Height[npage^1];
   int x, y;
   
   for(y=2; y<geo->h-2; y++) {
@@ -578,7 +692,7 @@ void Water::CalcWaterBigFilter(int npage, int density) {
 	       )
 	      >> 3)
 	- (newptr[count]);
-      newptr[count] =  newh - (newh >> density);
+      newptr[count] =  hclip(newh - (newh >> density));
       count++;
     }
     count += 4;
@@ -593,8 +707,8 @@ void Water::HeightBlob(int x, int y, int radius, int height, int page) {
   rquad = radius * radius;
 
   /* Make a randomly-placed blob... */
-  if(x<0) x = 1+radius+ fastrand()%(geo->w-2*radius-1);
-  if(y<0) y = 1+radius+ fastrand()%(geo->h-2*radius-1);
+  if(x<0) x = randpos(geo->w, radius);
+  if(y<0) y = randpos(geo->h, radius);
 
   left=-radius; right = radius;
   top=-radius; bottom = radius;
@@ -605,7 +719,10 @@ void Water::HeightBlob(int x, int y, int radius, int height, int page) {
     cyq = cy*cy;
     for(cx = left; cx < right; cx++) {
       if(cx*cx + cyq < rquad)
-        Height[page][geo->w*(cy+y) + (cx+x)] += height;
+      {
+        int16_t *h = &Height[page][geo->w*(cy+y) + (cx+x)];
+        *h = hclip(*h + height);
+      }
     }
   }
 }
@@ -615,8 +732,8 @@ void Water::HeightBox (int x, int y, int radius, int height, int page) {
   int cx, cy;
   int left, top, right, bottom;
 
-  if(x<0) x = 1+radius+ fastrand()%(geo->w-2*radius-1);
-  if(y<0) y = 1+radius+ fastrand()%(geo->h-2*radius-1);
+  if(x<0) x = randpos(geo->w, radius);
+  if(y<0) y = randpos(geo->h, radius);
   
   left=-radius; right = radius;
   top=-radius; bottom = radius;
@@ -625,7 +742,7 @@ void Water::HeightBox (int x, int y, int radius, int height, int page) {
   
   for(cy = top; cy < bottom; cy++) {
     for(cx = left; cx < right; cx++) {
-      Height[page][geo->w*(cy+y) + (cx+x)] = height;
+      Height[page][geo->w*(cy+y) + (cx+x)] = hclip(height);
     }
   } 
 }
@@ -649,8 +766,8 @@ void Water::WarpBlob(int x, int y, int radius, int height, int page) {
     for(cx = left; cx < right; cx++) {
       square = cy*cy + cx*cx;
       if(square < radsquare) {
-	Height[page][geo->w*(cy+y) + cx+x]
-          += (int)((radius-isqrt(square))*(float)(height));
+	int16_t *h = &Height[page][geo->w*(cy+y) + cx+x];
+	*h = hclip(*h + (int)((radius-isqrt(square))*(float)(height)));
       }
     }
   }
@@ -663,8 +780,8 @@ void Water::SineBlob(int x, int y, int radius, int height, int page) {
   int radsquare = radius * radius;
   float length = (1024.0/(float)radius)*(1024.0/(float)radius);
   
-  if(x<0) x = 1+radius+ fastrand()%(geo->w-2*radius-1);
-  if(y<0) y = 1+radius+ fastrand()%(geo->h-2*radius-1);
+  if(x<0) x = randpos(geo->w, radius);
+  if(y<0) y = randpos(geo->h, radius);
 
   radsquare = (radius*radius);
   left=-radius; right = radius;
@@ -677,8 +794,8 @@ void Water::SineBlob(int x, int y, int radius, int height, int page) {
       square = cy*cy + cx*cx;
       if(square < radsquare) {
         dist = (int)(isqrt(square*length));
-        Height[page][geo->w*(cy+y) + cx+x]
-          += (int)((FCos(dist)+0xffff)*(height)) >> 19;
+        int16_t *h = &Height[page][geo->w*(cy+y) + cx+x];
+        *h = hclip(*h + ((int)((FCos(dist)+0xffff)*(height)) >> 19));
       }
     }
   }
@@ -27,7 +27,12 @@
 #include <string.h>
 #include <inttypes.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <frei0r.hpp>
+#include <frei0r_thread.h>
 
 
 typedef struct {
@@ -52,6 +57,8 @@ public:
   Plasma(int wdt, int hgt);
   ~Plasma();
 
+  static void describe(frei0r::param_list<Plasma>& params);
+
   virtual void update(double time, uint32_t* out);
 
 private:
@@ -62,14 +69,22 @@ private:
 
 
   uint16_t pos1, pos2, pos3, pos4;
-  uint16_t tpos1, tpos2, tpos3, tpos4;
 
   int aSin[512];
 
   Palette colors[256];
+  uint32_t rgba[256]; // colors, packed once
 
   uint32_t palette2rgb(uint8_t idx);
 
+  // Every row starts the horizontal sines at the same phase, so their
+  // sum only depends on the column, and the vertical ones on the row.
+  int16_t *colsum;
+  int16_t *rowsum;
+  uint32_t *image;
+
+  static void render_rows(void* arg, int first, int last, int slice);
+
   // vectors (exposed parameters from 0 to 1)
   double speed1; // 5
   double speed2; // 3
@@ -96,22 +111,29 @@ void Plasma::_init(int wdt, int hgt) {
   geo.pitch = geo.w*(geo.bpp/8);
 }
 
-Plasma::Plasma(int wdt, int hgt) {
+// the constructor builds the sine and palette tables, so hosts get
+// the parameters from here (see frei0r::param_list)
+void Plasma::describe(frei0r::param_list<Plasma>& params) {
+  params.add(&Plasma::speed1, "1_speed", " ");
+  params.add(&Plasma::speed2, "2_speed", " ");
+  params.add(&Plasma::speed3, "3_speed", " ");
+  params.add(&Plasma::speed4, "4_speed", " ");
 
-  register_param(speed1, "1_speed", " ");
-  register_param(speed2, "2_speed", " ");
-  register_param(speed3, "3_speed", " ");
-  register_param(speed4, "4_speed", " ");
+  params.add(&Plasma::move1, "1_move", " ");
+  params.add(&Plasma::move2, "2_move", " ");
+}
+
+Plasma::Plasma(int wdt, int hgt) {
 
-  register_param(move1, "1_move", " ");
-  register_param(move2, "2_move", " ");
-  
-  
   int i;
   float rad;
 
   _init(wdt, hgt);
 
+  pos1 = pos2 = pos3 = pos4 = 0;
+  colsum = new int16_t[geo.w + 8];
+  rowsum = new int16_t[geo.h];
+
  
   /*create sin lookup table */
   for (i = 0; i < 512; i++)
@@ -127,7 +149,8 @@ Plasma::Plasma(int wdt, int hgt) {
       
     }
   
-  /* create palette */
+  /* create palette, components not set below are 0 */
+  memset(colors, 0, sizeof(colors));
   for (i = 0; i < 64; ++i)
     {
       colors[i].r = i << 2;
@@ -138,6 +161,8 @@ Plasma::Plasma(int wdt, int hgt) {
       colors[i+128].g = 255 - ((i << 2) + 1);
       colors[i+192].g = (i << 2) + 1; 
     } 
+  for (i = 0; i < 256; ++i)
+    rgba[i] = palette2rgb(i);
 
   speed1 = 1.;
   speed2 = 1.;
@@ -156,15 +181,12 @@ Plasma::Plasma(int wdt, int hgt) {
 }
 
 Plasma::~Plasma() {
-
+  delete[] colsum;
+  delete[] rowsum;
 }
 
 void Plasma::update(double time, uint32_t* out) {
   uint16_t i, j;
-  uint8_t index;
-  int x;
-
-  uint32_t *image = (uint32_t*)out;
 
   // number parameters are not good in frei0r
   // we need types defining multipliers and min/max values
@@ -182,37 +204,21 @@ void Plasma::update(double time, uint32_t* out) {
   _move1 = _move1 * move1;
   _move2 = _move2 * move2;
 
-  tpos4 = pos4;
-  tpos3 = pos3;
-  
+  // positions in closed form: step n of a sine walking at speed s
+  // from p is at (p + n*s) & 511, with uint16_t wrap-around as before
+  for (j = 0; j < geo.w; ++j) {
+    uint16_t tpos1 = pos1 + (j + 1) * (int)_speed1;
+    uint16_t tpos2 = pos2 + (j + 1) * (int)_speed2;
+    colsum[j] = aSin[tpos1 & 511] + aSin[tpos2 & 511];
+  }
   for (i = 0; i < geo.h; ++i) {
-    tpos1 = pos1 + (int)_speed1;
-    tpos2 = pos2 + (int)_speed2;
-    
-    tpos3 &= 511;
-    tpos4 &= 511;
-    
-    for (j = 0; j < geo.w; ++j) {
-      tpos1 &= 511;
-      tpos2 &= 511;
-      
-      x = aSin[tpos1] + aSin[tpos2] + aSin[tpos3] + aSin[tpos4];
-      /*actual plasma calculation*/
-      
-      index = 128 + (x >> 4);
-      /* fixed point multiplication but optimized so basically
-	 it  says (x  * (64  * 1024)  / (1024  * 1024)),  x is
-	 already multiplied by 1024*/
-      
-      *image++ = palette2rgb(index);
-      
-      tpos1 += (int)_speed1; 
-      tpos2 += (int)_speed2; 
-    }
-    
-    tpos4 += (int)_speed3;
-    tpos3 += (int)_speed4;
+    uint16_t tpos3 = pos3 + i * (int)_speed4;
+    uint16_t tpos4 = pos4 + i * (int)_speed3;
+    rowsum[i] = aSin[tpos3 & 511] + aSin[tpos4 & 511];
   }
+
+  image = out;
+  f0r_parallel_for(geo.h, 16, render_rows, this);
   
   /* move plasma */
   
@@ -220,6 +226,38 @@ void Plasma::update(double time, uint32_t* out) {
   pos3 += (int)_move2;
 }
 
+void Plasma::render_rows(void* arg, int first, int last, int slice) {
+  Plasma* p = static_cast<Plasma*>(arg);
+  int w = p->geo.w;
+  uint16_t index[8];
+  (void)slice;
+
+  for (int i = first; i < last; ++i) {
+    uint32_t *image = p->image + i * w;
+    int16_t row = p->rowsum[i];
+    int j = 0;
+
+    /*actual plasma calculation*/
+    /* index = 128 + (x >> 4): fixed point multiplication but
+       optimized so basically it says (x * (64 * 1024) / (1024 * 1024)),
+       x is already multiplied by 1024 */
+#if defined(__SSE2__)
+    const __m128i r = _mm_set1_epi16(row);
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i mask = _mm_set1_epi16(255);
+    for (; j + 8 <= w; j += 8) {
+      __m128i x = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(p->colsum + j)), r);
+      x = _mm_and_si128(_mm_add_epi16(_mm_srai_epi16(x, 4), half), mask);
+      _mm_storeu_si128((__m128i*)index, x);
+      for (int k = 0; k < 8; ++k)
+        image[j + k] = p->rgba[index[k]];
+    }
+#endif
+    for (; j < w; ++j)
+      image[j] = p->rgba[(uint8_t)(128 + ((p->colsum[j] + row) >> 4))];
+  }
+}
+
 uint32_t Plasma::palette2rgb(uint8_t idx) {
   uint32_t rgba;
   // just for little endian
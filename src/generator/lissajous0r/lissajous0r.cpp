@@ -32,11 +32,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 class lissajous0r: public frei0r::source
 {
 public:
+  static void describe(frei0r::param_list<lissajous0r>& params)
+  {
+    params.add(&lissajous0r::r_x,"ratiox","x-ratio");
+    params.add(&lissajous0r::r_y,"ratioy","y-ratio");
+  }
+
   lissajous0r(unsigned int width, unsigned int height)
   {
     r_x = r_y = 0.0;
-    register_param(r_x,"ratiox","x-ratio");
-    register_param(r_y,"ratioy","y-ratio");
   }
 
   
@@ -25,9 +25,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 class onecol0r : public frei0r::source
 {
 public:
+  static void describe(frei0r::param_list<onecol0r>& params)
+  {
+    params.add(&onecol0r::color,"Color","the color of the image");
+  }
+
   onecol0r(unsigned int width, unsigned int height)
   {
-    register_param(color,"Color","the color of the image");
     color.r = color.g = color.b = 0;
   }
   
@@ -26,6 +26,7 @@
 
 
 #include "frei0r.hpp"
+#include "frei0r_thread.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -40,6 +41,10 @@
 #include <inttypes.h>
 #include <limits.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /* defines for blob size and roundness */
 #define LIM 8 // 25
 #define NB_BLOB 16 // 25
@@ -51,6 +56,8 @@ public:
 
   Partik0l(unsigned int width, unsigned int height);
   ~Partik0l();
+
+  static void describe(frei0r::param_list<Partik0l>& params);
   
   void update(double time,
               uint32_t* out);
@@ -82,8 +89,9 @@ private:
   double wd, hd;
 
 
-  void blob(uint32_t* out, int x, int y);
+  void blob(uint32_t* out, int x, int y, int first, int last);
   void blossom(uint32_t* out);
+  static void blossom_rows(void* arg, int first, int last, int slice);
   void blob_init(int ray);
   void blossom_recal(bool r);
 
@@ -92,16 +100,25 @@ private:
   uint32_t *blob_buf;
   int blob_size;
 
+  /* blob positions of the current frame, splatted band by band */
+  int *blob_x, *blob_y;
+  int blob_count, blob_max;
+  uint32_t *frame;
+
   void fastsrand(uint32_t seed);
   uint32_t fastrand();
 
   uint32_t randval;
 };
 
-Partik0l::Partik0l(unsigned int width, unsigned int height) {
+// the constructor allocates the frame buffers, so hosts get the
+// parameters from here (see frei0r::param_list)
+void Partik0l::describe(frei0r::param_list<Partik0l>& params) {
+  params.add(&Partik0l::up, "up", "blossom on a higher prime number");
+  params.add(&Partik0l::down, "down", "blossom on a lower prime number");
+}
 
-  register_param(up, "up", "blossom on a higher prime number");
-  register_param(down, "down", "blossom on a lower prime number");
+Partik0l::Partik0l(unsigned int width, unsigned int height) {
 
   /* initialize prime numbers */
   prime[0] = 2;
@@ -141,6 +158,10 @@ Partik0l::Partik0l(unsigned int width, unsigned int height) {
   
   
   blob_buf = NULL;
+
+  blob_max = (int)(pi2 / 0.005) + 2;
+  blob_x = new int[blob_max];
+  blob_y = new int[blob_max];
   
   blossom_recal(true);
   
@@ -153,6 +174,8 @@ Partik0l::Partik0l(unsigned int width, unsigned int height) {
 Partik0l::~Partik0l() {
   //  if(pixels) free(pixels);
   if(blob_buf) free(blob_buf);
+  delete[] blob_x;
+  delete[] blob_y;
 }
 
 
@@ -206,24 +229,34 @@ void Partik0l::blossom_recal(bool r) {
 void Partik0l::blossom(uint32_t* out) {
   
   float	a;
-  int x, y;
+  int n = 0;
   double zx, zy;
 
   /* here place a formula that draws on the screen
      the surface being drawed at this point is always blank */
-  for( a=0.0 ; a<pi2; a+=0.005 ) {
+  for( a=0.0 ; a<pi2 && n<blob_max; a+=0.005 ) {
     zx = blossom_m*a;
     zy = blossom_n*a;
-    x = (int)(wd*(0.47+ (blossom_r*sin(blossom_i*zx+blossom_a)+
+    blob_x[n] = (int)(wd*(0.47+ (blossom_r*sin(blossom_i*zx+blossom_a)+
 			 (1.0-blossom_r)*sin(blossom_k*zy+blossom_a)) /2.2 ));
     
-    y = (int)(hd*(0.47+ (blossom_r*cos(blossom_j*zx+blossom_a)+
+    blob_y[n] = (int)(hd*(0.47+ (blossom_r*cos(blossom_j*zx+blossom_a)+
 			 (1.0-blossom_r)*cos(blossom_l*zy+blossom_a)) /2.2 ));
-    
-    blob(out, x,y);
-    
+    n++;
   } 
+  blob_count = n;
 
+  /* every band of rows adds the part of each blob falling into it,
+     so the bands never touch the same pixels and run in parallel */
+  frame = out;
+  f0r_parallel_for(h, blob_size, blossom_rows, this);
+}
+
+void Partik0l::blossom_rows(void* arg, int first, int last, int slice) {
+  Partik0l* p = static_cast<Partik0l*>(arg);
+  (void)slice;
+  for (int n = 0; n < p->blob_count; n++)
+    p->blob(p->frame, p->blob_x[n], p->blob_y[n], first, last);
 }
 
 void Partik0l::blob_init(int ray) {
@@ -265,68 +298,30 @@ void Partik0l::blob_init(int ray) {
 }
   
 
-void Partik0l::blob(uint32_t* out, int x, int y) {
-  //  if(y>h-blob_size) return;
-  //  if(x>w-blob_size) return;
-
+void Partik0l::blob(uint32_t* out, int x, int y, int first, int last) {
   int i, j;
-  int stride = (w-blob_size)>>1;
+  int x0 = std::max(x, 0), x1 = std::min(x + blob_size, w);
+  int y0 = std::max(y, first), y1 = std::min(y + blob_size, last);
 
-  uint64_t *tmp_scr = (uint64_t*)out + ((x + y*w)>>1);
-  uint64_t *tmp_blob = (uint64_t*)blob_buf;
-
-#ifdef HAVE_MMX
-  /* using mmx packed unsaturated addition on bytes
+  /* packed saturated addition on bytes
      for cleaner and shiny result */
-  for(j=blob_size; j>0; j--) {
-    for(i=blob_size>>4; i>0; i--) {
-      
-      asm volatile("movq (%1),%%mm0;"
-		   "movq 8(%1),%%mm1;"
-		   "movq 16(%1),%%mm2;"
-		   "movq 24(%1),%%mm3;"
-		   "movq 32(%1),%%mm4;"
-		   "movq 40(%1),%%mm5;"
-		   "movq 48(%1),%%mm6;"
-		   "movq 56(%1),%%mm7;"
-
-		   "paddusb (%0),%%mm0;" // packed add unsaturated on bytes
-		   "paddusb 8(%0),%%mm1;" // addizione clippata
-		   "paddusb 16(%0),%%mm2;"
-		   "paddusb 24(%0),%%mm3;"
-		   "paddusb 32(%0),%%mm4;"
-		   "paddusb 40(%0),%%mm5;"
-		   "paddusb 48(%0),%%mm6;"
-		   "paddusb 56(%0),%%mm7;"
-
-		   "movq %%mm0,(%0);"	  
-		   "movq %%mm1,8(%0);"	  
-		   "movq %%mm2,16(%0);"	  
-		   "movq %%mm3,24(%0);"	  
-		   "movq %%mm4,32(%0);"	  
-		   "movq %%mm5,40(%0);"	  
-		   "movq %%mm6,48(%0);"	 
-		   "movq %%mm7,56(%0);"
-		   //	  "paddsw %0, %%mm0;"// halo violetto?
-		   :
-		   :"r"(tmp_scr),"r"(tmp_blob)
-		   :"memory");
-      tmp_scr+=8;
-      tmp_blob+=8;
-    }
-    tmp_scr += stride;
-  }
-  asm("emms;");
-
-
-#else // ! HAVE_MMX
-  for(j=blob_size; j>0; j--) {
-    for(i=blob_size>>1; i>0; i--) {
-      *(tmp_scr++) += *(tmp_blob++);
+  for(j=y0; j<y1; j++) {
+    uint32_t *scr = out + j*w;
+    const uint32_t *src = blob_buf + (j-y)*blob_size - x;
+    i = x0;
+#if defined(__SSE2__)
+    for(; i+4<=x1; i+=4)
+      _mm_storeu_si128((__m128i*)(scr+i),
+                       _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(scr+i)),
+                                     _mm_loadu_si128((const __m128i*)(src+i))));
+#endif
+    for(; i<x1; i++) {
+      uint8_t *d = (uint8_t*)(scr+i);
+      const uint8_t *b = (const uint8_t*)(src+i);
+      for(int c=0; c<4; c++)
+        d[c] = (d[c]+b[c] > 255) ? 255 : d[c]+b[c];
     }
-    tmp_scr += stride;
   }
-#endif
 
 }
 
@@ -33,6 +33,7 @@ Test patterns: cross sections of color spaces
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "frei0r.h"
 
@@ -482,6 +483,8 @@ typedef struct
   int fs;
 
   float_rgba *sl;
+  uint32_t *frame;	//the pattern, ready for output
+  int dirty;		//frame needs to be rebuilt
 
 } tp_inst_t;
 
@@ -553,6 +556,8 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->fs=0;
 
   inst->sl=(float_rgba*)calloc(width*height,sizeof(float_rgba));
+  inst->frame=(uint32_t*)calloc(width*height,sizeof(uint32_t));
+  inst->dirty=1;
 
   x0=(inst->w-3*inst->h/4)/2;
   y0=inst->h/8;
@@ -573,6 +578,7 @@ void f0r_destruct(f0r_instance_t instance)
   tp_inst_t* inst = (tp_inst_t*)instance;
 
   free(inst->sl);
+  free(inst->frame);
   free(inst);
 }
 
@@ -621,6 +627,7 @@ void f0r_set_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
     }
 
   if (chg==0) return;
+  inst->dirty=1;
 
   if (inst->fs==0)
     {
@@ -693,6 +700,12 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
   assert(instance);
   tp_inst_t* inst = (tp_inst_t*)instance;
 
-  floatrgba2color(inst->sl, outframe, inst->w , inst->h);
+  //the pattern only changes with the parameters, convert it once
+  if (inst->dirty)
+    {
+    floatrgba2color(inst->sl, inst->frame, inst->w , inst->h);
+    inst->dirty=0;
+    }
+  memcpy(outframe, inst->frame, inst->w*inst->h*sizeof(uint32_t));
 
 }
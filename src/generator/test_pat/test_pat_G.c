@@ -44,6 +44,7 @@ DV legality etc.
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "frei0r.h"
 
@@ -584,6 +585,8 @@ typedef struct
   unsigned char *sl;
   unsigned char *alpha;
   uint32_t *c2c;
+  uint32_t *frame;	//the pattern, ready for output
+  int dirty;		//frame needs to be rebuilt
 
 } tp_inst_t;
 
@@ -662,6 +665,8 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 
   inst->par=1.0;
   inst->sl=(unsigned char*)calloc(width*height,1);
+  inst->frame=(uint32_t*)calloc(width*height,sizeof(uint32_t));
+  inst->dirty=1;
   inst->alpha=(unsigned char*)calloc(width*height,1);
   inst->c2c=(uint32_t *)calloc(256,sizeof(uint32_t));
 
@@ -677,6 +682,7 @@ void f0r_destruct(f0r_instance_t instance)
   tp_inst_t* inst = (tp_inst_t*)instance;
 
   free(inst->sl);
+  free(inst->frame);
   free(inst->alpha);
   free(inst->c2c);
   free(inst);
@@ -750,6 +756,7 @@ void f0r_set_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
     }
 
   if (chg==0) return;
+  inst->dirty=1;
 
   switch (inst->type)
     {
@@ -827,36 +834,42 @@ void f0r_get_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
 //COLOR MODEL DEPENDENT
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
 {
-  int i;
+  unsigned int i;
 
   assert(instance);
   tp_inst_t* inst = (tp_inst_t*)instance;
 
-  switch (inst->type)
+  //the pattern only changes with the parameters, convert it once
+  if (inst->dirty)
     {
-    case 0:
-    case 1:
-    case 2:
-    case 3:
-    case 4:
-    case 5:
-    case 6:
-    case 7:
-    case 9:
-    case 10:
-      for (i=0;i<(inst->h*inst->w);i++)
-        outframe[i]=0xFF000000|inst->c2c[inst->sl[i]];
-      break;
-    case 8:
-      kvadranti(outframe,inst->w,inst->h,inst->neg);
-      break;
-    case 11:
-    case 12:
-      for (i=0;i<(inst->h*inst->w);i++)
-        outframe[i]=((uint32_t)inst->alpha[i])<<24|inst->c2c[inst->sl[i]];
-      break;
-    default:
-      break;
+    switch (inst->type)
+      {
+      case 0:
+      case 1:
+      case 2:
+      case 3:
+      case 4:
+      case 5:
+      case 6:
+      case 7:
+      case 9:
+      case 10:
+        for (i=0;i<(inst->h*inst->w);i++)
+          inst->frame[i]=0xFF000000|inst->c2c[inst->sl[i]];
+        break;
+      case 8:
+        kvadranti(inst->frame,inst->w,inst->h,inst->neg);
+        break;
+      case 11:
+      case 12:
+        for (i=0;i<(inst->h*inst->w);i++)
+          inst->frame[i]=((uint32_t)inst->alpha[i])<<24|inst->c2c[inst->sl[i]];
+        break;
+      default:
+        break;
+      }
+    inst->dirty=0;
     }
+  memcpy(outframe, inst->frame, inst->w*inst->h*sizeof(uint32_t));
 
 }
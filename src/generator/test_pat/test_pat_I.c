@@ -43,6 +43,7 @@ needs to care about color models, endianness, DV legality etc.
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "frei0r.h"
 
@@ -374,6 +375,8 @@ typedef struct
   int neg;
 
   float *sl;
+  uint32_t *frame;	//the pattern, ready for output
+  int dirty;		//frame needs to be rebuilt
 
 } tp_inst_t;
 
@@ -454,6 +457,8 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->neg=0;
 
   inst->sl=(float*)calloc(width*height,sizeof(float));
+  inst->frame=(uint32_t*)calloc(width*height,sizeof(uint32_t));
+  inst->dirty=1;
 
   pika_p(inst->sl, inst->w, inst->h, inst->pw, inst->amp);
 
@@ -466,6 +471,7 @@ void f0r_destruct(f0r_instance_t instance)
   tp_inst_t* inst = (tp_inst_t*)instance;
 
   free(inst->sl);
+  free(inst->frame);
   free(inst);
 }
 
@@ -524,6 +530,7 @@ void f0r_set_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
     }
 
   if (chg==0) return;
+  inst->dirty=1;
 
   switch (inst->type)
     {
@@ -588,6 +595,12 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
   assert(instance);
   tp_inst_t* inst = (tp_inst_t*)instance;
 
-  float2color(inst->sl, outframe, inst->w , inst->h, inst->chan);
+  //the pattern only changes with the parameters, convert it once
+  if (inst->dirty)
+    {
+    float2color(inst->sl, inst->frame, inst->w , inst->h, inst->chan);
+    inst->dirty=0;
+    }
+  memcpy(outframe, inst->frame, inst->w*inst->h*sizeof(uint32_t));
 
 }
@@ -47,6 +47,7 @@ needs to care about color models, endianness, DV legality etc.
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "frei0r.h"
 
@@ -534,6 +535,8 @@ typedef struct
   int chan;
 
   float *sl;
+  uint32_t *frame;	//the pattern, ready for output
+  int dirty;		//frame needs to be rebuilt
 
 } tp_inst_t;
 
@@ -590,6 +593,8 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->chan=0;
 
   inst->sl=(float*)calloc(width*height,sizeof(float));
+  inst->frame=(uint32_t*)calloc(width*height,sizeof(uint32_t));
+  inst->dirty=1;
 
   stopnice(inst->sl, inst->w, inst->h);
 
@@ -602,6 +607,7 @@ void f0r_destruct(f0r_instance_t instance)
   tp_inst_t* inst = (tp_inst_t*)instance;
 
   free(inst->sl);
+  free(inst->frame);
   free(inst);
 }
 
@@ -640,6 +646,7 @@ void f0r_set_param_value(f0r_instance_t instance, f0r_param_t param, int param_i
     }
 
   if (chg==0) return;
+  inst->dirty=1;
 
   switch (inst->type)
     {
@@ -695,6 +702,12 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
   assert(instance);
   tp_inst_t* inst = (tp_inst_t*)instance;
 
-  float2color(inst->sl, outframe, inst->w , inst->h, inst->chan);
+  //the pattern only changes with the parameters, convert it once
+  if (inst->dirty)
+    {
+    float2color(inst->sl, inst->frame, inst->w , inst->h, inst->chan);
+    inst->dirty=0;
+    }
+  memcpy(outframe, inst->frame, inst->w*inst->h*sizeof(uint32_t));
 
 }
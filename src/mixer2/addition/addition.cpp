@@ -20,20 +20,31 @@
 
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_blend.hpp"
 
-#define NBYTES 4
-#define ALPHA 3
+F0R_BLEND_IGNORE_PSABI
+
+struct add_op
+{
+  uint8_t operator()(uint8_t a, uint8_t b) const
+  {
+    return a + b > 255 ? 255 : a + b;
+  }
+#if defined(F0R_HAVE_VECTOR)
+  template <class V> V operator()(V a, V b) const
+  {
+    using namespace frei0r::blend;
+    V s = a + b;
+    return s | less(s, a); // saturate where it wrapped
+  }
+#endif
+};
 
 class addition : public frei0r::mixer2
 {
 public:
   addition(unsigned int width, unsigned int height)
   {
-    // initialize look-up table
-    for (int i = 0; i < 256; i++)
-      add_lut[i] = i;
-  	for (int i = 256; i <= 510; i++)
-      add_lut[i] = 255;
   }
 
   /**
@@ -47,34 +58,14 @@ public:
               const uint32_t* in1,
               const uint32_t* in2)
   {
-    const uint8_t *A = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *B = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *D = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          D[b] = add_lut[A[b] + B[b]];
-        
-        D[ALPHA] = MIN(A[ALPHA], B[ALPHA]);
-        A += NBYTES;
-        B += NBYTES;
-        D += NBYTES;
-      }
+    frei0r::blend::rgb(add_op(), in1, in2, out, size);
   }
-  
-private:
-  static uint8_t add_lut[511]; // look-up table storing values to do a quick MAX of two values when you know you add two unsigned chars
 };
 
-uint8_t addition::add_lut[511];
-
 frei0r::construct<addition> plugin("addition",
                                   "Perform an RGB[A] addition operation of the pixel sources.",
                                   "Jean-Sebastien Senecal",
                                   0,2,
-                                  F0R_COLOR_MODEL_RGBA8888);
+                                  F0R_COLOR_MODEL_RGBA8888,
+                                  F0R_CAP_INPLACE);
 
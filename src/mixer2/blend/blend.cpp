@@ -20,17 +20,42 @@
 
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_blend.hpp"
 
-#define NBYTES 4
-#define ALPHA 3
+F0R_BLEND_IGNORE_PSABI
+
+struct blend_op
+{
+  blend_op(uint8_t beta) : bf(beta) {}
+
+  uint8_t operator()(uint8_t a, uint8_t b) const
+  {
+    return (a * (255 - bf) + b * bf) / 255;
+  }
+#if defined(F0R_HAVE_VECTOR)
+  template <class V> V operator()(V a, V b) const
+  {
+    typedef typename frei0r::blend::wide<V>::type W;
+    W t = __builtin_convertvector(a, W) * (uint16_t)(255 - bf)
+      + __builtin_convertvector(b, W) * (uint16_t)bf;
+    return __builtin_convertvector(frei0r::blend::div255(t), V);
+  }
+#endif
+
+  uint8_t bf;
+};
 
 class blend : public frei0r::mixer2
 {
 public:
+  static void describe(frei0r::param_list<blend>& params)
+  {
+  	params.add(&blend::blend_factor,"blend","blend factor");
+  }
+
   blend(unsigned int width, unsigned int height)
   {
   	blend_factor = 0.5;
-  	register_param(blend_factor,"blend","blend factor");
   }
 
   /**
@@ -45,23 +70,7 @@ public:
               const uint32_t* in1,
               const uint32_t* in2)
   {
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    const uint8_t bf = (const uint8_t) (255 * blend_factor);
-    const uint8_t one_minus_bf = (255 - bf);
-    uint32_t w = size;
-    uint32_t b;
-  
-    while (w--)
-      {
-        for (b = 0; b < NBYTES; b++)
-          dst[b] = (src1[b] * one_minus_bf + src2[b] * bf) / 255;
-  
-        src1 += NBYTES;
-        src2 += NBYTES;
-        dst += NBYTES;
-      }
+    frei0r::blend::rgba(blend_op((uint8_t) (255 * blend_factor)), in1, in2, out, size);
   }
   
 private:
@@ -74,5 +83,6 @@ frei0r::construct<blend> plugin("blend",
                                 "Perform a blend operation between two sources",
                                 "Jean-Sebastien Senecal",
                                 0,2,
-                                F0R_COLOR_MODEL_RGBA8888);
+                                F0R_COLOR_MODEL_RGBA8888,
+                                F0R_CAP_INPLACE);
 
@@ -20,9 +20,24 @@
 
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_blend.hpp"
 
-#define NBYTES 4
-#define ALPHA 3
+F0R_BLEND_IGNORE_PSABI
+
+struct darken_op
+{
+  uint8_t operator()(uint8_t a, uint8_t b) const
+  {
+    return MIN(a, b);
+  }
+#if defined(F0R_HAVE_VECTOR)
+  template <class V> V operator()(V a, V b) const
+  {
+    using namespace frei0r::blend;
+    return select(less(a, b), a, b);
+  }
+#endif
+};
 
 class darken : public frei0r::mixer2
 {
@@ -46,29 +61,7 @@ public:
               const uint32_t* in1,
               const uint32_t* in2)
   {
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b;
-    uint8_t s1, s2;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          {
-            s1 = src1[b];
-            s2 = src2[b];
-            dst[b] = MIN(s1,s2);
-          }
-  
-        dst[ALPHA] = MIN(src1[ALPHA], src2[ALPHA]);
-  
-        src1 += NBYTES;
-        src2 += NBYTES;
-        dst += NBYTES;
-      }
+    frei0r::blend::rgb(darken_op(), in1, in2, out, size);
   }
   
     
@@ -79,5 +72,6 @@ frei0r::construct<darken> plugin("darken",
                                   "Perform a darken operation between two sources (minimum value of both sources).",
                                   "Jean-Sebastien Senecal",
                                   0,2,
-                                  F0R_COLOR_MODEL_RGBA8888);
+                                  F0R_COLOR_MODEL_RGBA8888,
+                                  F0R_CAP_INPLACE);
 
@@ -20,9 +20,25 @@
 
 #include "frei0r.hpp"
 #include "frei0r_math.h"
+#include "frei0r_blend.hpp"
 
-#define NBYTES 4
-#define ALPHA 3
+F0R_BLEND_IGNORE_PSABI
+
+struct multiply_op
+{
+  uint8_t operator()(uint8_t a, uint8_t b) const
+  {
+    uint32_t tmp;
+    return INT_MULT(a, b, tmp);
+  }
+#if defined(F0R_HAVE_VECTOR)
+  template <class V> V operator()(V a, V b) const
+  {
+    using namespace frei0r::blend;
+    return mul(a, b);
+  }
+#endif
+};
 
 class multiply : public frei0r::mixer2
 {
@@ -42,24 +58,7 @@ public:
               const uint32_t* in1,
               const uint32_t* in2)
   {
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b, tmp;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          dst[b] = INT_MULT(src1[b], src2[b], tmp);
-
-        dst[ALPHA] = MIN(src1[ALPHA], src2[ALPHA]);
-
-        src1 += NBYTES;
-        src2 += NBYTES;
-        dst += NBYTES;
-      }
+    frei0r::blend::rgb(multiply_op(), in1, in2, out, size);
   }
   
   
@@ -71,5 +70,6 @@ frei0r::construct<multiply> plugin("multiply",
                                    "Perform an RGB[A] multiply operation between the pixel sources.",
                                    "Jean-Sebastien Senecal",
                                    0,2,
-                                   F0R_COLOR_MODEL_RGBA8888);
+                                   F0R_COLOR_MODEL_RGBA8888,
+                                   F0R_CAP_INPLACE);
 
@@ -76,5 +76,6 @@ frei0r::construct<overlay> plugin("overlay",
 								  "D =  A * (B + (2 * B) * (255 - A))",
                                   "Jean-Sebastien Senecal",
                                   0,2,
-                                  F0R_COLOR_MODEL_RGBA8888);
+                                  F0R_COLOR_MODEL_RGBA8888,
+                                  F0R_CAP_INPLACE);
 
@@ -117,6 +117,9 @@ void f0r_update2(f0r_instance_t instance,
 
 			px = lrintf( w * fx );
 			py = lrintf( h * fy );
+			/* 255 and a G of 0 map to just past the last pixel */
+			if ( px >= (long)w ) px = w - 1;
+			if ( py >= (long)h ) py = h - 1;
 			if ( tmpc[2] > 128 ) {
 				*dst++ = src[px+w*py];
 			} else {
@@ -5,10 +5,14 @@
 class xfade0r : public frei0r::mixer2
 {
 public:
+  static void describe(frei0r::param_list<xfade0r>& params)
+  {
+    params.add(&xfade0r::fader,"fader","the fader position");
+  }
+
   xfade0r(unsigned int width, unsigned int height)
   {
     fader = 0.0;
-    register_param(fader,"fader","the fader position");
   }
 
   struct fade_fun
@@ -46,5 +50,7 @@ private:
 frei0r::construct<xfade0r> plugin("xfade0r",
 				  "a simple xfader",
 				  "Martin Bayer",
-				  0,2);
+				  0,2,
+				  F0R_COLOR_MODEL_BGRA8888,
+				  F0R_CAP_INPLACE);
 
@@ -0,0 +1,258 @@
+/*
+ * frei0r-registry.c
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  frei0r-registry [-l] DIR...
+
+  Writes DIR/frei0r.registry with the plugin and param info of all
+  plugins below DIR (see frei0r_registry.h).  Plugins that are unchanged
+  since the previous cache was written are not loaded again.  With -l
+  the caches are listed instead.
+*/
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "frei0r_registry.h"
+
+typedef struct registry_out
+{
+  FILE* f;
+  int count;
+  const f0r_registry_t* old;
+  int loaded, reused;
+} registry_out_t;
+
+static void put_u32(FILE* f, uint32_t v)
+{
+  fwrite(&v, 4, 1, f);
+}
+
+static void put_i64(FILE* f, int64_t v)
+{
+  fwrite(&v, 8, 1, f);
+}
+
+static void put_str(FILE* f, const char* s)
+{
+  if (!s) {
+    put_u32(f, F0R_REGISTRY_NULL);
+    return;
+  }
+  put_u32(f, (uint32_t)strlen(s));
+  fwrite(s, strlen(s) + 1, 1, f);
+}
+
+static void put_plugin(FILE* f, const char* file, const struct stat* st,
+                       unsigned int capabilities,
+                       const f0r_plugin_info_t* info,
+                       const f0r_param_info_t* params)
+{
+  int i;
+  put_str(f, file);
+  put_i64(f, (int64_t)st->st_mtime);
+  put_i64(f, (int64_t)st->st_size);
+  put_u32(f, capabilities);
+  put_str(f, info->name);
+  put_str(f, info->author);
+  put_str(f, info->explanation);
+  put_u32(f, (uint32_t)info->plugin_type);
+  put_u32(f, (uint32_t)info->color_model);
+  put_u32(f, (uint32_t)info->frei0r_version);
+  put_u32(f, (uint32_t)info->major_version);
+  put_u32(f, (uint32_t)info->minor_version);
+  put_u32(f, (uint32_t)info->num_params);
+  for (i = 0; i < info->num_params; i++) {
+    put_str(f, params[i].name);
+    put_u32(f, (uint32_t)params[i].type);
+    put_str(f, params[i].explanation);
+  }
+}
+
+/* Query a plugin and append it to the cache, 0 if it is no plugin. */
+static int query(registry_out_t* out, const char* path, const char* file,
+                 const struct stat* st)
+{
+  const f0r_registry_plugin_t* old = f0r_registry_find(out->old, file);
+  int (*init)(void);
+  void (*deinit)(void);
+  void (*get_plugin_info)(f0r_plugin_info_t*);
+  void (*get_param_info)(f0r_param_info_t*, int);
+  unsigned int (*get_capabilities)(void);
+  f0r_plugin_info_t info;
+  f0r_param_info_t* params;
+  void* handle;
+  int i;
+
+  if (old && old->mtime == (int64_t)st->st_mtime && old->size == (int64_t)st->st_size) {
+    put_plugin(out->f, file, st, old->capabilities, &old->info, old->params);
+    out->reused++;
+    return 1;
+  }
+
+  handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    fprintf(stderr, "frei0r-registry: %s\n", dlerror());
+    return 0;
+  }
+  *(void**)&init = dlsym(handle, "f0r_init");
+  *(void**)&deinit = dlsym(handle, "f0r_deinit");
+  *(void**)&get_plugin_info = dlsym(handle, "f0r_get_plugin_info");
+  *(void**)&get_param_info = dlsym(handle, "f0r_get_param_info");
+  *(void**)&get_capabilities = dlsym(handle, "f0r_get_capabilities");
+  if (!init || !deinit || !get_plugin_info || !get_param_info) {
+    dlclose(handle);
+    return 0;
+  }
+
+  init();
+  memset(&info, 0, sizeof(info));
+  get_plugin_info(&info);
+  params = (f0r_param_info_t*)calloc(info.num_params > 0 ? info.num_params : 1,
+                                     sizeof(f0r_param_info_t));
+  for (i = 0; i < info.num_params; i++)
+    get_param_info(&params[i], i);
+  put_plugin(out->f, file, st, get_capabilities ? get_capabilities() : 0,
+             &info, params);
+  free(params);
+  deinit();
+  dlclose(handle);
+  out->loaded++;
+  return 1;
+}
+
+static int has_suffix(const char* s, const char* suffix)
+{
+  size_t n = strlen(s), m = strlen(suffix);
+  return n > m && strcmp(s + n - m, suffix) == 0;
+}
+
+/* Plugins in dir/sub and its vendor subdirectories. */
+static void scan(registry_out_t* out, const char* dir, const char* sub)
+{
+  char path[4096], file[4096];
+  struct dirent* e;
+  struct stat st;
+  DIR* d;
+
+  if ((size_t)snprintf(path, sizeof(path), "%s/%s", dir, sub) >= sizeof(path))
+    return;
+  d = opendir(path);
+  if (!d)
+    return;
+  while ((e = readdir(d)) != 0) {
+    if (e->d_name[0] == '.')
+      continue;
+    /* a truncated name would query, or cache, the wrong file */
+    if ((size_t)snprintf(file, sizeof(file), "%s%s%s", sub, *sub ? "/" : "", e->d_name) >= sizeof(file)
+        || (size_t)snprintf(path, sizeof(path), "%s/%s", dir, file) >= sizeof(path)) {
+      fprintf(stderr, "frei0r-registry: path too long, skipped: %s/%s/%s\n", dir, sub, e->d_name);
+      continue;
+    }
+    if (stat(path, &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode))
+      scan(out, dir, file);
+    else if (S_ISREG(st.st_mode) && has_suffix(e->d_name, ".so"))
+      out->count += query(out, path, file, &st);
+  }
+  closedir(d);
+}
+
+static int update(const char* dir)
+{
+  registry_out_t out;
+  f0r_registry_t* old = f0r_registry_load(dir);
+  char path[4096], tmp[4096 + 8];
+
+  if ((size_t)snprintf(path, sizeof(path), "%s/%s", dir, F0R_REGISTRY_FILE) >= sizeof(path)) {
+    fprintf(stderr, "frei0r-registry: path too long: %s\n", dir);
+    f0r_registry_free(old);
+    return 1;
+  }
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  memset(&out, 0, sizeof(out));
+  out.old = old;
+  out.f = fopen(tmp, "wb");
+  if (!out.f) {
+    perror(tmp);
+    f0r_registry_free(old);
+    return 1;
+  }
+
+  fwrite(F0R_REGISTRY_MAGIC, 8, 1, out.f);
+  put_u32(out.f, F0R_REGISTRY_BOM);
+  put_u32(out.f, 0); /* count, filled in below */
+  scan(&out, dir, "");
+  fseek(out.f, 12, SEEK_SET);
+  put_u32(out.f, (uint32_t)out.count);
+  f0r_registry_free(old);
+
+  if (ferror(out.f) | fclose(out.f) || rename(tmp, path) != 0) {
+    perror(path);
+    remove(tmp);
+    return 1;
+  }
+  printf("%s: %d plugins (%d queried, %d unchanged)\n",
+         path, out.count, out.loaded, out.reused);
+  return 0;
+}
+
+static int list(const char* dir)
+{
+  f0r_registry_t* reg = f0r_registry_load(dir);
+  int i, j;
+
+  if (!reg) {
+    fprintf(stderr, "frei0r-registry: no valid cache in %s\n", dir);
+    return 1;
+  }
+  for (i = 0; i < reg->count; i++) {
+    const f0r_registry_plugin_t* p = &reg->plugins[i];
+    printf("%s%s: %s %d.%d, type %d, color model %d, capabilities 0x%x\n",
+           p->file, f0r_registry_current(p) ? "" : " (changed)",
+           p->info.name, p->info.major_version, p->info.minor_version,
+           p->info.plugin_type, p->info.color_model, p->capabilities);
+    for (j = 0; j < p->info.num_params; j++)
+      printf("  %d %s (type %d)\n", j, p->params[j].name, p->params[j].type);
+  }
+  f0r_registry_free(reg);
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  int i, listing = 0, status = 0;
+
+  if (argc > 1 && strcmp(argv[1], "-l") == 0)
+    listing = 1;
+  if (argc < 2 + listing) {
+    fprintf(stderr, "usage: frei0r-registry [-l] DIR...\n");
+    return 2;
+  }
+  for (i = 1 + listing; i < argc; i++)
+    status |= listing ? list(argv[i]) : update(argv[i]);
+  return status;
+}
@@ -0,0 +1,612 @@
+/*
+ * frei0r-check.c
+ * Copyright (C) 2026 frei0r contributors
+ *
+ * This file is part of Frei0r.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+  frei0r-check [-s WxH]... [-n FRAMES] [-g FILE | -w FILE] PATH...
+
+  Runs every plugin found below PATH (a directory or a plugin file) on
+  synthetic frames with its default parameters and prints, per plugin
+  and frame size, a hash of the output frames and the fastest update
+  time.  Each run happens in a child process, so a plugin that crashes
+  or hangs is reported instead of taking the checker down.
+
+  Every run is done twice on fresh instances; plugins whose output then
+  differs (random seeds, clocks, global state) are reported as varying
+  and not hashed.  Plugins that seed their random numbers with time()
+  get a fixed time from the checker instead (see time() below).
+
+  Plugins exporting f0r_resize also run an instance that starts at
+  half the size and is then resized, which must not crash or hang.
+  Filters and mixers reporting F0R_CAP_INPLACE also run an instance
+  that writes into its first input frame, whose hash must be the one
+  of the run with a separate output frame.
+
+  -w FILE writes the hashes to FILE, -g FILE compares them with those
+  in FILE.  Recording with one build and checking with another shows
+  whether a rewrite is bit exact:
+
+    frei0r-check -w golden.txt old-build/src
+    frei0r-check -g golden.txt new-build/src
+
+  The exit status is 1 if a plugin crashed, hung, gave other frames in
+  place or did not match its recorded hash, else 0.
+*/
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frei0r.h"
+
+#define MAX_SIZES 16
+#define TIMEOUT 60 /* seconds per plugin and size */
+
+typedef struct check_size
+{
+  unsigned int width, height;
+} check_size_t;
+
+typedef struct golden
+{
+  char* file;
+  unsigned int width, height;
+  char hash[17];
+  int seen;
+} golden_t;
+
+typedef struct check
+{
+  check_size_t sizes[MAX_SIZES];
+  int num_sizes;
+  int frames;
+  FILE* write;
+  golden_t* golden;
+  int num_golden;
+  int failed, passed, varying, unmatched;
+} check_t;
+
+typedef struct plugin_api
+{
+  int (*init)(void);
+  void (*deinit)(void);
+  void (*get_plugin_info)(f0r_plugin_info_t*);
+  void (*get_param_info)(f0r_param_info_t*, int);
+  f0r_instance_t (*construct)(unsigned int, unsigned int);
+  void (*destruct)(f0r_instance_t);
+  void (*get_param_value)(f0r_instance_t, f0r_param_t, int);
+  void (*update)(f0r_instance_t, double, const uint32_t*, uint32_t*);
+  void (*update2)(f0r_instance_t, double, const uint32_t*, const uint32_t*,
+                  const uint32_t*, uint32_t*);
+  int (*resize)(f0r_instance_t, unsigned int, unsigned int);
+  unsigned int (*get_capabilities)(void);
+} plugin_api_t;
+
+/* The checker is linked with --export-dynamic, so plugins calling
+   time() get this one instead of the one of the C library, and those
+   seeding their random numbers with it give the same frames on every
+   run. */
+time_t time(time_t* t)
+{
+  if (t)
+    *t = 1000000000;
+  return 1000000000;
+}
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Input k of frame f: gradients in the upper half, noise in the lower
+   half, opaque and translucent pixels. */
+static void fill_input(uint32_t* frame, unsigned int width,
+                       unsigned int height, int f, int k)
+{
+  uint32_t seed = 0x9e3779b9u * (uint32_t)(f * 3 + k + 1);
+  unsigned int x, y;
+
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      uint32_t r, g, b, a;
+      seed = seed * 1103515245u + 12345u;
+      if (y < height / 2) {
+        r = (x * 255 / width + 16 * f) & 0xff;
+        g = (y * 255 / height + 64 * k) & 0xff;
+        b = ((x + y) * 4) & 0xff;
+        a = 0xff;
+      } else {
+        r = seed >> 24;
+        g = (seed >> 16) & 0xff;
+        b = (seed >> 8) & 0xff;
+        a = x < width / 2 ? 0xff : (seed >> 4) & 0xff;
+      }
+      frame[y * width + x] = r | g << 8 | b << 16 | a << 24;
+    }
+  }
+}
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t n)
+{
+  const unsigned char* p = (const unsigned char*)data;
+  while (n--) {
+    h ^= *p++;
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+/* Read every param, as hosts do to show the defaults. */
+static void read_params(const plugin_api_t* api, f0r_instance_t instance,
+                        int num_params)
+{
+  int i;
+  for (i = 0; i < num_params; i++) {
+    f0r_param_info_t info;
+    union {
+      double d;
+      f0r_param_color_t color;
+      f0r_param_position_t position;
+      f0r_param_string s;
+    } value;
+    memset(&info, 0, sizeof(info));
+    api->get_param_info(&info, i);
+    memset(&value, 0, sizeof(value));
+    api->get_param_value(instance, &value, i);
+    if (info.type == F0R_PARAM_STRING && value.s)
+      (void)strlen(value.s);
+  }
+}
+
+/* Update an instance with frame f of the synthetic input, returns the
+   time the update took.  out may be in[0] to update in place. */
+static uint64_t update(const plugin_api_t* api, const f0r_plugin_info_t* info,
+                       f0r_instance_t instance, unsigned int width,
+                       unsigned int height, int f, uint32_t** in, uint32_t* out)
+{
+  uint64_t t;
+  int k;
+
+  for (k = 0; k < 3; k++)
+    fill_input(in[k], width, height, f, k);
+  if (out != in[0])
+    memset(out, 0, (size_t)width * height * 4);
+  t = now_ns();
+  if (api->update2)
+    api->update2(instance, f * 0.04,
+                 info->plugin_type == F0R_PLUGIN_TYPE_SOURCE ? 0 : in[0],
+                 info->plugin_type >= F0R_PLUGIN_TYPE_MIXER2 ? in[1] : 0,
+                 info->plugin_type == F0R_PLUGIN_TYPE_MIXER3 ? in[2] : 0,
+                 out);
+  else
+    api->update(instance, f * 0.04,
+                info->plugin_type == F0R_PLUGIN_TYPE_SOURCE ? 0 : in[0], out);
+  return now_ns() - t;
+}
+
+/* Run one instance for the given frames, 0 if it could not be built.
+   With inplace set, the output goes to in[0] instead of out. */
+static int run(const plugin_api_t* api, const f0r_plugin_info_t* info,
+               unsigned int width, unsigned int height, int frames, int inplace,
+               uint32_t** in, uint32_t* out, uint64_t* hash, uint64_t* best)
+{
+  f0r_instance_t instance = api->construct(width, height);
+  int f;
+
+  if (!instance)
+    return 0;
+  read_params(api, instance, info->num_params);
+  if (inplace)
+    out = in[0];
+  *hash = 0xcbf29ce484222325ull;
+  for (f = 0; f < frames; f++) {
+    uint64_t t = update(api, info, instance, width, height, f, in, out);
+    if (t < *best)
+      *best = t;
+    *hash = fnv1a(*hash, out, (size_t)width * height * 4);
+  }
+  api->destruct(instance);
+  return 1;
+}
+
+/* For plugins with f0r_resize: build an instance at half the size, run
+   it, resize it to the full size and run it again.  Only crashes and
+   hangs are caught here, the frames are not hashed. */
+static void run_resized(const plugin_api_t* api, const f0r_plugin_info_t* info,
+                        unsigned int width, unsigned int height, int frames,
+                        uint32_t** in, uint32_t* out)
+{
+  unsigned int w = (width / 2 + 7) & ~7u, h = (height / 2 + 7) & ~7u;
+  f0r_instance_t instance = api->construct(w, h);
+  int f;
+
+  if (!instance)
+    return;
+  for (f = 0; f < frames; f++)
+    update(api, info, instance, w, h, f, in, out);
+  if (api->resize(instance, width, height))
+    for (; f < 2 * frames; f++)
+      update(api, info, instance, width, height, f, in, out);
+  api->destruct(instance);
+}
+
+/* The child: load the plugin, run it twice (and once more in place if
+   it may) and write the result line "hash|varies|inplace|error ns
+   message" to fd. */
+static void child(int fd, const char* path, unsigned int width,
+                  unsigned int height, int frames)
+{
+  plugin_api_t api;
+  f0r_plugin_info_t info;
+  uint32_t* in[3];
+  uint32_t* out;
+  uint64_t hash[3], best = UINT64_MAX;
+  char line[256];
+  void* handle;
+  int k, ok, inplace;
+
+  handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    snprintf(line, sizeof(line), "error 0 %s\n", dlerror());
+    goto done;
+  }
+  *(void**)&api.init = dlsym(handle, "f0r_init");
+  *(void**)&api.deinit = dlsym(handle, "f0r_deinit");
+  *(void**)&api.get_plugin_info = dlsym(handle, "f0r_get_plugin_info");
+  *(void**)&api.get_param_info = dlsym(handle, "f0r_get_param_info");
+  *(void**)&api.construct = dlsym(handle, "f0r_construct");
+  *(void**)&api.destruct = dlsym(handle, "f0r_destruct");
+  *(void**)&api.get_param_value = dlsym(handle, "f0r_get_param_value");
+  *(void**)&api.update = dlsym(handle, "f0r_update");
+  *(void**)&api.update2 = dlsym(handle, "f0r_update2");
+  *(void**)&api.resize = dlsym(handle, "f0r_resize");
+  *(void**)&api.get_capabilities = dlsym(handle, "f0r_get_capabilities");
+  if (!api.init || !api.deinit || !api.get_plugin_info || !api.get_param_info
+      || !api.construct || !api.destruct || !api.get_param_value
+      || (!api.update && !api.update2)) {
+    snprintf(line, sizeof(line), "error 0 not a frei0r plugin\n");
+    goto done;
+  }
+
+  api.init();
+  memset(&info, 0, sizeof(info));
+  api.get_plugin_info(&info);
+  if (info.plugin_type >= F0R_PLUGIN_TYPE_MIXER2 && !api.update2) {
+    snprintf(line, sizeof(line), "error 0 mixer without f0r_update2\n");
+    goto done;
+  }
+  for (k = 0; k < 3; k++)
+    in[k] = (uint32_t*)malloc((size_t)width * height * 4);
+  out = (uint32_t*)malloc((size_t)width * height * 4);
+  ok = run(&api, &info, width, height, frames, 0, in, out, &hash[0], &best)
+    && run(&api, &info, width, height, frames, 0, in, out, &hash[1], &best);
+  /* sources have no input frame to write into */
+  inplace = ok && hash[0] == hash[1]
+    && info.plugin_type != F0R_PLUGIN_TYPE_SOURCE
+    && api.get_capabilities && (api.get_capabilities() & F0R_CAP_INPLACE);
+  if (inplace)
+    ok = run(&api, &info, width, height, frames, 1, in, out, &hash[2], &best);
+  if (ok && api.resize)
+    run_resized(&api, &info, width, height, frames, in, out);
+  api.deinit();
+  if (!ok)
+    snprintf(line, sizeof(line), "error 0 f0r_construct failed\n");
+  else if (hash[0] != hash[1])
+    snprintf(line, sizeof(line), "varies %llu\n", (unsigned long long)best);
+  else if (inplace && hash[2] != hash[0])
+    snprintf(line, sizeof(line), "inplace %llu\n", (unsigned long long)best);
+  else
+    snprintf(line, sizeof(line), "%016llx %llu\n",
+             (unsigned long long)hash[0], (unsigned long long)best);
+
+done:
+  if (write(fd, line, strlen(line)) < 0)
+    _exit(2);
+  _exit(0);
+}
+
+static golden_t* find_golden(check_t* check, const char* file,
+                             unsigned int width, unsigned int height)
+{
+  int i;
+  for (i = 0; i < check->num_golden; i++) {
+    golden_t* g = &check->golden[i];
+    if (g->width == width && g->height == height && strcmp(g->file, file) == 0)
+      return g;
+  }
+  return 0;
+}
+
+/* Check one plugin at one size in a child process. */
+static void check_plugin(check_t* check, const char* path, const char* file,
+                         unsigned int width, unsigned int height)
+{
+  char result[256], status[128];
+  unsigned long long ns = 0;
+  char hash[64];
+  int fds[2], wstatus;
+  ssize_t n = 0, r;
+  pid_t pid;
+
+  fflush(stdout);
+  if (pipe(fds) != 0 || (pid = fork()) < 0) {
+    perror("frei0r-check");
+    exit(2);
+  }
+  if (pid == 0) {
+    /* some plugins print to stdout, keep that out of the report */
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0)
+      dup2(null, STDOUT_FILENO);
+    close(fds[0]);
+    alarm(TIMEOUT);
+    child(fds[1], path, width, height, check->frames);
+  }
+  close(fds[1]);
+  while (n < (ssize_t)sizeof(result) - 1
+         && ((r = read(fds[0], result + n, sizeof(result) - 1 - n)) > 0
+             || (r < 0 && errno == EINTR)))
+    if (r > 0)
+      n += r;
+  result[n] = 0;
+  close(fds[0]);
+  while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR)
+    ;
+
+  hash[0] = 0;
+  if (WIFSIGNALED(wstatus)) {
+    if (WTERMSIG(wstatus) == SIGALRM)
+      snprintf(status, sizeof(status), "TIMEOUT after %d s", TIMEOUT);
+    else
+      snprintf(status, sizeof(status), "CRASH (%s)", strsignal(WTERMSIG(wstatus)));
+    check->failed++;
+  } else if (sscanf(result, "%63s %llu", hash, &ns) < 1) {
+    snprintf(status, sizeof(status), "CRASH (no result)");
+    check->failed++;
+  } else if (strcmp(hash, "error") == 0) {
+    char* msg = strchr(result, ' ') ? strchr(strchr(result, ' ') + 1, ' ') : 0;
+    snprintf(status, sizeof(status), "skipped: %s", msg ? msg + 1 : "");
+    status[strcspn(status, "\n")] = 0;
+    hash[0] = 0;
+  } else if (strcmp(hash, "varies") == 0) {
+    snprintf(status, sizeof(status), "varies between runs");
+    check->varying++;
+  } else if (strcmp(hash, "inplace") == 0) {
+    snprintf(status, sizeof(status), "INPLACE MISMATCH, differs with outframe == inframe1");
+    check->failed++;
+  } else {
+    golden_t* g = find_golden(check, file, width, height);
+    if (g) {
+      g->seen = 1;
+      if (strcmp(g->hash, hash) == 0) {
+        snprintf(status, sizeof(status), "ok");
+        check->passed++;
+      } else {
+        snprintf(status, sizeof(status), "MISMATCH, expected %s", g->hash);
+        check->failed++;
+      }
+    } else {
+      snprintf(status, sizeof(status), check->golden ? "new" : "ok");
+      check->passed += !check->golden;
+      check->unmatched += !!check->golden;
+    }
+    if (check->write)
+      fprintf(check->write, "%s %ux%u %s\n", file, width, height, hash);
+  }
+
+  if (!hash[0] || strcmp(hash, "varies") == 0 || strcmp(hash, "inplace") == 0
+      || strcmp(hash, "error") == 0)
+    strcpy(hash, "-");
+  if (ns)
+    snprintf(result, sizeof(result), "%10.3f ms", ns / 1e6);
+  else
+    snprintf(result, sizeof(result), "%10s   ", "-");
+  printf("%-24s %5ux%-5u %-16s %s  %s\n", file, width, height, hash,
+         result, status);
+}
+
+static int has_suffix(const char* s, const char* suffix)
+{
+  size_t n = strlen(s), m = strlen(suffix);
+  return n > m && strcmp(s + n - m, suffix) == 0;
+}
+
+static int compare_names(const void* a, const void* b)
+{
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* All plugin files in dir/sub and below, sorted so that the output of
+   two builds lines up. */
+static void scan(char*** files, int* count, const char* dir, const char* sub)
+{
+  char path[8192], file[4096];
+  struct dirent* e;
+  struct stat st;
+  DIR* d;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, sub);
+  d = opendir(path);
+  if (!d)
+    return;
+  while ((e = readdir(d)) != 0) {
+    if (e->d_name[0] == '.')
+      continue;
+    snprintf(file, sizeof(file), "%s%s%s", sub, *sub ? "/" : "", e->d_name);
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    if (stat(path, &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode)) {
+      scan(files, count, dir, file);
+    } else if (S_ISREG(st.st_mode) && has_suffix(e->d_name, ".so")) {
+      *files = (char**)realloc(*files, (*count + 1) * sizeof(char*));
+      (*files)[(*count)++] = strdup(file);
+    }
+  }
+  closedir(d);
+}
+
+static void check_path(check_t* check, const char* path)
+{
+  char full[8192];
+  char** files = 0;
+  const char* base;
+  struct stat st;
+  int count = 0, i, s;
+
+  if (stat(path, &st) != 0) {
+    perror(path);
+    check->failed++;
+    return;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    base = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    for (s = 0; s < check->num_sizes; s++)
+      check_plugin(check, path, base,
+                   check->sizes[s].width, check->sizes[s].height);
+    return;
+  }
+
+  scan(&files, &count, path, "");
+  qsort(files, count, sizeof(char*), compare_names);
+  for (i = 0; i < count; i++) {
+    /* plugins are told apart by their file name, wherever they are */
+    base = strrchr(files[i], '/') ? strrchr(files[i], '/') + 1 : files[i];
+    snprintf(full, sizeof(full), "%s/%s", path, files[i]);
+    for (s = 0; s < check->num_sizes; s++)
+      check_plugin(check, full, base,
+                   check->sizes[s].width, check->sizes[s].height);
+    free(files[i]);
+  }
+  free(files);
+}
+
+static int read_golden(check_t* check, const char* name)
+{
+  char line[4096], file[4096], hash[17];
+  unsigned int width, height;
+  FILE* f = fopen(name, "r");
+
+  if (!f) {
+    perror(name);
+    return 0;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    golden_t* g;
+    if (line[0] == '#'
+        || sscanf(line, "%4095s %ux%u %16s", file, &width, &height, hash) != 4)
+      continue;
+    check->golden = (golden_t*)realloc(check->golden,
+                                       (check->num_golden + 1) * sizeof(golden_t));
+    g = &check->golden[check->num_golden++];
+    g->file = strdup(file);
+    g->width = width;
+    g->height = height;
+    memcpy(g->hash, hash, sizeof(g->hash));
+    g->seen = 0;
+  }
+  fclose(f);
+  if (!check->golden)
+    check->golden = (golden_t*)calloc(1, sizeof(golden_t));
+  return 1;
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: frei0r-check [-s WxH]... [-n FRAMES] "
+          "[-g FILE | -w FILE] PATH...\n");
+  exit(2);
+}
+
+int main(int argc, char** argv)
+{
+  check_t check;
+  int i, opt;
+
+  memset(&check, 0, sizeof(check));
+  check.frames = 3;
+  while ((opt = getopt(argc, argv, "s:n:g:w:")) != -1) {
+    switch (opt) {
+    case 's':
+      if (check.num_sizes == MAX_SIZES
+          || sscanf(optarg, "%ux%u", &check.sizes[check.num_sizes].width,
+                    &check.sizes[check.num_sizes].height) != 2
+          || check.sizes[check.num_sizes].width < 8
+          || check.sizes[check.num_sizes].height < 8)
+        usage();
+      check.num_sizes++;
+      break;
+    case 'n':
+      check.frames = atoi(optarg);
+      if (check.frames < 1)
+        usage();
+      break;
+    case 'g':
+      if (check.golden || !read_golden(&check, optarg))
+        usage();
+      break;
+    case 'w':
+      if (check.write || !(check.write = fopen(optarg, "w"))) {
+        perror(optarg);
+        usage();
+      }
+      break;
+    default:
+      usage();
+    }
+  }
+  if (optind == argc)
+    usage();
+  if (check.num_sizes == 0) {
+    /* the smallest size the spec allows, and two common ones */
+    check_size_t sizes[] = { { 8, 8 }, { 64, 48 }, { 640, 360 } };
+    memcpy(check.sizes, sizes, sizeof(sizes));
+    check.num_sizes = 3;
+  }
+
+  if (check.write)
+    fprintf(check.write, "# frei0r-check, %d frames per size\n", check.frames);
+  for (i = optind; i < argc; i++)
+    check_path(&check, argv[i]);
+
+  for (i = 0; i < check.num_golden; i++) {
+    if (!check.golden[i].seen)
+      printf("%-24s %5ux%-5u missing, recorded as %s\n", check.golden[i].file,
+             check.golden[i].width, check.golden[i].height,
+             check.golden[i].hash);
+  }
+  printf("%d ok, %d failed, %d varying, %d not recorded\n",
+         check.passed, check.failed, check.varying, check.unmatched);
+  if (check.write && fclose(check.write) != 0)
+    perror("frei0r-check");
+  return check.failed ? 1 : 0;
+}